@@ -0,0 +1,52 @@
+#ifndef __ARCHETYPEREGISTRY_h_
+#define __ARCHETYPEREGISTRY_h_
+
+#include "stdafx.h"
+#include "EnvironmentObject.h"
+#include "EntityStore.h"
+
+/* Everything needed to spawn one kind of level object, resolved when the registry loads */
+struct Archetype {
+	String key;
+	String name;					//Object name used in level files
+	String mesh;					//Mesh the editor places
+	String material;				//Empty if the mesh's own material is used
+	EnvironmentObject::ShapeType shape;
+	EntityStore::EntityType category;
+	Real mass;						//Mass and friction written out for objects placed in the editor
+	Real friction;
+	Real bodyMass;					//Overrides on the rigid body, negative if the level file's value is kept
+	Real bodyFriction;
+	Real editorFriction;			//Rigid body friction while being edited, negative to keep it
+	int editorSlot;					//Number key in the editor, 0 if it can't be placed
+	Vector3 halfSize;				//Collision half extents of the unscaled mesh
+};
+
+/* Header file for ArchetypeRegistry class.
+ * Lists all class variables and methods */
+class ArchetypeRegistry {
+public:
+	//Number keys 0 to 9
+	static const int EDITOR_SLOTS = 10;
+
+	//Class methods
+	ArchetypeRegistry();
+	~ArchetypeRegistry();
+	void load(const String &fileName);
+	unsigned int getCount(void) const;
+	const Archetype& getArchetype(unsigned int i) const;
+	const Archetype& findByName(const String &name) const;
+	const Archetype* getEditorArchetype(int slot) const;
+	static bool parseCategory(const String &text, EntityStore::EntityType &category);
+
+private:
+	static bool parseShape(const String &text, EnvironmentObject::ShapeType &shape);
+	static Vector3 getHalfSize(const String &mesh);
+
+	std::vector<Archetype> mArchetypes;
+	std::map<String, unsigned int> mByName;		//First archetype with each object name
+	int mEditorSlots[EDITOR_SLOTS];				//Archetype index for each number key, -1 if unused
+	Archetype mFallback;						//Used for names no archetype claims
+};
+
+#endif
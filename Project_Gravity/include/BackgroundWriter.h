@@ -0,0 +1,49 @@
+#ifndef __BACKGROUNDWRITER_h_
+#define __BACKGROUNDWRITER_h_
+
+#include "stdafx.h"
+
+/* Header file for BackgroundWriter class.
+ * Lists all class variables and methods */
+class BackgroundWriter {
+public:
+	//Class methods
+	BackgroundWriter();
+	~BackgroundWriter();
+	void write(const String &fileName, const String &contents);
+	void append(const String &fileName, const String &contents);
+	void remove(const String &fileName);
+	void flush(void);
+	static bool writeFileAtomically(const String &fileName, const String &contents);
+
+private:
+	//One queued file operation
+	struct Job {
+		enum Type {
+			JOB_WRITE = 0,
+			JOB_APPEND,
+			JOB_REMOVE
+		};
+		Type type;
+		String fileName;
+		String contents;
+	};
+
+	//Not copyable, the thread belongs to one object
+	BackgroundWriter(const BackgroundWriter &);
+	BackgroundWriter& operator=(const BackgroundWriter &);
+
+	void queue(Job::Type type, const String &fileName, const String &contents);
+	void run(void);
+	static void runJob(const Job &job);
+	static DWORD WINAPI threadMain(LPVOID writer);
+
+	HANDLE mThread;
+	HANDLE mWorkEvent;		//Signalled when jobs are queued or the thread should stop
+	HANDLE mIdleEvent;		//Set while there is nothing queued or being written
+	CRITICAL_SECTION mLock;
+	std::deque<Job> mJobs;
+	bool mStopping;
+};
+
+#endif
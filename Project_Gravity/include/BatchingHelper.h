@@ -0,0 +1,16 @@
+#ifndef __BATCHINGHELPER_h_
+#define __BATCHINGHELPER_h_
+
+#include "stdafx.h"
+
+/* Header file for BatchingHelper class.
+ * Lists all class variables and methods */
+class BatchingHelper {
+public:
+	//Class methods
+	static MeshPtr cloneWithoutSkeleton(const String &mesh, const String &name);
+	static void getVertexData(Mesh* mesh, std::vector<VertexData *> &vertexData);
+	static int getCellKey(const Vector3 &position, Real cellSize);
+};
+
+#endif
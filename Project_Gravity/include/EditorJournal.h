@@ -0,0 +1,44 @@
+#ifndef __EDITORJOURNAL_h_
+#define __EDITORJOURNAL_h_
+
+#include "stdafx.h"
+#include "BackgroundWriter.h"
+
+/* Header file for EditorJournal class.
+ * Lists all class variables and methods */
+class EditorJournal {
+public:
+	//Class methods
+	EditorJournal(BackgroundWriter* writer);
+	~EditorJournal();
+	void begin(int island);
+	void end(void);
+	bool isActive(void) const;
+	int getIsland(void) const;
+	void addObject(const std::string fields[], int fieldCount, OgreBulletDynamics::RigidBody* body);
+	void update(Real timeSinceLastFrame);
+	void checkpoint(void);
+	String getObjectText(void) const;
+	static bool recover(int &island, String &objectText);
+	static void discardRecovered(void);
+
+private:
+	void flushJournal(void);
+	void refreshTransforms(void);
+	static bool readOperations(const String &fileName, bool snapshot, Ogre::uint32 &generation, int &island, std::vector<String> &objects);
+
+	BackgroundWriter* mWriter;
+	bool mActive;
+	int mIsland;
+	std::vector<String> mObjects;	//One level file line per placed object, in placement order
+	std::vector<std::vector<String> > mObjectFields;	//The same lines split into columns
+	std::vector<OgreBulletDynamics::RigidBody *> mBodies;	//Body of each object, which may have moved since it was placed
+	String mPending;				//Operations not yet handed to the writer
+	Ogre::uint32 mGeneration;		//Bumped by every snapshot, stale journals are ignored on recovery
+	bool mJournalStarted;
+	unsigned int mJournalOperations;
+	Real mSinceFlush;
+	Real mSinceCheckpoint;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef __ENTITYSTORE_h_
+#define __ENTITYSTORE_h_
+
+#include "stdafx.h"
+#include "MovableText.h"
+#include "PathAnimator.h"
+#include "LooseOctree.h"
+
+class EnvironmentObject;
+
+//Refers to one level object for as long as it exists, 0 is never a valid handle
+typedef Ogre::uint32 EntityHandle;
+const EntityHandle NULL_ENTITY = 0;
+
+/* Header file for EntityStore class.
+ * Lists all class variables and methods */
+class EntityStore {
+public:
+	//Kinds of level object, each with its own rules in the game systems
+	enum EntityType {
+		ENTITY_CRATE = 0,
+		ENTITY_COCONUT,
+		ENTITY_TARGET,
+		ENTITY_BLOCK,
+		ENTITY_PALM,
+		ENTITY_ORANGE,
+		ENTITY_BLUE,
+		ENTITY_RED,
+		ENTITY_TYPES
+	};
+
+	//Score text shown rising from a target once it is hit
+	struct Billboard {
+		SceneNode* node;
+		MovableText* text;
+		Real time;
+		bool shown;
+		Vector3 position;
+	};
+
+	//Class methods
+	EntityStore();
+	~EntityStore();
+	EntityHandle create(EntityType type, const EnvironmentObject &object);
+	void destroy(EntityHandle handle);
+	void clear(void);
+	bool isValid(EntityHandle handle) const;
+	int getIndex(EntityHandle handle) const;
+	EntityHandle getHandle(int index) const;
+	int getCount(void) const;
+	int getTypeCount(EntityType type) const;
+	EntityHandle findByBody(const btCollisionObject* body) const;
+	EntityType getType(int index) const;
+	bool isStaticProp(int index) const;
+	OgreBulletDynamics::RigidBody* getBody(int index) const;
+	bool isCounted(int index) const;
+	void setCounted(int index);
+	void moveAnimated(double spinTime, Real timeSinceLastFrame);
+	void updateSpatialIndex(void);
+	void findInRadius(const Vector3 &centre, Real radius, std::vector<EntityHandle> &handles) const;
+	void findInBox(const AxisAlignedBox &box, std::vector<EntityHandle> &handles) const;
+	EntityHandle pick(const Ray &ray, Real maxDistance, Real &distance) const;
+
+private:
+	void release(int index);
+	void moveBillboard(int index, Real timeSinceLastFrame);
+	static AxisAlignedBox getBounds(OgreBulletDynamics::RigidBody* body);
+
+	//Components, one element per object, all indexed the same way and kept tightly packed
+	std::vector<Ogre::uint8> mTypes;
+	std::vector<OgreBulletDynamics::RigidBody *> mBodies;
+	std::vector<int> mPaths;						//Index into mPathAnimator, -1 if the object doesn't move
+	std::vector<AnimationState *> mMeshAnimations;	//Target folding over when hit, NULL if the mesh has none
+	std::vector<Ogre::uint8> mCounted;				//Whether a hit has been scored
+	std::vector<Billboard> mBillboards;
+	std::vector<EntityHandle> mHandles;
+	std::vector<int> mSpatialItems;					//Item id in mSpatialIndex
+
+	//Handle slots, pointing at where each object currently is in the packed components
+	std::vector<Ogre::uint32> mSlotIndices;
+	std::vector<Ogre::uint16> mSlotGenerations;
+	std::vector<Ogre::uint32> mFreeSlots;
+
+	//Looks up the object a collision callback body belongs to
+	std::map<const btCollisionObject *, EntityHandle> mBodyHandles;
+	int mTypeCounts[ENTITY_TYPES];
+
+	//Animated crates, coconuts, targets and blocks, evaluated together each frame
+	PathAnimator mPathAnimator;
+	std::vector<Ogre::uint32> mStoppedPaths;
+
+	//Bounds of every object, for proximity, area and picking queries
+	LooseOctree mSpatialIndex;
+};
+
+#endif
@@ -3,19 +3,30 @@
 
 #include "stdafx.h"
 #include "PGFrameListener.h"
+#include "LevelPack.h"
 
 class PGFrameListener;
+struct Archetype;
 
 class EnvironmentObject {
 
 private:
-	AnimationState *palmAnimation;
+	AnimationState *mAnimationState;
+
+	void create(OgreBulletDynamics::DynamicsWorld *mWorld, SceneManager* mSceneMgr, const Archetype &archetype, const Vector3 *collisionSize);
 
 public:
+	//Collision shape used for each kind of object
+	enum ShapeType {
+		SHAPE_BOX = 0,
+		SHAPE_CYLINDER,
+		SHAPE_SPHERE,
+		SHAPE_TRIMESH
+	};
+
 	//All the class variables needed for storing data about each object
 	//Rigid-body specific variables
 	OgreBulletDynamics::RigidBody* mBody;
-	String mName;
 	String mMesh;
 	Vector3 mPosition;
 	Quaternion mOrientation;
@@ -23,6 +34,7 @@ public:
 	float mRestitution;
 	float mFriction;
 	float mMass;
+	ShapeType mShape;
 	//Object animation variables
 	int mAnimated;
 	float mXMovement;
@@ -36,20 +48,13 @@ public:
 	int mBillBoard;
 	SceneNode* mBillNode;
 	MovableText* mText;
-	double mTextAnim;
-	bool mTextBool;
-	Vector3 mTextPos;
-	//Whether a target has been hit
-	bool counted;
 
 	//Class methods
-	EnvironmentObject(PGFrameListener* frameListener, OgreBulletDynamics::DynamicsWorld *mWorld, int mNumEntitiesInstanced, SceneManager* mSceneMgr, std::string object[24]);
+	EnvironmentObject(PGFrameListener* frameListener, OgreBulletDynamics::DynamicsWorld *mWorld, SceneManager* mSceneMgr, const Archetype &archetype, std::string object[24]);
+	EnvironmentObject(PGFrameListener* frameListener, OgreBulletDynamics::DynamicsWorld *mWorld, SceneManager* mSceneMgr, const Archetype &archetype, const LevelObjectRecord &record, const LevelPack &pack);
 	~EnvironmentObject();
-	void move(float spinTime, double evtTime);
-	bool targetHit();
-	bool targetCounted();
 	OgreBulletDynamics::RigidBody *getBody();
-	AnimationState* getPalmAnimation();
+	AnimationState* getAnimationState() const;
 };
 
 #endif
\ No newline at end of file
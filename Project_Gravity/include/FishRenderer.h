@@ -0,0 +1,47 @@
+#ifndef __FISHRENDERER_h_
+#define __FISHRENDERER_h_
+
+#include "stdafx.h"
+
+/* Header file for FishRenderer class.
+ * Lists all class variables and methods */
+class FishRenderer {
+public:
+	//Fish are split into one instanced batch set per material
+	enum Variant {
+		FISH_NORMAL = 0,
+		FISH_BLUE,
+		FISH_VARIANTS
+	};
+
+	//Class methods
+	FishRenderer(SceneManager* sceneMgr);
+	~FishRenderer();
+	void build(const std::vector<Variant> &variants);
+	void destroy(void);
+	void update(void);
+	void setTransform(int fish, const Vector3 &position, const Quaternion &orientation);
+	void setVisible(int fish, bool visible);
+	const AxisAlignedBox& getFishBounds(void) const;
+	static String getDeadMaterial(Variant variant);
+
+private:
+	void bakeSwimAnimation(void);
+	MeshPtr createStaticMesh(void);
+	void setupMaterial(const String &material);
+	void buildVariant(Variant variant, const std::vector<int> &fish);
+
+	SceneManager* mSceneMgr;
+	InstancedGeometry* mBatches[FISH_VARIANTS];
+	std::vector<InstancedGeometry::BatchInstance *> mBatchInstances;
+	//Per fish instance data, indexed by fish number
+	std::vector<InstancedGeometry::InstancedObject *> mInstances;
+	std::vector<bool> mVisible;
+	AxisAlignedBox mFishBounds;
+	TexturePtr mSwimTexture;
+	Vector4 mSwimParams;		//Width, rows per frame, frames and height of the swim texture
+	Real mCycleRate;			//Swim cycles per second
+	int mFishCount;
+};
+
+#endif
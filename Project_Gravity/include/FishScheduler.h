@@ -0,0 +1,43 @@
+#ifndef __FISHSCHEDULER_h_
+#define __FISHSCHEDULER_h_
+
+#include "stdafx.h"
+
+/* Header file for FishScheduler class.
+ * Lists all class variables and methods */
+class FishScheduler {
+public:
+	//How often a fish's flocking and movement get updated, the swim cycle plays on the GPU whatever the tier
+	enum Tier {
+		TIER_NEAR = 0,
+		TIER_MID,
+		TIER_FAR,
+		TIER_COUNT
+	};
+
+	//Class methods
+	FishScheduler();
+	~FishScheduler();
+	void loadSettings(const String &fileName);
+	void reset(int fishCount);
+	void schedule(Camera* camera, const std::vector<Vector3> &positions, const std::vector<bool> &active);
+	Tier getTier(int fish) const;
+	bool isUpdateFrame(int fish) const;
+	bool wasFrozen(int fish) const;
+	int getTierCount(Tier tier) const;
+
+	//Scheduling budgets, loaded from Fish.cfg
+	Real mNearDistance;
+	Real mFarDistance;
+	int mMidInterval;
+	int mNearBudget;
+
+private:
+	std::vector<Tier> mTiers;
+	std::vector<Tier> mLastTiers;
+	std::vector<std::pair<Real, int> > mNearCandidates;
+	int mTierCounts[TIER_COUNT];
+	unsigned long mFrame;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef __FISHSCHOOL_h_
+#define __FISHSCHOOL_h_
+
+#include "stdafx.h"
+#include "FishRenderer.h"
+#include "RandomStream.h"
+
+/* A school of fish declared in a level's fish file.
+ * Lists where the school spawns, what it looks like and where it may swim */
+struct FishSchool {
+	int count;
+	Vector3 spawnCentre;
+	Real spawnSpread;
+	String variant; //Normal, Blue or Mixed (every third fish blue)
+	Real minX;
+	Real minZ;
+	Real maxX;
+	Real maxZ;
+	//Live fish in the school, used to average the flocking forces
+	int alive;
+
+	FishRenderer::Variant getVariant(int fishInSchool) const;
+	static void loadSchools(const String &fileName, std::vector<FishSchool> &schools);
+};
+
+/* Everything needed to simulate one fish.
+ * Fish are pooled and reused from level to level */
+struct Fish {
+	OgreBulletDynamics::RigidBody* body;		//Swimming sphere body
+	OgreBulletDynamics::RigidBody* deadBody;	//Box body swapped in once the fish dies
+	OgreBulletCollisions::BoxCollisionShape* deadShape;
+	SceneNode* node;							//Orientation of the swimming fish
+	SceneNode* deadNode;
+	Entity* deadEntity;
+	bool bodyInWorld;
+	bool deadBodyInWorld;
+	bool active;								//Used by the current level
+	bool dead;
+	int school;
+	FishRenderer::Variant variant;
+	float lastMove;
+	Vector3 lastDirection;
+	RandomStream random;
+
+	Fish();
+	OgreBulletDynamics::RigidBody* getBody(void) const;
+};
+
+#endif
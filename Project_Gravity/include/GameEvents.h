@@ -0,0 +1,47 @@
+#ifndef __GAMEEVENTS_h_
+#define __GAMEEVENTS_h_
+
+#include "stdafx.h"
+
+/* Header file for GameEvents class.
+ * Lists all class variables and methods */
+class GameEvents {
+public:
+	//Things that happen to level objects during play
+	enum EventType {
+		EVENT_COCONUT_COLLECTED = 0,	//Player touched a collectable coconut
+		EVENT_TARGET_HIT,				//Projectile hit a target, its restitution holds the accuracy
+		EVENT_BLOCK_GROUNDED,			//Orange or blue block touched the ground
+		EVENT_RED_HIT,					//Projectile hit a red block
+		EVENT_TYPES
+	};
+
+	//One event, body is the level object it happened to
+	struct Event {
+		EventType type;
+		const btCollisionObject* body;
+	};
+
+	//Implemented by anything that reacts to events
+	class Listener {
+	public:
+		virtual ~Listener() {}
+		virtual void gameEvent(const Event &event) = 0;
+	};
+
+	//Class methods
+	GameEvents();
+	~GameEvents();
+	void subscribe(EventType type, Listener* listener);
+	void unsubscribe(Listener* listener);
+	void publish(EventType type, const btCollisionObject* body);
+	bool dispatch(void);
+	void clear(void);
+
+private:
+	std::vector<Event> mQueue;			//Published during the physics step, delivered afterwards
+	std::vector<Event> mDelivering;		//Events being handed out, a handler may publish more
+	std::vector<Listener *> mListeners[EVENT_TYPES];
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef __HUDLAYER_h_
+#define __HUDLAYER_h_
+
+#include "stdafx.h"
+#include "MovableText.h"
+
+/* Header file for HUDLayer class.
+ * Lists all class variables and methods */
+class HUDLayer : public SimpleRenderable {
+public:
+	//Longest text a field can hold
+	static const int MAX_FIELD_CHARS = 32;
+
+	//Class methods
+	HUDLayer(const String &fontName, Viewport* viewport);
+	~HUDLayer();
+	int addField(Real x, Real y, Real charHeight, const ColourValue &colour, int capacity);
+	void build(void);
+	void setText(int field, const char* text);
+	void setNumber(int field, const char* label, int number);
+	void setTime(int field, unsigned long milliseconds);
+	void setFieldVisible(int field, bool visible);
+
+	//From SimpleRenderable
+	Real getSquaredViewDepth(const Camera* cam) const;
+	Real getBoundingRadius(void) const;
+	void _updateRenderQueue(RenderQueue* queue);
+
+private:
+	//A piece of text with its own fixed run of quads in the vertex buffer
+	struct Field {
+		Real x;					//Centre of the text's bottom edge, -1 to 1 across the screen
+		Real y;
+		Real charHeight;		//Screen heights are 2
+		ColourValue colour;
+		int capacity;
+		size_t firstVertex;
+		bool visible;
+		bool dirty;
+		char text[MAX_FIELD_CHARS + 1];
+	};
+
+	void changeText(int field, const char* text);
+	void writeField(int field);
+	static int formatNumber(char* out, int number);
+
+	Font* mFont;
+	const MovableText::GlyphCache* mGlyphs;	//Shared with the MovableTexts using the same font
+	Viewport* mViewport;		//Text is kept the same shape whatever the viewport's aspect ratio
+	Real mScreenAspect;
+	std::vector<Field> mFields;
+	std::vector<float> mScratch;	//One field's vertices, built here and written to the card in one go
+	size_t mVertexCount;
+};
+
+#endif
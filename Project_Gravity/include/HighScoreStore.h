@@ -0,0 +1,59 @@
+#ifndef __HIGHSCORESTORE_h_
+#define __HIGHSCORESTORE_h_
+
+#include "stdafx.h"
+#include "BackgroundWriter.h"
+
+/* One finished run, as stored in the high score file */
+struct HighScoreEntry {
+	float score;
+	Ogre::uint32 timeMillis;
+	Ogre::int32 coconuts;
+	Ogre::uint32 reserved;
+};
+
+/* Header file for HighScoreStore class.
+ * Lists all class variables and methods */
+class HighScoreStore {
+public:
+	//Entries kept per level, the file layout depends on it
+	static const unsigned int TOP_ENTRIES = 10;
+	//Bump whenever HighScoreEntry or the file layout changes
+	static const Ogre::uint32 VERSION = 1;
+
+	//Class methods
+	HighScoreStore(BackgroundWriter* writer, const String &fileName);
+	~HighScoreStore();
+	void load(void);
+	float getBest(int levelId) const;
+	unsigned int getEntryCount(int levelId) const;
+	const HighScoreEntry& getEntry(int levelId, unsigned int rank) const;
+	int submit(int levelId, float score, double timeMillis, int coconuts);
+
+private:
+	//Start of the file
+	struct Header {
+		char magic[4];
+		Ogre::uint32 version;
+		Ogre::uint32 tableCount;
+		Ogre::uint32 entriesPerTable;
+	};
+
+	//Each level's table, tables follow the header sorted by level id
+	struct Table {
+		Ogre::int32 levelId;
+		Ogre::uint32 count;
+		HighScoreEntry entries[TOP_ENTRIES];
+	};
+
+	bool loadTables(void);
+	void importTextScores(void);
+	void save(void);
+	const Table* findTable(int levelId) const;
+
+	BackgroundWriter* mWriter;
+	String mFileName;
+	std::map<int, Table> mTables;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __IMPOSTORRENDERER_h_
+#define __IMPOSTORRENDERER_h_
+
+#include "stdafx.h"
+
+/* Header file for ImpostorRenderer class.
+ * Lists all class variables and methods */
+class ImpostorRenderer {
+public:
+	//Class methods
+	ImpostorRenderer(SceneManager* sceneMgr);
+	~ImpostorRenderer();
+	void loadSettings(const String &fileName);
+	bool hasImpostor(const String &mesh) const;
+	int addGroup(void);
+	void add(int group, const String &mesh, const Vector3 &position, const Quaternion &orientation, const Vector3 &scale);
+	void clearGroup(int group);
+	void clear(void);
+	void update(const Camera* camera);
+	bool isNear(int group) const;
+
+private:
+	//Views of one mesh from evenly spread directions, side by side in one texture
+	struct Atlas {
+		Quaternion bakeRotation;	//Turns the mesh so the axis that is up in the level points up while baking
+		Vector3 centre;				//Middle of the mesh once turned, in mesh units
+		Real width;
+		Real height;
+		BillboardSet* billboards;
+	};
+
+	//A billboard standing in for one object
+	struct Impostor {
+		Billboard* billboard;
+		BillboardSet* billboards;	//The mesh's atlas set the billboard belongs to
+		Vector3 centre;
+		Quaternion toBakeFrame;		//Turns world directions into the frame the atlas was baked in
+		Real width;
+		Real height;
+	};
+
+	//Objects whose meshes are swapped for billboards together, all of a batch or static geometry cell
+	struct Group {
+		std::vector<Impostor> impostors;
+		AxisAlignedBox bounds;
+		Real fade;					//0 while only the meshes are drawn, 1 once only the billboards are
+		bool shown;					//Whether the billboards have their size
+	};
+
+	Atlas& getAtlas(const String &mesh, const Quaternion &orientation);
+	void bake(const String &mesh, Atlas &atlas);
+
+	SceneManager* mSceneMgr;
+	SceneManager* mBakeSceneMgr;	//Only holds the mesh being baked, so nothing from the level gets in the atlas
+	Camera* mBakeCamera;
+	SceneNode* mBillboardNode;
+	std::map<String, Atlas> mAtlases;
+	std::vector<Group> mGroups;
+	StringVector mMeshes;
+
+	//Settings
+	Real mDistance;
+	Real mFadeRange;
+	int mAngles;
+	int mTileSize;
+};
+
+#endif
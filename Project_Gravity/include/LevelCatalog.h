@@ -0,0 +1,45 @@
+#ifndef __LEVELCATALOG_h_
+#define __LEVELCATALOG_h_
+
+#include "stdafx.h"
+#include "BackgroundWriter.h"
+
+/* What the menus need to know about one custom level, without opening its files */
+struct LevelCatalogEntry {
+	int id;					//N in UserLevelNObjects.txt
+	int island;
+	int objectCount;
+	Ogre::uint32 fileSize;	//Size of the objects file
+	Ogre::uint32 modified;	//Seconds since 1970 the objects file was last written
+};
+
+/* Header file for LevelCatalog class.
+ * Lists all class variables and methods */
+class LevelCatalog {
+public:
+	//Class methods
+	LevelCatalog(BackgroundWriter* writer, const String &directory);
+	~LevelCatalog();
+	void load(void);
+	unsigned int getCount(void) const;
+	const LevelCatalogEntry& getEntry(unsigned int i) const;
+	const LevelCatalogEntry* find(int id) const;
+	int getNextId(void) const;
+	void add(int id, int island, const String &objectText);
+	static int countObjects(const char* data, size_t size);
+
+private:
+	bool readIndex(void);
+	bool scan(void);
+	bool readLevel(int id, LevelCatalogEntry &entry) const;
+	void insert(const LevelCatalogEntry &entry);
+	void save(void);
+	String getLevelFile(int id, const String &suffix) const;
+	static Ogre::uint32 toUnixTime(const FILETIME &time);
+
+	BackgroundWriter* mWriter;
+	String mDirectory;
+	std::vector<LevelCatalogEntry> mEntries;	//Sorted by id
+};
+
+#endif
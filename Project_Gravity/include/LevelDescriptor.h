@@ -0,0 +1,64 @@
+#ifndef __LEVELDESCRIPTOR_h_
+#define __LEVELDESCRIPTOR_h_
+
+#include "stdafx.h"
+
+/* One win or lose condition, counting level objects of a category */
+struct LevelObjective {
+	String category;		//Archetype category, e.g. target or orange
+	int amount;				//How many are needed, ALL_OBJECTS for every one in the level
+	bool lose;				//Meeting it fails the level rather than winning it
+	bool aboveHeight;		//Counts objects lifted above a height instead of objects hit
+	Real height;
+
+	static const int ALL_OBJECTS = -1;
+};
+
+/* Header file for LevelDescriptor class.
+ * Lists all class variables and methods */
+class LevelDescriptor {
+public:
+	//Which sky a level is lit by
+	enum SkySystem {
+		SKY_CAELUM = 0,
+		SKY_CAELUM_CLOUDS,
+		SKY_SKYX
+	};
+
+	//Everything that differs between islands
+	int mLevel;					//0 if no descriptor file was read
+	String mIslandConfig;
+	String mHeightmap;
+	String mOcean;
+	SkySystem mSky;
+	Vector3 mSpawnPosition;
+	Quaternion mSpawnOrientation;
+	Vector3 mSpawnDirection;
+	bool mUseSpawnDirection;
+	int mLevelTime;
+	String mObjectFile;
+	String mFishFile;
+	bool mJengaPlatform;
+	int mNextLevel;
+	int mWinBonus;							//Added to the score on winning, on top of the time bonus
+	std::vector<LevelObjective> mObjectives;	//All win conditions must be met, any lose condition fails the level
+	std::vector<Vector3> mProbes;				//Where reflection probes are baked when probes are used
+	String mPalmDensityMap;						//Where extra palms are scattered, empty for none
+	int mPalmCount;								//Most palms scattered from the density map
+
+	//Assets to load before the level starts
+	StringVector mMeshes;
+	StringVector mMaterials;
+	StringVector mTextures;
+
+	//Class methods
+	LevelDescriptor();
+	~LevelDescriptor();
+	static String getFileName(int level);
+	bool load(int level);
+
+private:
+	void loadObjectives(const StringVector &settings, bool lose);
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __LEVELPACK_h_
+#define __LEVELPACK_h_
+
+#include "stdafx.h"
+#include "MappedFile.h"
+
+/* One level object as stored in a compiled level pack.
+ * Plain data only, so records can be used straight out of the mapped file */
+struct LevelObjectRecord {
+	Ogre::uint16 name;			//String table ids, resolved when the pack is compiled
+	Ogre::uint16 mesh;
+	float position[3];
+	float orientation[4];		//w, x, y, z as in the text files
+	float scale[3];
+	float collisionSize[3];		//Half extents of the scaled mesh bounds
+	float restitution;
+	float friction;
+	float mass;
+	Ogre::int32 animated;
+	float movement[3];
+	float speed;
+	float rotation[3];
+	Ogre::int32 billboard;
+};
+
+/* Header file for LevelPack class.
+ * Lists all class variables and methods */
+class LevelPack {
+public:
+	//Bump whenever LevelObjectRecord or the file layout changes
+	static const Ogre::uint32 VERSION = 3;
+
+	//Class methods
+	LevelPack();
+	~LevelPack();
+	static String getPackFileName(const String &textFile);
+	static bool isStale(const String &textFile, const String &packFile);
+	static bool compile(const String &textFile, const String &packFile);
+	bool open(const String &packFile);
+	void close(void);
+	bool isOpen(void) const;
+	unsigned int getRecordCount(void) const;
+	const LevelObjectRecord& getRecord(unsigned int i) const;
+	unsigned int getStringCount(void) const;
+	const char* getString(Ogre::uint16 id) const;
+
+private:
+	//Start of every pack file
+	struct Header {
+		char magic[4];
+		Ogre::uint32 version;
+		Ogre::uint32 fileSize;
+		Ogre::uint32 recordCount;
+		Ogre::uint32 recordOffset;
+		Ogre::uint32 stringCount;
+		Ogre::uint32 stringOffset;	//Table of offsets into the string data that follows it
+		Ogre::uint32 sourceSize;	//Size and write time of the text file it was compiled from
+		Ogre::uint32 sourceTimeLow;
+		Ogre::uint32 sourceTimeHigh;
+	};
+
+	static bool getSourceStamp(const String &textFile, Ogre::uint32 &size, Ogre::uint32 &timeLow, Ogre::uint32 &timeHigh);
+	static bool isValidHeader(const Header &header, Ogre::uint32 fileSize);
+
+	MappedFile mFile;
+	const char* mData;
+	const Header* mHeader;
+	const LevelObjectRecord* mRecords;
+	const Ogre::uint32* mStringOffsets;
+	const char* mStrings;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef __LEVELPREFETCHER_h_
+#define __LEVELPREFETCHER_h_
+
+#include "stdafx.h"
+#include "LevelDescriptor.h"
+
+/* Header file for LevelPrefetcher class.
+ * Lists all class variables and methods */
+class LevelPrefetcher {
+public:
+	//Class methods
+	LevelPrefetcher();
+	~LevelPrefetcher();
+	void start(const LevelDescriptor &level);
+	void cancel(void);
+	void update(unsigned long budgetMillis);
+	bool isDone(void) const;
+	bool getHeightmap(const String &name, Image &image) const;
+
+private:
+	//One thing to load
+	struct Item {
+		enum Type {
+			ITEM_PACK = 0,
+			ITEM_HEIGHTMAP,
+			ITEM_MESH,
+			ITEM_MATERIAL,
+			ITEM_TEXTURE
+		};
+		Type type;
+		String name;
+	};
+
+	void addItems(Item::Type type, const StringVector &names);
+	void loadItem(const Item &item);
+
+	std::deque<Item> mQueue;
+	Timer mTimer;
+	int mLevel;
+	//The heightmap is read for both the terrain and its collision shape, so the image is kept
+	Image mHeightmap;
+	String mHeightmapName;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef __LEVELTEXTPARSER_h_
+#define __LEVELTEXTPARSER_h_
+
+#include "stdafx.h"
+#include "MappedFile.h"
+
+/* One column of a comma separated level file.
+ * Columns without a default must be present on every line */
+struct LevelColumn {
+	enum Type {
+		COLUMN_STRING = 0,
+		COLUMN_REAL,
+		COLUMN_INT,
+		COLUMN_UINT
+	};
+
+	const char* name;
+	Type type;
+	const char* defaultValue;
+};
+
+/* Header file for LevelTextParser class.
+ * Lists all class variables and methods */
+class LevelTextParser {
+public:
+	//Class methods
+	LevelTextParser(const LevelColumn* columns, int columnCount);
+	~LevelTextParser();
+	bool open(const String &fileName);
+	bool nextLine(void);
+	int getLineNumber(void) const;
+	int getErrorCount(void) const;
+	String getString(int column) const;
+	Real getReal(int column) const;
+	int getInt(int column) const;
+	Ogre::uint32 getUint(int column) const;
+
+private:
+	bool parseLine(const char* begin, const char* end);
+	bool parseField(int column, const char* begin, const char* end);
+	void logProblem(const String &problem) const;
+	static bool parseReal(const char* begin, const char* end, double &value);
+	static bool parseInt(const char* begin, const char* end, int &value);
+	static bool parseUint(const char* begin, const char* end, Ogre::uint32 &value);
+
+	const LevelColumn* mColumns;
+	int mColumnCount;
+	MappedFile mFile;
+	String mFileName;
+	const char* mCursor;
+	const char* mEnd;
+	int mLineNumber;
+	int mErrorCount;
+	//Current line's fields point into the mapped file, or at the column's default
+	std::vector<const char*> mFieldBegin;
+	std::vector<const char*> mFieldEnd;
+	std::vector<double> mNumbers;
+};
+
+#endif
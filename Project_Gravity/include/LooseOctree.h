@@ -0,0 +1,57 @@
+#ifndef __LOOSEOCTREE_h_
+#define __LOOSEOCTREE_h_
+
+#include "stdafx.h"
+
+/* Header file for LooseOctree class.
+ * Lists all class variables and methods */
+class LooseOctree {
+public:
+	//Class methods
+	LooseOctree(const AxisAlignedBox &worldBounds, int maxDepth);
+	~LooseOctree();
+	int insert(Ogre::uint32 owner, const AxisAlignedBox &bounds);
+	void update(int item, const AxisAlignedBox &bounds);
+	void remove(int item);
+	void clear(void);
+	int getCount(void) const;
+	void queryRadius(const Vector3 &centre, Real radius, std::vector<Ogre::uint32> &owners) const;
+	void queryBox(const AxisAlignedBox &box, std::vector<Ogre::uint32> &owners) const;
+	bool queryRay(const Ray &ray, Real maxDistance, Ogre::uint32 &owner, Real &distance) const;
+
+private:
+	//One cell of the tree, children are made when an item first needs them
+	struct Node {
+		AxisAlignedBox looseBounds;		//Twice the size of the cell, so items only depend on their centre
+		Vector3 centre;
+		Real halfSize;
+		int depth;
+		int children[8];
+		std::vector<int> items;
+	};
+
+	//Anything stored in the tree
+	struct Item {
+		AxisAlignedBox bounds;
+		Ogre::uint32 owner;
+		int node;
+		int slot;		//Position in the node's item list
+	};
+
+	int createNode(const Vector3 &centre, Real halfSize, int depth);
+	int findNode(const AxisAlignedBox &bounds);
+	bool fitsNode(int node, const AxisAlignedBox &bounds) const;
+	void link(int item, int node);
+	void unlink(int item);
+	void queryBoxNode(int node, const AxisAlignedBox &box, const Sphere *sphere, std::vector<Ogre::uint32> &owners) const;
+	void queryRayNode(int node, const Ray &ray, Ogre::uint32 &owner, Real &distance, bool &found) const;
+
+	AxisAlignedBox mWorldBounds;
+	int mMaxDepth;
+	std::vector<Node> mNodes;
+	std::vector<Item> mItems;
+	std::vector<int> mFreeItems;
+	int mCount;
+};
+
+#endif
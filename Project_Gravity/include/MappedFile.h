@@ -0,0 +1,31 @@
+#ifndef __MAPPEDFILE_h_
+#define __MAPPEDFILE_h_
+
+#include "stdafx.h"
+
+/* Header file for MappedFile class.
+ * Lists all class variables and methods */
+class MappedFile {
+public:
+	//Class methods
+	MappedFile();
+	~MappedFile();
+	bool open(const String &fileName);
+	void close(void);
+	bool isOpen(void) const;
+	const char* getData(void) const;
+	Ogre::uint32 getSize(void) const;
+
+private:
+	//Not copyable, the handles belong to one object
+	MappedFile(const MappedFile &);
+	MappedFile& operator=(const MappedFile &);
+
+	HANDLE mFile;
+	HANDLE mMapping;
+	const char* mData;
+	Ogre::uint32 mSize;
+	bool mOpen;
+};
+
+#endif
@@ -15,6 +15,7 @@ class MenuScreen {
 public:
 	PGFrameListener* mFrameListener;
 	LevelLoad* mUserLevelLoader;
+	LevelLoad* mCatalogLevelLoader;
 
 	//Required to show loading screen when loading custom levels
 	bool mLoadingScreenCreated;
@@ -39,10 +40,10 @@ public:
 	bool mHighScoresOpen;
 	bool mBackPressedFromMainMenu;
 	
-	//For updating 'User Levels' loader menu when new levels made
-	CEGUI::Window* mScroll;
-	int mNumberOfCustomLevels;
-	int mNewLevelsMade;
+	//'User Levels' loader menu, which shows one page of the level catalog at a time
+	CEGUI::Window* mUserLevelMenu;
+	int mUserLevelPage;
+	int mUserLevelsShown;
 	int mLevelToLoad;
 
 	//Level Aims flags
@@ -91,14 +92,19 @@ public:
 	void loadEditorSelectorMenu(void);
 	void loadLevelSelectorMenu(void); 
 	void loadUserLevelSelectorMenu(void);
+	void showUserLevelPage(int page);
 	void loadControlsScreen(void);
 	void loadHighScoresScreen(void);
+	String getHighScoreTable(int level);
 
 	//Methods for dealing with on-click button events
 	bool newGame(const CEGUI::EventArgs& e);
 	bool launchEditMode(const CEGUI::EventArgs& e);
 	bool loadLevelPressed(const CEGUI::EventArgs& e);
 	bool loadUserLevelPressed(const CEGUI::EventArgs& e);
+	bool userLevelRowPressed(const CEGUI::EventArgs& e);
+	bool userLevelPreviousPressed(const CEGUI::EventArgs& e);
+	bool userLevelNextPressed(const CEGUI::EventArgs& e);
 	bool levelBackPressed(const CEGUI::EventArgs& e);
 	bool exitGamePressed(const CEGUI::EventArgs& e);
 	bool inGameResumePressed(const CEGUI::EventArgs& e);
@@ -20,6 +20,13 @@ class MovableText : public MovableObject, public Renderable
 public:
     enum HorizontalAlignment    {H_LEFT, H_CENTER};
     enum VerticalAlignment      {V_BELOW, V_ABOVE, V_CENTER};
+
+    // Glyph texture coordinates and widths, looked up once per font and shared by every text using it
+    struct GlyphCache
+    {
+        Font::UVRect    uvs[256];
+        Real            aspectRatios[256];
+    };
  
 protected:
     String            mFontName;
@@ -53,6 +60,16 @@ protected:
     MaterialPtr        mpMaterial;
     MaterialPtr        mpBackgroundMaterial;
  
+    static std::map<String, GlyphCache> msGlyphCaches;
+    const GlyphCache    *mpGlyphs;
+ 
+    // The hardware buffers are kept between captions and only grown, mVertices mirrors what they hold
+    size_t            mVertexCapacity;
+    size_t            mWrittenCount;
+    size_t            mDirtyStart;
+    size_t            mDirtyEnd;
+    std::vector<float>    mVertices;
+ 
     /******************************** public methods ******************************/
 public:
     MovableText(const String &name, const String &caption, const String &fontName, Real charHeight, const ColourValue &color = ColourValue::White);
@@ -72,6 +89,9 @@ public:
     void    setLocalTranslation( Vector3 trans );
     void    showOnTop(bool show=true);
  
+    // Glyphs of a font, also used by the HUD so each font is only looked up once
+    static const GlyphCache *getGlyphCache(Font *font);
+ 
     // Get settings
     const   String          &getFontName() const {return mFontName;}
     const   String          &getCaption() const {return mCaption;}
@@ -90,6 +110,8 @@ protected:
     // from MovableText, create the object
     void    _setupGeometry();
     void    _updateColors();
+    void    _createBuffers(size_t vertexCount);
+    void    _writeVertex(size_t vertex, float x, float y, float u, float v);
  
     // from MovableObject
     void    getWorldTransforms(Matrix4 *xform) const;
@@ -0,0 +1,50 @@
+#ifndef __OBJECTIVETRACKER_h_
+#define __OBJECTIVETRACKER_h_
+
+#include "stdafx.h"
+#include "EntityStore.h"
+#include "LevelDescriptor.h"
+
+/* Header file for ObjectiveTracker class.
+ * Lists all class variables and methods */
+class ObjectiveTracker {
+public:
+	//Where the level stands against its objectives
+	enum State {
+		OBJECTIVES_PLAYING = 0,
+		OBJECTIVES_WON,
+		OBJECTIVES_LOST
+	};
+
+	//Class methods
+	ObjectiveTracker();
+	~ObjectiveTracker();
+	void begin(const std::vector<LevelObjective> &objectives, const EntityStore &entities);
+	void reset(void);
+	bool isTracked(EntityStore::EntityType type) const;
+	void recordHit(EntityStore::EntityType type);
+	bool checkHeights(const EntityStore &entities);
+	State getState(void) const;
+
+private:
+	//A level objective with its category and amount resolved against the loaded level
+	struct Objective {
+		EntityStore::EntityType category;
+		int required;
+		bool lose;
+		Real height;		//Objects only count once they are above this, for height objectives
+	};
+
+	void meet(int objective);
+
+	std::vector<Objective> mObjectives;
+	std::vector<int> mHitObjectives[EntityStore::ENTITY_TYPES];	//Objectives counting hits on each category
+	std::vector<int> mHeightObjectives;		//Objectives on raising objects that haven't been met yet
+	std::vector<EntityHandle> mRaised;		//Reused for the objects found above a height
+	int mHits[EntityStore::ENTITY_TYPES];
+	int mWinsLeft;			//Win objectives not yet met
+	int mLossesMet;			//Lose objectives that have been met
+	bool mHasWin;			//A level without win objectives can't be won
+};
+
+#endif
@@ -4,15 +4,34 @@
 #include "stdafx.h"
 #include "MovableText.h"
 #include "EnvironmentObject.h"
+#include "EntityStore.h"
 #include "LevelLoad.h"
 #include "MenuScreen.h"
+#include "FishRenderer.h"
+#include "FishScheduler.h"
+#include "RandomStream.h"
+#include "FishSchool.h"
+#include "LevelDescriptor.h"
+#include "LevelPrefetcher.h"
+#include "BackgroundWriter.h"
+#include "EditorJournal.h"
+#include "HighScoreStore.h"
+#include "LevelCatalog.h"
+#include "GameEvents.h"
+#include "ObjectiveTracker.h"
+#include "ReflectionUpdater.h"
+#include "HUDLayer.h"
+#include "ImpostorRenderer.h"
+#include "PropBatcher.h"
+#include "VegetationRenderer.h"
 
 class EnvironmentObject;
 class LevelLoad;
 class MenuScreen;
+class ArchetypeRegistry;
+struct Archetype;
 
 #define WIN32_LEAN_AND_MEAN
-const int NUM_FISH = 60;
 
 class PGFrameListener : 
 	public Ogre::FrameListener, 
@@ -22,7 +41,8 @@ class PGFrameListener :
 	public Ogre::RenderTargetListener,
 	public Hydrax::RttManager::RttListener,
 	public Ogre::SceneManager::Listener,
-	public Ogre::CompositorInstance::Listener
+	public Ogre::CompositorInstance::Listener,
+	public GameEvents::Listener
 {
 private:
 	SceneManager* mSceneMgr; 
@@ -41,7 +61,8 @@ private:
 	SceneNode *sunNode;
 	float stepTime;
 	Ogre::Timer* timer;	//Timer
-	bool spotOn;
+	Ogre::Light* mSpotLight;	//Torch used in SkyX levels, NULL when there isn't one
+	Ogre::Light* mShadowLight;	//SkyX's shadow caster, NULL when not created
 	
 	//Is level complete?
 	bool levelComplete;
@@ -56,6 +77,7 @@ private:
 	
 	Real mMoveSpeed;
 	Overlay* mDebugOverlay;
+	OverlayElement* mDebugTextElement;
 	float mMoveScale;
 	float mSpeedLimit;
 	Degree mRotScale;
@@ -108,17 +130,30 @@ private:
 	std::deque<OgreBulletDynamics::RigidBody *>         mBodies;
 	std::deque<OgreBulletCollisions::CollisionShape *>  mShapes;
 	std::deque<OgreBulletDynamics::RigidBody *>  levelProjectiles;
-	OgreBulletDynamics::RigidBody*				        mFish[NUM_FISH];
-	Ogre::SceneNode*									mFishNodes[NUM_FISH];
-	Ogre::Entity*										mFishEnts[NUM_FISH];
-	bool												mFishDead[NUM_FISH];
-	float												mFishLastMove[NUM_FISH];
-	Vector3												mFishLastDirection[NUM_FISH];
-	Ogre::AnimationState*								mFishAnim[NUM_FISH];
+	std::vector<Fish>									mFish;
+	std::vector<FishSchool>								mFishSchools;
+	FishRenderer*										mFishRenderer;
+	FishScheduler*										mFishScheduler;
+	std::vector<Vector3>								mFishPositions;
+	std::vector<bool>									mFishActive;
+	RandomStream										mSchoolRandom;
+	Ogre::uint32										mLevelSeed;
+	Real												mSchoolHeadingTime;
+	double												mFishClock;
+	bool												mSchoolRandomMove;
+	Vector3												mSchoolRandomPosition;
 	int													mFishAlive;
 	int													mFishNumber;
 	OgreBulletCollisions::HeightmapCollisionShape *mTerrainShape;
 
+	// Per level descriptors, read once, and the next level's asset prefetch
+	std::map<int, LevelDescriptor>						mLevelDescriptors;
+	LevelPrefetcher*									mLevelPrefetcher;
+
+	// Saving happens off the game thread, editor work is journaled in case of a crash
+	BackgroundWriter*									mBackgroundWriter;
+	EditorJournal*										mEditorJournal;
+
 	// Gravity gun object selection
 	OgreBulletDynamics::RigidBody *mPickedBody;
 	Ogre::Vector3 mOldPickingPos;
@@ -144,9 +179,7 @@ private:
 	Ogre::SceneNode* pivotNode;
 	Ogre::SceneNode* pivotNodePitch;
 	Ogre::SceneNode* pivotNodeRoll;
-	Camera* mCubeCamera;
-	RenderTarget* mTargets[6];
-	RenderTarget* mTargets2[6];
+	ReflectionUpdater* mGunReflection;	//Gravity gun's cube map
 	Radian fovy;
 	int camAsp;
 	Ogre::Vector3 gunPosBuffer;
@@ -186,40 +219,33 @@ private:
 	int coconutCount;
 	int targetCount;
 	int levelTime;
-	std::deque<EnvironmentObject *> levelBodies;
-	std::deque<EnvironmentObject *> levelCoconuts;
-	std::deque<EnvironmentObject *> levelTargets;
-	std::deque<EnvironmentObject *> levelBlocks;
-	std::deque<EnvironmentObject *> levelPalms;
-	std::deque<EnvironmentObject *> levelOrange;
-	std::deque<EnvironmentObject *> levelBlue;
-	std::deque<EnvironmentObject *> levelRed;
-	std::deque<AnimationState *> levelPalmAnims;
-	//preview objects
-	Ogre::Entity *boxEntity;
-	Ogre::Entity *coconutEntity;
-	Ogre::Entity *targetEntity;
-	Ogre::Entity *blockEntity;
-	Ogre::Entity *palm1Entity;
-	Ogre::Entity *palm2Entity;
-	Ogre::Entity *orangeEntity;
-	Ogre::Entity *blueEntity;
-	Ogre::Entity *redEntity;
+	int winBonus;
+	//Every level object, kept as packed components for the per frame systems
+	EntityStore* mEntities;
+	PropBatcher* mPropBatcher;			//Draws resting level props as static geometry
+	VegetationRenderer* mVegetation;	//Draws the palms instanced
+	ImpostorRenderer* mImpostors;		//Billboards for distant palms and props
+	std::vector<EntityHandle> mNearbyEntities;	//Reused for spatial queries
+	//Coconuts, targets and blocks reported by the collision callback, scored once per frame
+	GameEvents* mGameEvents;
+	bool mCheckLevelEnd;	//Set when a tally changes, so the end of level checks don't run every frame
+	//Win and lose conditions of the current level, from its descriptor
+	ObjectiveTracker* mObjectives;
+	//Every kind of level object, read once from Archetypes.txt
+	ArchetypeRegistry* mArchetypes;
+	//preview objects, one for each editor number key that places something
+	std::vector<Ogre::Entity *> mSpawnPreviews;
 
 	int targetScore;
 	Real mLastPositionLength;
 	Ogre::Real mTimeMultiplier;
 	bool mForceDisableShadows;
-	MovableText* HUDTargetText;
-	MovableText* HUDCoconutText;
-	MovableText* HUDScoreText;
-	MovableText* timerText;
-	String timeString;
-	SceneNode* HUDNode;
-	SceneNode* HUDNode2;
-	SceneNode* HUDNode3;
-	SceneNode* HUDNode4;
-	SceneNode* timerNode;
+	HUDLayer* mHUD;
+	int mHUDTargets;		//Fields of the HUD layer
+	int mHUDCoconuts;
+	int mHUDScore;
+	int mHUDTimer;
+	bool mShowHUD;			//Whether this frame is being played rather than showing a menu
 	double currentTime;
 	double mPausedTime;
 
@@ -242,6 +268,7 @@ private:
     OgreBulletDynamics::RigidBody *platformBody;
 	SceneNode *platformNode;
 	Entity *platformEntity;
+	AnimationState *platformAnim;
 	Ogre::MaterialPtr platformMat;
 	bool beginJenga;
 	bool newPlatformShape;
@@ -273,6 +300,8 @@ public:
 	//Required public for MenuScreen class
 	RenderWindow* mWindow;
 	MenuScreen* mMenus;
+	LevelCatalog* mLevelCatalog; //Custom levels, read by the user level menu
+	HighScoreStore* mHighScores; //Best runs of each level, read by the high scores menu
 	bool freeRoam;
 	int currentLevel; //What is the current level
 	int editingLevel; //Which level is being edited
@@ -291,7 +320,11 @@ public:
 
 	bool frameRenderingQueued(const Ogre::FrameEvent& evt);
 	void worldUpdates(const Ogre::FrameEvent& evt);
-	void checkObjectsForRemoval();
+	void gameEvent(const GameEvents::Event &event);
+	void collectCoconut(int index);
+	void scoreTarget(int index);
+	void scoreBlock(int index);
+	bool isPalmNearPlayer(OgreBulletDynamics::RigidBody* body, Real range);
 
 	void windowResized(Ogre::RenderWindow* rw);
 	void windowClosed(Ogre::RenderWindow* rw);
@@ -305,7 +338,8 @@ public:
 	void createBulletTerrain(void);
 	void changeBulletTerrain(int level);
 	void createRobot(void);
-	void createCaelumSystem(void);
+	void createCaelumSystem(bool clouds);
+	void createSky(LevelDescriptor::SkySystem sky);
 	void createCubeMap();
 	void postRenderTargetUpdate(const RenderTargetEvent& evt);
 	void preRenderTargetUpdate(const RenderTargetEvent& evt);
@@ -319,24 +353,31 @@ public:
 	void moveTargets(double evtTime);
 	void spawnFish(void);
 	void changeLevelFish();
+	void createFish(int i, const Vector3 &position);
+	void resetFish(Fish &fish, const Vector3 &position);
+	void parkFish(Fish &fish);
+	void killFish(int i);
+	void updateFishStats(void);
 
 	//Save and load objects
 	void placeNewObject(int objectType);
 	void saveLevel(void);
-	std::stringstream generateObjectStringForSaving(std::deque<EnvironmentObject *> queue);
+	void saveUserLevel(int island, const String &objectText);
+	void recoverEditorAutosave(void);
+	void waitForSaves(void);
 	int findUniqueName(void);
 	void loadLevel(int levelNo, int islandNo, bool userLevel);
 	void setPlayerPosition(int level);
+	const LevelDescriptor& getLevelDescriptor(int level);
+	void prefetchLevel(int level);
 	void loadLevelIslandAndWater(int levelNo);
 	void loadObjectFile(int levelNo, bool userLevel);
-	void loadLevelObjects(std::string object[24]);
+	EntityHandle loadLevelObjects(EnvironmentObject* newObject, const Archetype &archetype);
+	void selectSpawnType(int objectType);
 	void clearLevel(void) ;
 	void clearObjects(std::deque<OgreBulletDynamics::RigidBody *> &queue);
-	void clearTargets(std::deque<EnvironmentObject *> &queue);
 	void checkLevelEndCondition(void);
-	float getOldHighScore(int level);
-	void saveNewHighScore(int level, float levelScore);
-	void animatePalms(const Ogre::FrameEvent& evt);
+	bool saveNewHighScore(int level, float levelScore);
 
 	// New Terrain
 	void createTerrain(int levelNo);
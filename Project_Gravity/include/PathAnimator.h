@@ -0,0 +1,39 @@
+#ifndef __PATHANIMATOR_h_
+#define __PATHANIMATOR_h_
+
+#include "stdafx.h"
+
+/* Header file for PathAnimator class.
+ * Lists all class variables and methods */
+class PathAnimator {
+public:
+	//Class methods
+	PathAnimator();
+	~PathAnimator();
+	int add(Ogre::uint32 owner, OgreBulletDynamics::RigidBody* body, const Vector3 &home, const Vector3 &movement, Real speed, const Vector3 &rotation);
+	void remove(int path);
+	void clear(void);
+	int getCount(void) const;
+	Ogre::uint32 getOwner(int path) const;
+	void update(double time, float stoppedFriction, std::vector<Ogre::uint32> &stopped);
+
+private:
+	int findGroup(Real speed);
+	void evaluate(void);
+
+	//Path parameters, one element per path, kept packed so they can be evaluated four at a time
+	std::vector<float> mHomeX, mHomeY, mHomeZ;
+	std::vector<float> mMoveX, mMoveY, mMoveZ;
+	std::vector<float> mSines, mCosines;		//This frame's trig, copied from the path's speed group
+	std::vector<float> mX, mY, mZ;				//This frame's positions
+	std::vector<btVector3> mRotations;
+	std::vector<btRigidBody *> mBodies;
+	std::vector<Ogre::uint16> mGroups;
+	std::vector<Ogre::uint32> mOwners;			//Handle of whatever the path belongs to
+
+	//Paths with the same speed share one sine and cosine per frame
+	std::vector<Real> mGroupSpeeds;
+	std::vector<float> mGroupSines, mGroupCosines;
+};
+
+#endif
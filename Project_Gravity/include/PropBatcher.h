@@ -0,0 +1,48 @@
+#ifndef __PROPBATCHER_h_
+#define __PROPBATCHER_h_
+
+#include "stdafx.h"
+#include "EntityStore.h"
+#include "ImpostorRenderer.h"
+
+/* Header file for PropBatcher class.
+ * Lists all class variables and methods */
+class PropBatcher {
+public:
+	//Class methods
+	PropBatcher(SceneManager* sceneMgr, ImpostorRenderer* impostors);
+	~PropBatcher();
+	void build(const EntityStore &entities);
+	void clear(void);
+	void update(void);
+	int getBatchedCount(void) const;
+
+private:
+	//A level object that can be drawn as part of its cell's static geometry while its body is at rest
+	struct Prop {
+		OgreBulletDynamics::RigidBody* body;
+		Entity* entity;
+		int cell;
+		bool resting;			//Body is static or asleep, so the prop belongs in the static geometry
+		bool inGeometry;		//Prop is currently baked into its cell's static geometry
+	};
+
+	//A square of the level, with its own static geometry so one prop waking only rebuilds one cell
+	struct Cell {
+		StaticGeometry* geometry;
+		int impostorGroup;		//Billboards drawn instead of the geometry when the cell is far away
+		bool dirty;
+		bool urgent;			//A prop has left, so the geometry shows it in the wrong place until rebuilt
+	};
+
+	Cell& getCell(int key);
+	void rebuild(int key, Cell &cell);
+
+	SceneManager* mSceneMgr;
+	ImpostorRenderer* mImpostors;
+	std::vector<Prop> mProps;
+	std::map<int, Cell> mCells;
+	int mBatchedCount;
+};
+
+#endif
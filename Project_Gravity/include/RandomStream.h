@@ -0,0 +1,74 @@
+#ifndef __RANDOMSTREAM_h_
+#define __RANDOMSTREAM_h_
+
+#include "stdafx.h"
+
+/* Small, fast random number generator (xoshiro128**).
+ * Each entity gets its own stream, derived from a level seed and a stream number,
+ * so the same level always plays out the same way and no state is shared between entities.
+ */
+class RandomStream
+{
+public:
+	RandomStream(Ogre::uint32 seed = 0, Ogre::uint32 stream = 0)
+	{
+		reseed(seed, stream);
+	}
+
+	//Restarts the stream, the same seed and stream always give the same numbers
+	void reseed(Ogre::uint32 seed, Ogre::uint32 stream)
+	{
+		Ogre::uint32 state = seed ^ (stream * 0x9E3779B9u);
+		for (int i = 0; i < 4; i++)
+			mState[i] = splitMix(state);
+	}
+
+	//Next raw 32 bit value
+	Ogre::uint32 next(void)
+	{
+		const Ogre::uint32 result = rotl(mState[1] * 5, 7) * 9;
+		const Ogre::uint32 t = mState[1] << 9;
+
+		mState[2] ^= mState[0];
+		mState[3] ^= mState[1];
+		mState[1] ^= mState[2];
+		mState[0] ^= mState[3];
+		mState[2] ^= t;
+		mState[3] = rotl(mState[3], 11);
+
+		return result;
+	}
+
+	//Integer in [0, range)
+	int nextInt(int range)
+	{
+		if (range <= 0)
+			return 0;
+		return (int) (((Ogre::uint64) next() * (Ogre::uint32) range) >> 32);
+	}
+
+	//Real in [0, 1)
+	Ogre::Real nextReal(void)
+	{
+		return (next() >> 8) * (1.0f / 16777216.0f);
+	}
+
+private:
+	static Ogre::uint32 rotl(Ogre::uint32 x, int k)
+	{
+		return (x << k) | (x >> (32 - k));
+	}
+
+	//Spreads a seed out into well mixed state words
+	static Ogre::uint32 splitMix(Ogre::uint32 &state)
+	{
+		Ogre::uint32 z = (state += 0x9E3779B9u);
+		z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+		z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+		return z ^ (z >> 16);
+	}
+
+	Ogre::uint32 mState[4];
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef __REFLECTIONUPDATER_h_
+#define __REFLECTIONUPDATER_h_
+
+#include "stdafx.h"
+
+//Visibility flag of everything drawn in the gun's reflection, small moving objects and the HUD have it cleared
+const Ogre::uint32 VISIBLE_IN_REFLECTION = 1 << 1;
+
+/* Header file for ReflectionUpdater class.
+ * Lists all class variables and methods */
+class ReflectionUpdater {
+public:
+	static const int FACES = 6;
+
+	//Where the reflection comes from
+	enum Mode {
+		MODE_LIVE = 0,		//Cube map rendered from the camera as it moves
+		MODE_PROBES			//Cube maps baked at fixed points when the level loads, blended by position
+	};
+
+	//Class methods
+	ReflectionUpdater();
+	~ReflectionUpdater();
+	void loadSettings(const String &fileName);
+	void create(const String &textureName, const String &materialName, SceneManager* sceneMgr, Camera* viewCamera, RenderTargetListener* listener);
+	void setProbes(const std::vector<Vector3> &positions);
+	void invalidate(void);
+	int update(Real timeSinceLastFrame);
+	int getFacesRendered(void) const;
+
+	//Update budgets, loaded from Reflection.cfg
+	Mode mMode;
+	int mResolution;			//Size of each cube face in pixels
+	int mFacesPerFrame;			//Most faces rendered in one frame
+	Real mMoveThreshold;		//Distance the camera moves before every face is rendered again
+	Real mRefreshInterval;		//Seconds before a face is rendered again even if the camera stays put
+	Real mCullDistance;			//Objects further away than this are left out of the reflection
+	Real mLodBias;				//Mesh and material detail relative to the main view
+	int mProbeResolution;		//Size of each baked probe face in pixels
+
+private:
+	void renderFace(RenderTarget* target, int face);
+	void setupTarget(RenderTarget* target);
+	void bakeProbes(void);
+	void blendProbes(const Vector3 &position);
+
+	Camera* mViewCamera;		//Player's camera, the cube is rendered from where it is
+	Camera* mCubeCamera;
+	Frustum* mCullFrustum;		//Short range frustum the cube camera culls with, so the sky still fits in its far clip
+	SceneNode* mCubeNode;		//Holds the cube camera and its culling frustum, turned to face each side of the cube
+	RenderTargetListener* mListener;
+
+	//Live cube map
+	RenderTarget* mTargets[FACES];
+	Real mFaceAge[FACES];		//Seconds since each face was rendered
+	bool mFaceStale[FACES];
+	int mNextFace;				//Where the round robin carries on from
+	Vector3 mRenderedFrom;		//Camera position the current faces were rendered from
+	bool mValid;				//False until every face has been rendered once
+	int mFacesRendered;			//Faces rendered last frame, for the debug overlay
+
+	//Baked probes, textures are kept between levels and only added to when a level has more probes
+	std::vector<Vector3> mProbePositions;
+	std::vector<TexturePtr> mProbeTextures;
+	bool mProbesBaked;
+	int mNearProbes[2];			//Probes the material is showing, -1 before the first blend
+	TextureUnitState* mProbeUnits[2];	//First probe, then the second one blended over it
+};
+
+#endif
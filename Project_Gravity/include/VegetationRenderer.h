@@ -0,0 +1,44 @@
+#ifndef __VEGETATIONRENDERER_h_
+#define __VEGETATIONRENDERER_h_
+
+#include "stdafx.h"
+#include "EntityStore.h"
+#include "ImpostorRenderer.h"
+
+/* Header file for VegetationRenderer class.
+ * Lists all class variables and methods */
+class VegetationRenderer {
+public:
+	//Class methods
+	VegetationRenderer(SceneManager* sceneMgr, ImpostorRenderer* impostors);
+	~VegetationRenderer();
+	void addPalms(const EntityStore &entities);
+	void scatter(const String &densityMap, int count, TerrainGroup* terrain, Ogre::uint32 seed);
+	void build(void);
+	void clear(void);
+	void update(void);
+
+private:
+	//Where one palm is drawn
+	struct Instance {
+		Vector3 position;
+		Quaternion orientation;
+		Vector3 scale;
+		int cell;			//Palms are sorted by cell so each batch covers a small area and can be culled
+	};
+
+	void add(const String &mesh, const Vector3 &position, const Quaternion &orientation, const Vector3 &scale);
+	void buildMesh(const String &mesh, std::vector<Instance> &instances);
+	MeshPtr getStaticMesh(const String &mesh);
+	static bool compareCells(const Instance &a, const Instance &b);
+
+	SceneManager* mSceneMgr;
+	ImpostorRenderer* mImpostors;
+	std::map<String, std::vector<Instance> > mInstances;	//Palms waiting for build, by mesh
+	std::vector<InstancedGeometry *> mBatches;
+	std::vector<InstancedGeometry::BatchInstance *> mBatchInstances;
+	std::vector<int> mImpostorGroups;						//Billboard group of each batch instance, -1 if it has none
+	std::vector<Entity *> mHiddenEntities;					//Level palms drawn by the batches instead
+};
+
+#endif
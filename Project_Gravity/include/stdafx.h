@@ -23,6 +23,7 @@
 #include "OgreCompositorLogic.h"
 #include "OgreCompositorInstance.h"
 #include "OgreTimer.h"
+#include "OgreNameGenerator.h"
 
 #include <OgreCamera.h>
 #include <OgreEntity.h>
@@ -0,0 +1,170 @@
+#include "stdafx.h"
+#include "ArchetypeRegistry.h"
+#include "LevelTextParser.h"
+
+/* Holds one archetype per kind of level object, read once from Archetypes.txt.
+ * Shape, category and mass rules are parsed into enums and numbers up front and every mesh is loaded
+ * and measured here, so spawning an object is a lookup rather than a chain of name comparisons.
+ */
+
+//Columns of the archetype file, in file order
+const LevelColumn ARCHETYPE_COLUMNS[] = {
+	{ "key",			LevelColumn::COLUMN_STRING,	NULL },
+	{ "name",			LevelColumn::COLUMN_STRING,	NULL },
+	{ "mesh",			LevelColumn::COLUMN_STRING,	NULL },
+	{ "material",		LevelColumn::COLUMN_STRING,	"" },
+	{ "shape",			LevelColumn::COLUMN_STRING,	"box" },
+	{ "category",		LevelColumn::COLUMN_STRING,	"crate" },
+	{ "mass",			LevelColumn::COLUMN_REAL,	"0" },
+	{ "friction",		LevelColumn::COLUMN_REAL,	"0.5" },
+	{ "bodyMass",		LevelColumn::COLUMN_REAL,	"-1" },
+	{ "bodyFriction",	LevelColumn::COLUMN_REAL,	"-1" },
+	{ "editorFriction",	LevelColumn::COLUMN_REAL,	"-1" },
+	{ "editorSlot",		LevelColumn::COLUMN_INT,	"0" }
+};
+const int ARCHETYPE_COLUMN_COUNT = sizeof(ARCHETYPE_COLUMNS) / sizeof(ARCHETYPE_COLUMNS[0]);
+
+//Names used for shapes and categories in the archetype file, in enum order
+const char* SHAPE_NAMES[] = { "box", "cylinder", "sphere", "trimesh" };
+const char* CATEGORY_NAMES[] = { "crate", "coconut", "target", "block", "palm", "orange", "blue", "red" };
+
+//Constructor
+ArchetypeRegistry::ArchetypeRegistry()
+{
+	for (int i = 0; i < EDITOR_SLOTS; i++)
+		mEditorSlots[i] = -1;
+
+	//Anything unknown behaves like a crate
+	mFallback.key = "Crate";
+	mFallback.name = "Crate";
+	mFallback.mesh = "Crate.mesh";
+	mFallback.shape = EnvironmentObject::SHAPE_BOX;
+	mFallback.category = EntityStore::ENTITY_CRATE;
+	mFallback.mass = 0;
+	mFallback.friction = 0.9f;
+	mFallback.bodyMass = -1;
+	mFallback.bodyFriction = -1;
+	mFallback.editorFriction = -1;
+	mFallback.editorSlot = 0;
+	mFallback.halfSize = Vector3::ZERO;
+}
+
+//Destructor
+ArchetypeRegistry::~ArchetypeRegistry()
+{
+}
+
+//Reads every archetype from the file, bad lines are logged and skipped
+void ArchetypeRegistry::load(const String &fileName)
+{
+	mArchetypes.clear();
+	mByName.clear();
+	for (int i = 0; i < EDITOR_SLOTS; i++)
+		mEditorSlots[i] = -1;
+
+	LevelTextParser parser(ARCHETYPE_COLUMNS, ARCHETYPE_COLUMN_COUNT);
+	parser.open(fileName);
+	while (parser.nextLine())
+	{
+		Archetype archetype;
+		archetype.key = parser.getString(0);
+		archetype.name = parser.getString(1);
+		archetype.mesh = parser.getString(2);
+		archetype.material = parser.getString(3);
+		if (!parseShape(parser.getString(4), archetype.shape) || !parseCategory(parser.getString(5), archetype.category))
+		{
+			LogManager::getSingleton().logMessage("ArchetypeRegistry: unknown shape or category for " + archetype.key
+				+ " on line " + StringConverter::toString(parser.getLineNumber()) + " of " + fileName);
+			continue;
+		}
+		archetype.mass = parser.getReal(6);
+		archetype.friction = parser.getReal(7);
+		archetype.bodyMass = parser.getReal(8);
+		archetype.bodyFriction = parser.getReal(9);
+		archetype.editorFriction = parser.getReal(10);
+		archetype.editorSlot = parser.getInt(11);
+		archetype.halfSize = getHalfSize(archetype.mesh);
+
+		unsigned int index = mArchetypes.size();
+		mArchetypes.push_back(archetype);
+		if (mByName.find(archetype.name) == mByName.end())
+			mByName[archetype.name] = index;
+		if (archetype.editorSlot > 0 && archetype.editorSlot < EDITOR_SLOTS)
+			mEditorSlots[archetype.editorSlot] = index;
+	}
+
+	LogManager::getSingleton().logMessage("ArchetypeRegistry: loaded " + StringConverter::toString(mArchetypes.size())
+		+ " archetypes from " + fileName);
+}
+
+//Turns a shape name from the file into its enum
+bool ArchetypeRegistry::parseShape(const String &text, EnvironmentObject::ShapeType &shape)
+{
+	for (int i = 0; i < (int) (sizeof(SHAPE_NAMES) / sizeof(SHAPE_NAMES[0])); i++)
+	{
+		if (text == SHAPE_NAMES[i])
+		{
+			shape = (EnvironmentObject::ShapeType) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+//Turns a category name from the file into its enum
+bool ArchetypeRegistry::parseCategory(const String &text, EntityStore::EntityType &category)
+{
+	for (int i = 0; i < EntityStore::ENTITY_TYPES; i++)
+	{
+		if (text == CATEGORY_NAMES[i])
+		{
+			category = (EntityStore::EntityType) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+//Loads a mesh ahead of its first spawn and measures it the same way EnvironmentObject sizes collision shapes
+Vector3 ArchetypeRegistry::getHalfSize(const String &mesh)
+{
+	try
+	{
+		MeshPtr meshPtr = MeshManager::getSingleton().load(mesh, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+		return meshPtr->getBounds().getSize() * 0.5f * 0.97f;
+	}
+	catch (Ogre::Exception& e)
+	{
+		LogManager::getSingleton().logMessage("ArchetypeRegistry: can't load " + mesh + ", " + e.getDescription());
+	}
+	return Vector3::ZERO;
+}
+
+//Number of archetypes loaded
+unsigned int ArchetypeRegistry::getCount(void) const
+{
+	return mArchetypes.size();
+}
+
+//Returns one archetype
+const Archetype& ArchetypeRegistry::getArchetype(unsigned int i) const
+{
+	return mArchetypes[i];
+}
+
+//Archetype for an object name from a level file, names nobody claims get the crate fallback
+const Archetype& ArchetypeRegistry::findByName(const String &name) const
+{
+	std::map<String, unsigned int>::const_iterator found = mByName.find(name);
+	if (found == mByName.end())
+		return mFallback;
+	return mArchetypes[found->second];
+}
+
+//Archetype placed by a number key in the editor, NULL if the key has none
+const Archetype* ArchetypeRegistry::getEditorArchetype(int slot) const
+{
+	if (slot < 0 || slot >= EDITOR_SLOTS || mEditorSlots[slot] < 0)
+		return NULL;
+	return &mArchetypes[mEditorSlots[slot]];
+}
@@ -0,0 +1,162 @@
+#include "stdafx.h"
+#include "BackgroundWriter.h"
+
+/* Writes files on a worker thread so saving never stalls a frame.
+ * Jobs run in the order they were queued. Whole file writes go to a temporary file which is
+ * flushed to disk and then moved over the real one, so a crash mid-write leaves either the
+ * old file or the new one, never half of each.
+ */
+
+//Constructor, starts the worker thread
+BackgroundWriter::BackgroundWriter() :
+	mThread(NULL), mStopping(false)
+{
+	InitializeCriticalSection(&mLock);
+	mWorkEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	mIdleEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+	mThread = CreateThread(NULL, 0, &BackgroundWriter::threadMain, this, 0, NULL);
+	if (!mThread)
+		LogManager::getSingleton().logMessage("BackgroundWriter: could not start thread, files will be written immediately");
+}
+
+//Destructor, finishes every queued job before returning
+BackgroundWriter::~BackgroundWriter()
+{
+	if (mThread)
+	{
+		EnterCriticalSection(&mLock);
+		mStopping = true;
+		LeaveCriticalSection(&mLock);
+		SetEvent(mWorkEvent);
+		WaitForSingleObject(mThread, INFINITE);
+		CloseHandle(mThread);
+	}
+	CloseHandle(mWorkEvent);
+	CloseHandle(mIdleEvent);
+	DeleteCriticalSection(&mLock);
+}
+
+//Replaces a file's contents
+void BackgroundWriter::write(const String &fileName, const String &contents)
+{
+	queue(Job::JOB_WRITE, fileName, contents);
+}
+
+//Adds to the end of a file, creating it if needed
+void BackgroundWriter::append(const String &fileName, const String &contents)
+{
+	queue(Job::JOB_APPEND, fileName, contents);
+}
+
+//Deletes a file
+void BackgroundWriter::remove(const String &fileName)
+{
+	queue(Job::JOB_REMOVE, fileName, StringUtil::BLANK);
+}
+
+//Blocks until everything queued so far is on disk, for when a file is about to be read back
+void BackgroundWriter::flush(void)
+{
+	if (mThread)
+		WaitForSingleObject(mIdleEvent, INFINITE);
+}
+
+//Hands a job to the worker thread
+void BackgroundWriter::queue(Job::Type type, const String &fileName, const String &contents)
+{
+	Job job;
+	job.type = type;
+	job.fileName = fileName;
+	job.contents = contents;
+
+	if (!mThread)
+	{
+		runJob(job);
+		return;
+	}
+
+	EnterCriticalSection(&mLock);
+	mJobs.push_back(job);
+	ResetEvent(mIdleEvent);
+	LeaveCriticalSection(&mLock);
+	SetEvent(mWorkEvent);
+}
+
+//Thread entry point
+DWORD WINAPI BackgroundWriter::threadMain(LPVOID writer)
+{
+	((BackgroundWriter*) writer)->run();
+	return 0;
+}
+
+//Worker loop, runs jobs until told to stop and the queue is empty
+void BackgroundWriter::run(void)
+{
+	for (;;)
+	{
+		WaitForSingleObject(mWorkEvent, INFINITE);
+
+		for (;;)
+		{
+			EnterCriticalSection(&mLock);
+			if (mJobs.empty())
+			{
+				SetEvent(mIdleEvent);
+				bool stopping = mStopping;
+				LeaveCriticalSection(&mLock);
+				if (stopping)
+					return;
+				break;
+			}
+			Job job = mJobs.front();
+			mJobs.pop_front();
+			LeaveCriticalSection(&mLock);
+
+			runJob(job);
+		}
+	}
+}
+
+//Carries out one job, failures are logged as there is no one to return them to
+void BackgroundWriter::runJob(const Job &job)
+{
+	bool done = true;
+	if (job.type == Job::JOB_WRITE)
+		done = writeFileAtomically(job.fileName, job.contents);
+	else if (job.type == Job::JOB_APPEND)
+	{
+		HANDLE file = CreateFileA(job.fileName.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		DWORD written = 0;
+		done = (file != INVALID_HANDLE_VALUE)
+			&& WriteFile(file, job.contents.data(), job.contents.size(), &written, NULL) && written == job.contents.size()
+			&& FlushFileBuffers(file);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+	}
+	else if (job.type == Job::JOB_REMOVE)
+		done = DeleteFileA(job.fileName.c_str()) || GetLastError() == ERROR_FILE_NOT_FOUND;
+
+	//Ogre's log is only safe to use from here if Ogre was built with threading support
+	if (!done)
+		OutputDebugStringA(("BackgroundWriter: failed to update " + job.fileName + "\n").c_str());
+}
+
+//Writes a whole file through a temporary file so it is replaced in one step
+bool BackgroundWriter::writeFileAtomically(const String &fileName, const String &contents)
+{
+	String tempFile = fileName + ".tmp";
+	HANDLE file = CreateFileA(tempFile.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD written = 0;
+	bool done = WriteFile(file, contents.data(), contents.size(), &written, NULL) && written == contents.size()
+		&& FlushFileBuffers(file);
+	CloseHandle(file);
+
+	if (done)
+		done = MoveFileExA(tempFile.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+	if (!done)
+		DeleteFileA(tempFile.c_str());
+	return done;
+}
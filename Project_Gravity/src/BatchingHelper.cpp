@@ -0,0 +1,57 @@
+#include "stdafx.h"
+#include "BatchingHelper.h"
+
+/* Mesh and grid helpers shared by the renderers that batch level objects together.
+ * Instancing a skinned mesh would need every bone per instance, so the instanced palms and fish draw a
+ * copy of their mesh with the skeleton and blend weights taken out. Batches of nearby objects are
+ * grouped by square cells of the ground, keyed the same way by everything that splits the level up.
+ */
+
+//Copy of a mesh without its skeleton, bone assignments or blend weights
+MeshPtr BatchingHelper::cloneWithoutSkeleton(const String &mesh, const String &name)
+{
+	MeshPtr original = MeshManager::getSingleton().load(mesh, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+	MeshPtr copy = original->clone(name);
+	copy->setSkeletonName(StringUtil::BLANK);
+	copy->clearBoneAssignments();
+	for (unsigned short s = 0; s < copy->getNumSubMeshes(); s++)
+		copy->getSubMesh(s)->clearBoneAssignments();
+
+	//Blend data sits in its own buffer, which is unbound once nothing refers to it
+	std::vector<VertexData *> vertexData;
+	getVertexData(copy.getPointer(), vertexData);
+	for (unsigned int i = 0; i < vertexData.size(); i++)
+	{
+		VertexDeclaration* declaration = vertexData[i]->vertexDeclaration;
+		const VertexElement* blend = declaration->findElementBySemantic(VES_BLEND_INDICES);
+		if (!blend)
+			continue;
+		unsigned short source = blend->getSource();
+		declaration->removeElement(VES_BLEND_INDICES);
+		declaration->removeElement(VES_BLEND_WEIGHTS);
+		if (declaration->findElementsBySource(source).empty())
+			vertexData[i]->vertexBufferBinding->unsetBinding(source);
+	}
+	return copy;
+}
+
+//Every vertex data of a mesh, shared vertices first, then each submesh's own in order
+void BatchingHelper::getVertexData(Mesh* mesh, std::vector<VertexData *> &vertexData)
+{
+	if (mesh->sharedVertexData)
+		vertexData.push_back(mesh->sharedVertexData);
+	for (unsigned short s = 0; s < mesh->getNumSubMeshes(); s++)
+	{
+		SubMesh* subMesh = mesh->getSubMesh(s);
+		if (!subMesh->useSharedVertices && subMesh->vertexData)
+			vertexData.push_back(subMesh->vertexData);
+	}
+}
+
+//Cell a position falls in, cells are keyed by their grid coordinates packed into one number
+int BatchingHelper::getCellKey(const Vector3 &position, Real cellSize)
+{
+	int x = (int) Math::Floor(position.x / cellSize);
+	int z = (int) Math::Floor(position.z / cellSize);
+	return ((z + 512) << 10) | ((x + 512) & 1023);
+}
@@ -0,0 +1,262 @@
+#include "stdafx.h"
+#include "EditorJournal.h"
+
+/* Keeps the level editor's work safe without ever saving on the game thread.
+ * Every placed object is added to an in memory copy of the level and to an append only journal,
+ * which is handed to the background writer about once a second. Every so often the journal is
+ * compacted into a snapshot of the whole level, written atomically, and the journal is started
+ * again. If the game dies mid edit, the snapshot plus the journal give back all but the last
+ * second or so of work, and the next start up saves it as a new custom level. Placed objects are
+ * physics bodies that fall, settle and get pushed about, so every snapshot first rewrites each line's
+ * position, orientation and scale from where its body is now.
+ *
+ * Both files hold one operation per line:
+ *   S,island,generation	start of a snapshot
+ *   G,generation			start of a journal, only replayed on top of the snapshot of the same generation
+ *   A,<level file line>	an object was placed
+ */
+
+const String AUTOSAVE_SNAPSHOT = "../../res/Levels/Custom/Autosave.txt";
+const String AUTOSAVE_JOURNAL = "../../res/Levels/Custom/Autosave.journal";
+//Longest time an edit waits before it is on its way to disk
+const Real JOURNAL_FLUSH_SECONDS = 1.0f;
+//Compact the journal when it is this old, or this long, whichever comes first
+const Real CHECKPOINT_SECONDS = 30.0f;
+const unsigned int CHECKPOINT_OPERATIONS = 200;
+//First of the level file columns that hold position, orientation and scale
+const int TRANSFORM_FIELD = 2;
+const int TRANSFORM_FIELD_COUNT = 10;
+
+//Constructor
+EditorJournal::EditorJournal(BackgroundWriter* writer) :
+	mWriter(writer), mActive(false), mIsland(0), mGeneration(0),
+	mJournalStarted(false), mJournalOperations(0), mSinceFlush(0), mSinceCheckpoint(0)
+{
+}
+
+//Destructor, leaving the game normally means there is nothing to recover
+EditorJournal::~EditorJournal()
+{
+	end();
+}
+
+//Starts journaling a new, empty level on the given island
+void EditorJournal::begin(int island)
+{
+	mActive = true;
+	mIsland = island;
+	mObjects.clear();
+	mObjectFields.clear();
+	mBodies.clear();
+	mGeneration = 0;
+	checkpoint();
+}
+
+//Stops journaling and removes the autosave files
+void EditorJournal::end(void)
+{
+	if (!mActive)
+		return;
+
+	mActive = false;
+	mObjects.clear();
+	mObjectFields.clear();
+	mBodies.clear();
+	mPending.clear();
+	mWriter->remove(AUTOSAVE_SNAPSHOT);
+	mWriter->remove(AUTOSAVE_JOURNAL);
+}
+
+//Returns whether the editor is open
+bool EditorJournal::isActive(void) const
+{
+	return mActive;
+}
+
+//Island the level is being built on
+int EditorJournal::getIsland(void) const
+{
+	return mIsland;
+}
+
+//Records a placed object, given as the columns of a level file line and the body it was given
+void EditorJournal::addObject(const std::string fields[], int fieldCount, OgreBulletDynamics::RigidBody* body)
+{
+	if (!mActive)
+		return;
+
+	String line;
+	for (int i = 0; i < fieldCount; i++)
+	{
+		if (i > 0)
+			line += ',';
+		line += fields[i];
+	}
+	mObjects.push_back(line);
+	mObjectFields.push_back(std::vector<String>(fields, fields + fieldCount));
+	mBodies.push_back(body);
+
+	mPending += "A,";
+	mPending += line;
+	mPending += '\n';
+	mJournalOperations++;
+}
+
+//Called every frame, hands edits to the writer and compacts the journal when it is due
+void EditorJournal::update(Real timeSinceLastFrame)
+{
+	if (!mActive)
+		return;
+
+	mSinceFlush += timeSinceLastFrame;
+	mSinceCheckpoint += timeSinceLastFrame;
+
+	if (mJournalOperations >= CHECKPOINT_OPERATIONS || (mJournalOperations > 0 && mSinceCheckpoint >= CHECKPOINT_SECONDS))
+		checkpoint();
+	else if (!mPending.empty() && mSinceFlush >= JOURNAL_FLUSH_SECONDS)
+		flushJournal();
+}
+
+//Queues the waiting operations on the end of the journal
+void EditorJournal::flushJournal(void)
+{
+	if (!mJournalStarted)
+	{
+		mPending = "G," + StringConverter::toString(mGeneration) + "\n" + mPending;
+		mJournalStarted = true;
+	}
+	mWriter->append(AUTOSAVE_JOURNAL, mPending);
+	mPending.clear();
+	mSinceFlush = 0;
+}
+
+//Rewrites every object's line with where its body has come to be
+void EditorJournal::refreshTransforms(void)
+{
+	for (unsigned int i = 0; i < mObjects.size(); i++)
+	{
+		std::vector<String> &fields = mObjectFields[i];
+		if (!mBodies[i] || fields.size() < (unsigned int) (TRANSFORM_FIELD + TRANSFORM_FIELD_COUNT))
+			continue;
+
+		Vector3 position = mBodies[i]->getWorldPosition();
+		Quaternion orientation = mBodies[i]->getWorldOrientation();
+		Vector3 scale = mBodies[i]->getSceneNode()->getScale();
+		Real transform[TRANSFORM_FIELD_COUNT] = { position.x, position.y, position.z,
+			orientation.w, orientation.x, orientation.y, orientation.z, scale.x, scale.y, scale.z };
+		for (int f = 0; f < TRANSFORM_FIELD_COUNT; f++)
+			fields[TRANSFORM_FIELD + f] = StringConverter::toString(transform[f]);
+
+		String line;
+		for (unsigned int f = 0; f < fields.size(); f++)
+		{
+			if (f > 0)
+				line += ',';
+			line += fields[f];
+		}
+		mObjects[i] = line;
+	}
+}
+
+//Writes the whole level, as it stands now, as a new snapshot and starts an empty journal after it
+void EditorJournal::checkpoint(void)
+{
+	if (!mActive)
+		return;
+
+	refreshTransforms();
+	mGeneration++;
+	String snapshot = "S," + StringConverter::toString(mIsland) + "," + StringConverter::toString(mGeneration) + "\n";
+	for (unsigned int i = 0; i < mObjects.size(); i++)
+	{
+		snapshot += "A,";
+		snapshot += mObjects[i];
+		snapshot += '\n';
+	}
+
+	//The writer keeps its order, so the old journal is only removed once the snapshot is in place
+	mWriter->write(AUTOSAVE_SNAPSHOT, snapshot);
+	mWriter->remove(AUTOSAVE_JOURNAL);
+	mPending.clear();
+	mJournalStarted = false;
+	mJournalOperations = 0;
+	mSinceFlush = 0;
+	mSinceCheckpoint = 0;
+}
+
+//The level as a level object text file, as of the last checkpoint
+String EditorJournal::getObjectText(void) const
+{
+	String text;
+	for (unsigned int i = 0; i < mObjects.size(); i++)
+	{
+		text += mObjects[i];
+		text += '\n';
+	}
+	return text;
+}
+
+//Reads one autosave file's operations, a torn last line from a crash is dropped
+bool EditorJournal::readOperations(const String &fileName, bool snapshot, Ogre::uint32 &generation, int &island, std::vector<String> &objects)
+{
+	std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+	if (!file)
+		return false;
+
+	std::string line;
+	bool started = false;
+	while (std::getline(file, line))
+	{
+		if (file.eof())
+			break; //No newline, so the write was cut short
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+
+		if (!started)
+		{
+			std::vector<String> header = StringUtil::split(line, ",");
+			if (snapshot && header.size() == 3 && header[0] == "S")
+			{
+				island = StringConverter::parseInt(header[1]);
+				generation = StringConverter::parseUnsignedInt(header[2]);
+			}
+			else if (!snapshot && header.size() == 2 && header[0] == "G")
+			{
+				if (StringConverter::parseUnsignedInt(header[1]) != generation)
+					return false; //Already part of the snapshot
+			}
+			else
+				return false;
+			started = true;
+		}
+		else if (line.compare(0, 2, "A,") == 0)
+			objects.push_back(line.substr(2));
+	}
+	return started;
+}
+
+//Rebuilds the level left behind by a session that never finished, returns false if there isn't one
+bool EditorJournal::recover(int &island, String &objectText)
+{
+	Ogre::uint32 generation = 0;
+	std::vector<String> objects;
+	if (!readOperations(AUTOSAVE_SNAPSHOT, true, generation, island, objects))
+		return false;
+	readOperations(AUTOSAVE_JOURNAL, false, generation, island, objects);
+
+	objectText.clear();
+	for (unsigned int i = 0; i < objects.size(); i++)
+	{
+		objectText += objects[i];
+		objectText += '\n';
+	}
+	LogManager::getSingleton().logMessage("EditorJournal: recovered " + StringConverter::toString(objects.size()) + " objects from an unfinished edit");
+	return !objects.empty();
+}
+
+//Removes the autosave files once they have been recovered or turned out to be empty
+void EditorJournal::discardRecovered(void)
+{
+	DeleteFileA(AUTOSAVE_SNAPSHOT.c_str());
+	DeleteFileA(AUTOSAVE_JOURNAL.c_str());
+}
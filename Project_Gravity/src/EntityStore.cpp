@@ -0,0 +1,341 @@
+#include "stdafx.h"
+#include "EntityStore.h"
+#include "EnvironmentObject.h"
+
+/* Holds the runtime state of every level object.
+ * Each kind of state lives in its own packed array, so a game system only walks the arrays it uses
+ * instead of visiting a heap object per level object. Removing an object moves the last one into
+ * its place, and gameplay code keeps hold of objects through handles, which carry a generation
+ * so a handle to a removed object is never mistaken for whatever took its slot.
+ */
+
+//Friction value the collision callback gives a target or block once it has been hit
+const float HIT_FRICTION = 0.94f;
+const Ogre::uint32 SLOT_BITS = 16;
+const Ogre::uint32 SLOT_MASK = (1 << SLOT_BITS) - 1;
+//Space covered by the spatial index's cells, a margin around the 3000 unit islands; anything outside still works, just slower
+const AxisAlignedBox SPATIAL_BOUNDS(-500, -500, -500, 3500, 3500, 3500);
+//Smallest cells are 4000 / 2^6, about 60 units across
+const int SPATIAL_DEPTH = 6;
+
+//Constructor
+EntityStore::EntityStore() :
+	mSpatialIndex(SPATIAL_BOUNDS, SPATIAL_DEPTH)
+{
+	for (int t = 0; t < ENTITY_TYPES; t++)
+		mTypeCounts[t] = 0;
+}
+
+//Destructor
+EntityStore::~EntityStore()
+{
+}
+
+//Takes over the body, animation and billboard of a newly built object
+EntityHandle EntityStore::create(EntityType type, const EnvironmentObject &object)
+{
+	Ogre::uint32 slot;
+	if (!mFreeSlots.empty())
+	{
+		slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else
+	{
+		slot = mSlotIndices.size();
+		mSlotIndices.push_back(0);
+		mSlotGenerations.push_back(1);
+	}
+	int index = mTypes.size();
+	mSlotIndices[slot] = index;
+	EntityHandle handle = ((EntityHandle) mSlotGenerations[slot] << SLOT_BITS) | slot;
+
+	//Only crates, coconuts, targets and blocks follow paths
+	int path = -1;
+	if (object.mAnimated != 0 && type <= ENTITY_BLOCK)
+	{
+		path = mPathAnimator.add(handle, object.mBody, object.mPosition, Vector3(object.mXMovement, object.mYMovement, object.mZMovement),
+			object.mSpeed, Vector3(object.mRotationX, object.mRotationY, object.mRotationZ));
+	}
+
+	Billboard billboard;
+	billboard.node = object.mBillNode;
+	billboard.text = object.mText;
+	billboard.time = 0;
+	billboard.shown = false;
+	billboard.position = object.mPosition;
+
+	AnimationState* animation = object.getAnimationState();
+
+	mTypes.push_back((Ogre::uint8) type);
+	mBodies.push_back(object.mBody);
+	mPaths.push_back(path);
+	mMeshAnimations.push_back(animation);
+	mCounted.push_back(false);
+	mBillboards.push_back(billboard);
+	mHandles.push_back(handle);
+	mSpatialItems.push_back(mSpatialIndex.insert(handle, getBounds(object.mBody)));
+	mBodyHandles[object.mBody->getBulletRigidBody()] = handle;
+	mTypeCounts[type]++;
+	return handle;
+}
+
+//Removes an object from the world and the store
+void EntityStore::destroy(EntityHandle handle)
+{
+	int index = getIndex(handle);
+	if (index < 0)
+		return;
+
+	release(index);
+
+	mSpatialIndex.remove(mSpatialItems[index]);
+	mBodyHandles.erase(mBodies[index]->getBulletRigidBody());
+	mTypeCounts[mTypes[index]]--;
+
+	//The last path fills the removed one's place, so its owner needs pointing at it
+	int path = mPaths[index];
+	if (path >= 0)
+	{
+		mPathAnimator.remove(path);
+		if (path < mPathAnimator.getCount())
+			mPaths[getIndex(mPathAnimator.getOwner(path))] = path;
+	}
+
+	//Move the last object into the gap so the components stay packed
+	int last = mTypes.size() - 1;
+	if (index != last)
+	{
+		mTypes[index] = mTypes[last];
+		mBodies[index] = mBodies[last];
+		mPaths[index] = mPaths[last];
+		mMeshAnimations[index] = mMeshAnimations[last];
+		mCounted[index] = mCounted[last];
+		mBillboards[index] = mBillboards[last];
+		mHandles[index] = mHandles[last];
+		mSpatialItems[index] = mSpatialItems[last];
+		mSlotIndices[mHandles[index] & SLOT_MASK] = index;
+	}
+	mTypes.pop_back();
+	mBodies.pop_back();
+	mPaths.pop_back();
+	mMeshAnimations.pop_back();
+	mCounted.pop_back();
+	mBillboards.pop_back();
+	mHandles.pop_back();
+	mSpatialItems.pop_back();
+
+	Ogre::uint32 slot = handle & SLOT_MASK;
+	mSlotGenerations[slot] = (mSlotGenerations[slot] == 0xFFFF) ? 1 : mSlotGenerations[slot] + 1;
+	mFreeSlots.push_back(slot);
+}
+
+//Removes every object, all existing handles become invalid
+void EntityStore::clear(void)
+{
+	for (int i = 0; i < (int) mTypes.size(); i++)
+	{
+		release(i);
+		Ogre::uint32 slot = mHandles[i] & SLOT_MASK;
+		mSlotGenerations[slot] = (mSlotGenerations[slot] == 0xFFFF) ? 1 : mSlotGenerations[slot] + 1;
+		mFreeSlots.push_back(slot);
+	}
+
+	mTypes.clear();
+	mBodies.clear();
+	mPaths.clear();
+	mPathAnimator.clear();
+	mMeshAnimations.clear();
+	mCounted.clear();
+	mBillboards.clear();
+	mHandles.clear();
+	mSpatialItems.clear();
+	mSpatialIndex.clear();
+	mBodyHandles.clear();
+	for (int t = 0; t < ENTITY_TYPES; t++)
+		mTypeCounts[t] = 0;
+}
+
+//Takes an object's body out of the scene and the physics world
+void EntityStore::release(int index)
+{
+	OgreBulletDynamics::RigidBody *body = mBodies[index];
+	body->getSceneNode()->detachAllObjects();
+	body->getBulletCollisionWorld()->removeCollisionObject(body->getBulletRigidBody());
+	if (mBillboards[index].node)
+		mBillboards[index].node->setVisible(false);
+}
+
+//Returns whether a handle still refers to an object
+bool EntityStore::isValid(EntityHandle handle) const
+{
+	return getIndex(handle) >= 0;
+}
+
+//Current position of an object in the components, -1 if the handle is stale
+int EntityStore::getIndex(EntityHandle handle) const
+{
+	Ogre::uint32 slot = handle & SLOT_MASK;
+	if (handle == NULL_ENTITY || slot >= mSlotIndices.size() || mSlotGenerations[slot] != (handle >> SLOT_BITS))
+		return -1;
+	return mSlotIndices[slot];
+}
+
+//Handle of the object at a position in the components
+EntityHandle EntityStore::getHandle(int index) const
+{
+	return mHandles[index];
+}
+
+//Number of objects
+int EntityStore::getCount(void) const
+{
+	return mTypes.size();
+}
+
+//Number of objects of one kind
+int EntityStore::getTypeCount(EntityType type) const
+{
+	return mTypeCounts[type];
+}
+
+//Object a Bullet body belongs to, NULL_ENTITY if it isn't a level object
+EntityHandle EntityStore::findByBody(const btCollisionObject* body) const
+{
+	std::map<const btCollisionObject *, EntityHandle>::const_iterator found = mBodyHandles.find(body);
+	if (found == mBodyHandles.end())
+		return NULL_ENTITY;
+	return found->second;
+}
+
+//Kind of object
+EntityStore::EntityType EntityStore::getType(int index) const
+{
+	return (EntityType) mTypes[index];
+}
+
+/* Whether the object only ever changes by being knocked around, so it may be drawn as static geometry.
+ * Coconuts and targets change when they are collected or hit, and anything following a path or animating is left alone */
+bool EntityStore::isStaticProp(int index) const
+{
+	if (mTypes[index] == ENTITY_COCONUT || mTypes[index] == ENTITY_TARGET)
+		return false;
+	return mPaths[index] < 0 && !mMeshAnimations[index] && !mBillboards[index].node;
+}
+
+//Object's rigid body
+OgreBulletDynamics::RigidBody* EntityStore::getBody(int index) const
+{
+	return mBodies[index];
+}
+
+//Whether the object's hit has been scored
+bool EntityStore::isCounted(int index) const
+{
+	return mCounted[index] != 0;
+}
+
+//Marks the object's hit as scored
+void EntityStore::setCounted(int index)
+{
+	mCounted[index] = true;
+}
+
+/* Moves animated crates, coconuts, targets and blocks around their home positions.
+ * Hit targets stop spinning and show their score rising above them */
+void EntityStore::moveAnimated(double spinTime, Real timeSinceLastFrame)
+{
+	mStoppedPaths.clear();
+	mPathAnimator.update(spinTime, HIT_FRICTION, mStoppedPaths);
+
+	for (unsigned int i = 0; i < mStoppedPaths.size(); i++)
+	{
+		int index = getIndex(mStoppedPaths[i]);
+		if (index >= 0)
+			moveBillboard(index, timeSinceLastFrame);
+	}
+}
+
+//Plays a hit target's animation and floats its score up from where it was hit
+void EntityStore::moveBillboard(int index, Real timeSinceLastFrame)
+{
+	Billboard &billboard = mBillboards[index];
+	AnimationState* animation = mMeshAnimations[index];
+	if (!billboard.node || !animation)
+		return;
+
+	billboard.node->setVisible(false);
+	if (animation->getTimePosition() + timeSinceLastFrame/2 < 0.54)
+	{
+		animation->addTime(timeSinceLastFrame/2);
+		animation->setLoop(false);
+		animation->setEnabled(true);
+
+		billboard.time += timeSinceLastFrame;
+		billboard.node->setVisible(true);
+
+		//Update billboard text with score the first time round
+		if (!billboard.shown)
+		{
+			billboard.position = mBodies[index]->getCenterOfMassPosition();
+			billboard.shown = true;
+			int targetScore = (int) (mBodies[index]->getBulletRigidBody()->getRestitution() * 10000);
+			billboard.text->setCaption(StringConverter::toString(targetScore));
+		}
+
+		billboard.node->setPosition(billboard.position.x, billboard.position.y + 30 + (40 * billboard.time), billboard.position.z);
+		//Fade the text
+		if (billboard.time < 1.0)
+		{
+			ColourValue colour = billboard.text->getColor();
+			billboard.text->setColor(ColourValue(colour.r, colour.g, colour.b, 255 - billboard.time));
+		}
+	}
+	else
+	{
+		mBodies[index]->getSceneNode()->setVisible(false);
+	}
+}
+
+//World bounds of an object's body as Bullet sees them
+AxisAlignedBox EntityStore::getBounds(OgreBulletDynamics::RigidBody* body)
+{
+	btVector3 min, max;
+	body->getBulletRigidBody()->getAabb(min, max);
+	return AxisAlignedBox(min.x(), min.y(), min.z(), max.x(), max.y(), max.z());
+}
+
+/* Refreshes the spatial index for objects that may have moved since last frame.
+ * Static and sleeping bodies are skipped unless they follow a path */
+void EntityStore::updateSpatialIndex(void)
+{
+	for (int i = 0; i < (int) mTypes.size(); i++)
+	{
+		btRigidBody* body = mBodies[i]->getBulletRigidBody();
+		if (mPaths[i] < 0 && (body->isStaticObject() || !body->isActive()))
+			continue;
+
+		mSpatialIndex.update(mSpatialItems[i], getBounds(mBodies[i]));
+	}
+}
+
+//Finds every object whose bounds touch a sphere
+void EntityStore::findInRadius(const Vector3 &centre, Real radius, std::vector<EntityHandle> &handles) const
+{
+	mSpatialIndex.queryRadius(centre, radius, handles);
+}
+
+//Finds every object whose bounds touch a box
+void EntityStore::findInBox(const AxisAlignedBox &box, std::vector<EntityHandle> &handles) const
+{
+	mSpatialIndex.queryBox(box, handles);
+}
+
+//Nearest object whose bounds the ray passes through, NULL_ENTITY if there is none within maxDistance
+EntityHandle EntityStore::pick(const Ray &ray, Real maxDistance, Real &distance) const
+{
+	Ogre::uint32 owner;
+	if (!mSpatialIndex.queryRay(ray, maxDistance, owner, distance))
+		return NULL_ENTITY;
+	return owner;
+}
@@ -1,16 +1,21 @@
 #include "stdafx.h"
 #include "EnvironmentObject.h"
+#include "ArchetypeRegistry.h"
 
 /* This class was designed in order to provide a way of storing all the data about objects in the environment.
  * This data is necessary for the correct placement of the object and ensuring it behaves in the way expected (e.g. mass).
- * This class also moves objects that have animation properties.
+ * Once built, the object's body, animation and billboard are handed to the EntityStore, which runs them from then on.
+ * Objects are found through their EntityStore handle, so the Ogre and Bullet names given here are never looked up.
  */
 
+//Entities are named by the scene manager, these name what it doesn't
+static NameGenerator bodyNames("LevelBody");
+static NameGenerator billboardNames("LevelBillboard");
+
 //Constructor
-EnvironmentObject::EnvironmentObject(PGFrameListener* frameListener, OgreBulletDynamics::DynamicsWorld *mWorld, int mNumEntitiesInstanced, SceneManager* mSceneMgr, std::string object[24])
+EnvironmentObject::EnvironmentObject(PGFrameListener* frameListener, OgreBulletDynamics::DynamicsWorld *mWorld, SceneManager* mSceneMgr, const Archetype &archetype, std::string object[24])
 {
 	//Initialise variables
-	mName = object[0];
 	mMesh = object[1];
 	mPosition = Vector3(atof(object[2].c_str()), atof(object[3].c_str()), atof(object[4].c_str()));
 	mOrientation = Quaternion(atof(object[5].c_str()), atof(object[6].c_str()), atof(object[7].c_str()), atof(object[8].c_str()));
@@ -28,17 +33,72 @@ EnvironmentObject::EnvironmentObject(PGFrameListener* frameListener, OgreBulletD
 	mRotationZ = atof(object[22].c_str());
 	mBillBoard = atoi(object[23].c_str());
 
-	//Initially targets haven't been hit
-	counted = false;
+	mShape = archetype.shape;
+
+	//The archetype has already measured its own mesh
+	if (mMesh == archetype.mesh && archetype.halfSize != Vector3::ZERO)
+	{
+		Vector3 collisionSize = archetype.halfSize * mScale;
+		create(mWorld, mSceneMgr, archetype, &collisionSize);
+	}
+	else
+		create(mWorld, mSceneMgr, archetype, NULL);
+}
+
+//Constructor for objects from a compiled level pack, the names and collision size are already resolved
+EnvironmentObject::EnvironmentObject(PGFrameListener* frameListener, OgreBulletDynamics::DynamicsWorld *mWorld, SceneManager* mSceneMgr, const Archetype &archetype, const LevelObjectRecord &record, const LevelPack &pack)
+{
+	//Initialise variables
+	mMesh = pack.getString(record.mesh);
+	mPosition = Vector3(record.position);
+	mOrientation = Quaternion(record.orientation[0], record.orientation[1], record.orientation[2], record.orientation[3]);
+	mScale = Vector3(record.scale);
+	mRestitution = record.restitution;
+	mFriction = record.friction;
+	mMass = record.mass;
+	mShape = archetype.shape;
+	mAnimated = record.animated;
+	mXMovement = record.movement[0];
+	mYMovement = record.movement[1];
+	mZMovement = record.movement[2];
+	mSpeed = record.speed;
+	mRotationX = record.rotation[0];
+	mRotationY = record.rotation[1];
+	mRotationZ = record.rotation[2];
+	mBillBoard = record.billboard;
+
+	Vector3 collisionSize(record.collisionSize);
+	create(mWorld, mSceneMgr, archetype, &collisionSize);
+}
+
+/* Creates the entity, scene node and rigid body for the object using its archetype's rules.
+ * If no collision size is given it is worked out from the entity's bounding box */
+void EnvironmentObject::create(OgreBulletDynamics::DynamicsWorld *mWorld, SceneManager* mSceneMgr, const Archetype &archetype, const Vector3 *collisionSize)
+{
+	//Some archetypes fix the body's mass whatever the level file says
+	if (archetype.bodyMass >= 0)
+		mMass = archetype.bodyMass;
 
 	//Generate new Ogre entity
-	Entity* entity = mSceneMgr->createEntity(mName + StringConverter::toString(mNumEntitiesInstanced), mMesh);
+	Entity* entity = mSceneMgr->createEntity(mMesh);
+	if (!archetype.material.empty())
+		entity->setMaterialName(archetype.material);
+
+	//Targets fold over when hit using the mesh's own animation, palms sway in VegetationRenderer's vertex program
+	AnimationStateSet* animations = entity->getAllAnimationStates();
+	mAnimationState = (animations && animations->hasAnimationState("my_animation")) ? entity->getAnimationState("my_animation") : NULL;
 	
 	//Create bounding box for entity
-	AxisAlignedBox boundingB = entity->getBoundingBox();
-	Vector3 size = boundingB.getSize() * mScale;
-	size /= 2.0f;
-	size *= 0.97f;
+	Vector3 size;
+	if (collisionSize)
+		size = *collisionSize;
+	else
+	{
+		AxisAlignedBox boundingB = entity->getBoundingBox();
+		size = boundingB.getSize() * mScale;
+		size /= 2.0f;
+		size *= 0.97f;
+	}
 	
 	//Attach entity to a scene node so it can be displayed in the environment
 	SceneNode* objectNode = mSceneMgr->getRootSceneNode()->createChildSceneNode();
@@ -46,16 +106,16 @@ EnvironmentObject::EnvironmentObject(PGFrameListener* frameListener, OgreBulletD
 	objectNode->setScale(mScale);
 	
 	//Generate a new rigidbody for the object
-	mBody = new OgreBulletDynamics::RigidBody(mName + StringConverter::toString(mNumEntitiesInstanced), mWorld);
+	mBody = new OgreBulletDynamics::RigidBody(bodyNames.generate(), mWorld);
 
 	//Different objects require different collision shapes
-	if(mName == "Target") {
+	if(mShape == SHAPE_CYLINDER) {
 		OgreBulletCollisions::CylinderCollisionShape* ccs = new OgreBulletCollisions::CylinderCollisionShape(size, Ogre::Vector3(0,0,1));	
 		mBody->setShape(objectNode, ccs, mRestitution, mFriction, mMass, mPosition, mOrientation);
 		mBody->setDebugDisplayEnabled(true);
 		mBody->getBulletRigidBody()->setCollisionFlags(mBody->getBulletRigidBody()->getCollisionFlags()  | btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
 	} 
-	else if(mName == "Palm") {
+	else if(mShape == SHAPE_TRIMESH) {
 		OgreBulletCollisions::StaticMeshToShapeConverter* acs = new OgreBulletCollisions::StaticMeshToShapeConverter(entity);
 		OgreBulletCollisions::TriangleMeshCollisionShape* ccs = acs->createTrimesh();
 		OgreBulletCollisions::CollisionShape* finalCollisionShape = (OgreBulletCollisions::CollisionShape*) ccs;
@@ -64,10 +124,8 @@ EnvironmentObject::EnvironmentObject(PGFrameListener* frameListener, OgreBulletD
 		btVector3 scale2(scale.x, scale.y, scale.z);
 		finalCollisionShape->getBulletShape()->setLocalScaling(scale2);
 		mBody->setShape(objectNode, (OgreBulletCollisions::CollisionShape*) ccs, mRestitution, mFriction, mMass, mPosition, mOrientation);
-		mBody->getBulletRigidBody()->setFriction(0.5f);
-		palmAnimation = entity->getAnimationState("my_animation");
 	}
-	else if(mName == "GoldCoconut") {
+	else if(mShape == SHAPE_SPHERE) {
 		float biggestSize = 0;
 		if (size.x > biggestSize)
 			biggestSize = size.x;
@@ -76,139 +134,47 @@ EnvironmentObject::EnvironmentObject(PGFrameListener* frameListener, OgreBulletD
 		if (size.z > biggestSize)
 			biggestSize = size.z;
 
-		entity->setMaterialName("GoldCoconut");
 		OgreBulletCollisions::CollisionShape *sceneSphereShape = new OgreBulletCollisions::SphereCollisionShape(biggestSize);
  		mBody->setShape(objectNode, sceneSphereShape, mRestitution, mFriction, mMass, mPosition, mOrientation);
 		mBody->getBulletRigidBody()->setCollisionFlags(mBody->getBulletRigidBody()->getCollisionFlags()  | btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
 	}
 	else {
-		if (mName=="Orange" ||mName=="Blue" || mName=="Red" || mName=="Block")
-		{
-			mMass=50;
-		}
-		if (mName == "Orange")
-			entity->setMaterialName("Orange");
-		else if (mName == "Blue")
-			entity->setMaterialName("Blue");
-		else if (mName == "Red")
-			entity->setMaterialName("Red");
 		OgreBulletCollisions::BoxCollisionShape* sceneBoxShape = new OgreBulletCollisions::BoxCollisionShape(size);
 		mBody->setShape(objectNode, sceneBoxShape, mRestitution, mFriction, mMass, mPosition, mOrientation);
 		mBody->getBulletRigidBody()->setCollisionFlags(mBody->getBulletRigidBody()->getCollisionFlags()  | btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
 	}
 
+	if (archetype.bodyFriction >= 0)
+		mBody->getBulletRigidBody()->setFriction(archetype.bodyFriction);
 	mBody->setCastShadows(true);
 
 	//Add a billboard for scores if necessary
 	if(mBillBoard != 0) {
-		mText = new MovableText("targetText" + StringConverter::toString(mNumEntitiesInstanced), "100", "000_@KaiTi_33", 17.0f);
+		mText = new MovableText(billboardNames.generate(), "100", "000_@KaiTi_33", 17.0f);
 		mText->setTextAlignment(MovableText::H_CENTER, MovableText::V_ABOVE); // Center horizontally and display above the node
+		mText->removeVisibilityFlags(VISIBLE_IN_REFLECTION);
 		
 		//Create scene node for bill board and attach text to it
 		mBillNode = static_cast<SceneNode*>(mSceneMgr->getRootSceneNode()->createChild());
 		mBillNode->attachObject(mText);
 		mBillNode->setPosition(mPosition.x, mPosition.y + 50, mPosition.z);
 		mBillNode->setVisible(false);
-		//Set animation to off initially
-		mTextAnim = 0;
-		mTextBool = false;
-		mTextPos = mBody->getCenterOfMassPosition();
 	} else {
 		mText = NULL;	
 		mBillNode = NULL;
-		mTextAnim = NULL;
-		mTextBool = NULL;
-		mTextPos = NULL;
 	}
 }
 
-/* A method that updates and object's position.
- * If the object has animation properties, move it according to those values */
-void EnvironmentObject::move(float spinTime, double evtTime) 
-{
-	mBody->getBulletRigidBody()->setActivationState(DISABLE_DEACTIVATION);
-	btTransform transform = mBody->getCenterOfMassTransform();
-
-	//Calculate new origin for object's centre of mass location
-	transform.setOrigin(btVector3(mPosition.x + (mXMovement * sin(spinTime/mSpeed)), mPosition.y + (mYMovement * cos(spinTime/mSpeed)), mPosition.z + (mZMovement * sin(spinTime/mSpeed))));
-	if (mBody->getBulletRigidBody()->getFriction() != 0.94f) {
-		mBody->getBulletRigidBody()->setAngularVelocity(btVector3(mRotationX, mRotationY, mRotationZ));
-	}
-
-	//Move object and set velocity to 0
-	mBody->getBulletRigidBody()->setCenterOfMassTransform(transform);
-	mBody->setLinearVelocity(0, 0, 0);
-
-	//If the body (a target) has been hit then set it moving away from player and display user's accuracy score
-	if (mBody->getBulletRigidBody()->getFriction() == 0.94f)
-	{
-		mBillNode->setVisible(false);
-		Entity* ent = (Entity*) mBody->getSceneNode()->getAttachedObject(0);
-		//Animate text for billboard
-		if (ent->getAnimationState("my_animation")->getTimePosition() + evtTime/2 < 0.54)
-		{
-			ent->getAnimationState("my_animation")->addTime(evtTime/2);
-			ent->getAnimationState("my_animation")->setLoop(false);
-			ent->getAnimationState("my_animation")->setEnabled(true);
-
-			mTextAnim += evtTime;
-
-			mBillNode->setVisible(true);
-
-			//Update billboad text with score
-			if (mTextBool == false)
-			{
-				mTextPos = mBody->getCenterOfMassPosition();
-				mTextBool = true;
-					
-				int targetScore = (int) (mBody->getBulletRigidBody()->getRestitution() * 10000);
-				std::stringstream ss;//create a stringstream
-				ss << targetScore;//add number to the stream
-				std::string targetString = ss.str();;
-				mText->setCaption(targetString);
-			}
-
-			//Set position of bill board 
-			mBillNode->setPosition(mTextPos.x, mTextPos.y + 30 + (40 * mTextAnim), mTextPos.z);
-			//Set colour of text
-			if (mTextAnim < 1.0) {
-				mText->setColor(Ogre::ColourValue(mText->getColor().r, 
-						mText->getColor().g, 
-						mText->getColor().b, 255 - (mTextAnim)));
-			}
-		}
-		else
-		{
-			ent->getParentSceneNode()->setVisible(false);
-		}
-	}
-}
-
-//Method to determine if a target has been hit 
-bool EnvironmentObject::targetHit()
-{
-	if (mBody->getBulletRigidBody()->getFriction()==0.94f)
-		return true;
-	else
-		return false;
-}
-
-//Returns whether target has been counted (hit)
-bool EnvironmentObject::targetCounted()
-{
-	return counted;
-}
-
 //Returns object body
 OgreBulletDynamics::RigidBody* EnvironmentObject::getBody()
 {
 	return mBody;
 }
 
-//Returns palm animation state
-AnimationState *EnvironmentObject::getPalmAnimation()
+//Returns the mesh's animation, NULL if it has none
+AnimationState *EnvironmentObject::getAnimationState() const
 {
-	return palmAnimation;
+	return mAnimationState;
 }
 
 //Deconstructor
@@ -0,0 +1,376 @@
+#include "stdafx.h"
+#include "FishRenderer.h"
+#include "ReflectionUpdater.h"
+#include "BatchingHelper.h"
+
+/* This class draws the flocking fish using hardware instancing.
+ * Each material variant gets one InstancedGeometry, split into batches of as many fish as the instancing
+ * vertex program's matrix array holds, so the whole school costs a handful of draw calls. The swim cycle
+ * is skinned once at load time into a float texture of vertex positions and normals, which the vertex
+ * program plays back with each fish at its own phase, so no fish has a skeleton to update. Dead fish are
+ * simply hidden here and drawn as ordinary entities by the frame listener.
+ */
+
+//Must match the size of worldMatrix3x4Array in FishInstancing.cg
+const int MAX_INSTANCED_MATRICES = 80;
+const Vector3 FISH_SCALE(2.6f, 2.6f, 2.6f);
+const String SWIM_ANIMATION = "Act: ArmatureAction.001";
+const String SWIM_TEXTURE = "FishSwimAnimation";
+//Frames baked from the swim cycle, the vertex program blends between them
+const int SWIM_FRAMES = 32;
+//Longest row of the swim texture, bigger meshes wrap onto more rows per frame
+const int SWIM_TEXTURE_WIDTH = 1024;
+//Swim cycle seconds played per second, the fish always swam at five times the animation's speed
+const Real SWIM_SPEED = 5;
+//Texture coordinate set the static fish mesh keeps each vertex's number in, must match FishInstancing.cg
+const unsigned short SWIM_VERTEX_COORD = 1;
+
+//Copies one three float element of every vertex out of a vertex data
+static void readElement(VertexData* vertexData, VertexElementSemantic semantic, std::vector<Vector3> &values)
+{
+	const VertexElement* element = vertexData->vertexDeclaration->findElementBySemantic(semantic);
+	if (!element)
+	{
+		values.resize(values.size() + vertexData->vertexCount, Vector3::ZERO);
+		return;
+	}
+
+	HardwareVertexBufferSharedPtr buffer = vertexData->vertexBufferBinding->getBuffer(element->getSource());
+	unsigned char* vertex = static_cast<unsigned char *>(buffer->lock(HardwareBuffer::HBL_READ_ONLY));
+	vertex += vertexData->vertexStart * buffer->getVertexSize();
+	for (size_t i = 0; i < vertexData->vertexCount; i++, vertex += buffer->getVertexSize())
+	{
+		float* value;
+		element->baseVertexPointerToElement(vertex, &value);
+		values.push_back(Vector3(value[0], value[1], value[2]));
+	}
+	buffer->unlock();
+}
+
+//Constructor
+FishRenderer::FishRenderer(SceneManager* sceneMgr) :
+	mSceneMgr(sceneMgr), mFishCount(0)
+{
+	for (int i = 0; i < FISH_VARIANTS; i++)
+		mBatches[i] = NULL;
+
+	MeshPtr fishMesh = MeshManager::getSingleton().load("angelFish.mesh",
+		ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+	mFishBounds = fishMesh->getBounds();
+
+	bakeSwimAnimation();
+	setupMaterial("FishInstanced");
+	setupMaterial("FishInstancedBlue");
+	setupMaterial("FishInstancedCaster");
+}
+
+//Destructor
+FishRenderer::~FishRenderer()
+{
+	destroy();
+}
+
+//Dead fish are drawn as normal entities using this material
+String FishRenderer::getDeadMaterial(Variant variant)
+{
+	return (variant == FISH_BLUE) ? "FishMaterialBlueDead" : "FishMaterialDead";
+}
+
+/* Skins the fish mesh at evenly spaced points of its swim cycle and stores the results in a float texture.
+ * Each frame is a block of rows holding every vertex's position, and the normals follow in the same layout
+ * after the last frame's positions */
+void FishRenderer::bakeSwimAnimation(void)
+{
+	MeshPtr mesh = MeshManager::getSingleton().load("angelFish.mesh", ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+	SkeletonPtr skeleton = mesh->getSkeleton();
+
+	//Rest pose and bone weights of every vertex, numbered across all of the mesh's vertex data
+	std::vector<VertexData *> vertexData;
+	BatchingHelper::getVertexData(mesh.getPointer(), vertexData);
+	std::vector<Vector3> restPositions, restNormals;
+	std::vector<VertexBoneAssignment> assignments;
+	for (unsigned int d = 0; d < vertexData.size(); d++)
+	{
+		size_t offset = restPositions.size();
+		readElement(vertexData[d], VES_POSITION, restPositions);
+		readElement(vertexData[d], VES_NORMAL, restNormals);
+
+		SubMesh* subMesh = NULL;
+		for (unsigned short s = 0; s < mesh->getNumSubMeshes() && !subMesh; s++)
+		{
+			if (mesh->getSubMesh(s)->vertexData == vertexData[d] && !mesh->getSubMesh(s)->useSharedVertices)
+				subMesh = mesh->getSubMesh(s);
+		}
+		Mesh::BoneAssignmentIterator boneIt = subMesh ? subMesh->getBoneAssignmentIterator() : mesh->getBoneAssignmentIterator();
+		while (boneIt.hasMoreElements())
+		{
+			VertexBoneAssignment assignment = boneIt.getNext();
+			assignment.vertexIndex += offset;
+			assignments.push_back(assignment);
+		}
+	}
+
+	int vertexCount = restPositions.size();
+	int width = (vertexCount < SWIM_TEXTURE_WIDTH) ? vertexCount : SWIM_TEXTURE_WIDTH;
+	int rowsPerFrame = (vertexCount + width - 1) / width;
+	int height = rowsPerFrame * SWIM_FRAMES * 2;
+	mSwimParams = Vector4((Real) width, (Real) rowsPerFrame, (Real) SWIM_FRAMES, (Real) height);
+
+	mSwimTexture = TextureManager::getSingleton().createManual(SWIM_TEXTURE, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+		TEX_TYPE_2D, width, height, 0, PF_FLOAT32_RGBA, TU_STATIC_WRITE_ONLY);
+	HardwarePixelBufferSharedPtr pixels = mSwimTexture->getBuffer();
+	pixels->lock(HardwareBuffer::HBL_DISCARD);
+	const PixelBox &box = pixels->getCurrentLock();
+	float* texels = static_cast<float *>(box.data);
+
+	Animation* animation = (skeleton.isNull() || !skeleton->hasAnimation(SWIM_ANIMATION)) ? NULL : skeleton->getAnimation(SWIM_ANIMATION);
+	mCycleRate = animation ? SWIM_SPEED / animation->getLength() : 0;
+	std::vector<Matrix4> boneMatrices(skeleton.isNull() ? 1 : skeleton->getNumBones());
+	std::vector<Vector3> positions(vertexCount), normals(vertexCount);
+	std::vector<Real> weights(vertexCount);
+	for (int frame = 0; frame < SWIM_FRAMES; frame++)
+	{
+		//Pose the mesh's own skeleton, the instances used for dead fish keep theirs
+		positions = restPositions;
+		normals = restNormals;
+		if (animation)
+		{
+			skeleton->reset(true);
+			animation->apply(skeleton.getPointer(), animation->getLength() * frame / SWIM_FRAMES);
+			skeleton->_getBoneMatrices(&boneMatrices[0]);
+
+			std::fill(positions.begin(), positions.end(), Vector3::ZERO);
+			std::fill(normals.begin(), normals.end(), Vector3::ZERO);
+			std::fill(weights.begin(), weights.end(), 0);
+			for (unsigned int a = 0; a < assignments.size(); a++)
+			{
+				const VertexBoneAssignment &assignment = assignments[a];
+				const Matrix4 &bone = boneMatrices[assignment.boneIndex];
+				Matrix3 rotation;
+				bone.extract3x3Matrix(rotation);
+				positions[assignment.vertexIndex] += (bone * restPositions[assignment.vertexIndex]) * assignment.weight;
+				normals[assignment.vertexIndex] += (rotation * restNormals[assignment.vertexIndex]) * assignment.weight;
+				weights[assignment.vertexIndex] += assignment.weight;
+			}
+
+			//Unweighted vertices keep their rest pose, the rest are normalised in case the weights don't sum to one
+			for (int v = 0; v < vertexCount; v++)
+			{
+				if (weights[v] <= 0)
+				{
+					positions[v] = restPositions[v];
+					normals[v] = restNormals[v];
+				}
+				else
+				{
+					positions[v] /= weights[v];
+				}
+				normals[v].normalise();
+			}
+		}
+
+		for (int v = 0; v < vertexCount; v++)
+		{
+			size_t column = v % width;
+			size_t row = frame * rowsPerFrame + v / width;
+			float* position = texels + (row * box.rowPitch + column) * 4;
+			float* normal = texels + ((row + SWIM_FRAMES * rowsPerFrame) * box.rowPitch + column) * 4;
+			position[0] = positions[v].x;
+			position[1] = positions[v].y;
+			position[2] = positions[v].z;
+			position[3] = 1;
+			normal[0] = normals[v].x;
+			normal[1] = normals[v].y;
+			normal[2] = normals[v].z;
+			normal[3] = 0;
+		}
+	}
+	pixels->unlock();
+	if (!skeleton.isNull())
+		skeleton->reset(true);
+
+	LogManager::getSingleton().logMessage("FishRenderer: baked " + StringConverter::toString(SWIM_FRAMES) + " swim frames of "
+		+ StringConverter::toString(vertexCount) + " vertices");
+}
+
+/* Copy of the fish mesh for the batches, without its skeleton and blend weights, where every vertex
+ * carries its number in the swim texture instead */
+MeshPtr FishRenderer::createStaticMesh(void)
+{
+	String name = "angelFish.mesh/Static";
+	MeshPtr copy = MeshManager::getSingleton().getByName(name);
+	if (!copy.isNull())
+		return copy;
+
+	copy = BatchingHelper::cloneWithoutSkeleton("angelFish.mesh", name);
+
+	std::vector<VertexData *> vertexData;
+	BatchingHelper::getVertexData(copy.getPointer(), vertexData);
+	float vertexNumber = 0;
+	for (unsigned int i = 0; i < vertexData.size(); i++)
+	{
+		//The vertex numbers take the first free binding, which is where the blend data was
+		VertexDeclaration* declaration = vertexData[i]->vertexDeclaration;
+		VertexBufferBinding* binding = vertexData[i]->vertexBufferBinding;
+		unsigned short source = 0;
+		while (binding->isBufferBound(source))
+			source++;
+
+		size_t vertexCount = vertexData[i]->vertexStart + vertexData[i]->vertexCount;
+		HardwareVertexBufferSharedPtr numbers = HardwareBufferManager::getSingleton().createVertexBuffer(
+			VertexElement::getTypeSize(VET_FLOAT1), vertexCount, HardwareBuffer::HBU_STATIC_WRITE_ONLY, true);
+		float* number = static_cast<float *>(numbers->lock(HardwareBuffer::HBL_DISCARD));
+		for (size_t v = 0; v < vertexCount; v++)
+			number[v] = (v < vertexData[i]->vertexStart) ? 0 : vertexNumber++;
+		numbers->unlock();
+
+		declaration->addElement(source, 0, VET_FLOAT1, VES_TEXTURE_COORDINATES, SWIM_VERTEX_COORD);
+		binding->setBinding(source, numbers);
+	}
+	return copy;
+}
+
+//Points a fish material's swim texture unit at the baked texture and tells its vertex program the layout
+void FishRenderer::setupMaterial(const String &material)
+{
+	MaterialPtr materialPtr = MaterialManager::getSingleton().getByName(material);
+	if (materialPtr.isNull())
+		return;
+
+	Material::TechniqueIterator techniqueIt = materialPtr->getTechniqueIterator();
+	while (techniqueIt.hasMoreElements())
+	{
+		Technique::PassIterator passIt = techniqueIt.getNext()->getPassIterator();
+		while (passIt.hasMoreElements())
+		{
+			Pass* pass = passIt.getNext();
+			TextureUnitState* swimAnimation = pass->getTextureUnitState("swimAnimation");
+			if (!swimAnimation || !pass->hasVertexProgram())
+				continue;
+
+			swimAnimation->setTextureName(SWIM_TEXTURE);
+			GpuProgramParametersSharedPtr params = pass->getVertexProgramParameters();
+			params->setNamedConstant("animParams", mSwimParams);
+			params->setNamedConstant("cycleRate", mCycleRate);
+		}
+	}
+}
+
+//Creates the instanced batches for the given fish, one variant per fish
+void FishRenderer::build(const std::vector<Variant> &variants)
+{
+	destroy();
+
+	int fishCount = variants.size();
+	mFishCount = fishCount;
+	mInstances.assign(fishCount, (InstancedGeometry::InstancedObject *) NULL);
+	mVisible.assign(fishCount, true);
+
+	std::vector<int> variantFish[FISH_VARIANTS];
+	for (int i = 0; i < fishCount; i++)
+		variantFish[variants[i]].push_back(i);
+
+	for (int v = 0; v < FISH_VARIANTS; v++)
+	{
+		if (!variantFish[v].empty())
+			buildVariant((Variant) v, variantFish[v]);
+	}
+}
+
+//Builds one InstancedGeometry holding the given fish
+void FishRenderer::buildVariant(Variant variant, const std::vector<int> &fish)
+{
+	Entity* templateEnt = mSceneMgr->createEntity("FishTemplate" + StringConverter::toString(variant), createStaticMesh()->getName());
+	templateEnt->setMaterialName((variant == FISH_BLUE) ? "FishInstancedBlue" : "FishInstanced");
+
+	int fishPerBatch = (MAX_INSTANCED_MATRICES < (int) fish.size()) ? MAX_INSTANCED_MATRICES : fish.size();
+	int batchCount = ((int) fish.size() + fishPerBatch - 1) / fishPerBatch;
+
+	InstancedGeometry* batch = mSceneMgr->createInstancedGeometry("FishSchool" + StringConverter::toString(variant));
+	batch->setCastShadows(true);
+	batch->setBatchInstanceDimensions(Vector3(1000000, 1000000, 1000000));
+	for (int i = 0; i < fishPerBatch; i++)
+		batch->addEntity(templateEnt, Vector3::ZERO);
+	batch->setOrigin(Vector3::ZERO);
+	batch->build();
+	for (int i = 1; i < batchCount; i++)
+		batch->addBatchInstance();
+	mSceneMgr->destroyEntity(templateEnt);
+	mBatches[variant] = batch;
+
+	//Hand the instances out to the fish in order, spare slots in the last batch are hidden
+	unsigned int next = 0;
+	InstancedGeometry::BatchInstanceIterator batchIt = batch->getBatchInstanceIterator();
+	while (batchIt.hasMoreElements())
+	{
+		InstancedGeometry::BatchInstance* batchInstance = batchIt.getNext();
+		batchInstance->removeVisibilityFlags(VISIBLE_IN_REFLECTION); //Too small to see in the gun
+		mBatchInstances.push_back(batchInstance);
+
+		InstancedGeometry::BatchInstance::InstancedObjectIterator objectIt = batchInstance->getObjectIterator();
+		while (objectIt.hasMoreElements())
+		{
+			InstancedGeometry::InstancedObject* object = objectIt.getNext();
+			if (next >= fish.size())
+			{
+				object->setScale(Vector3::ZERO);
+				continue;
+			}
+
+			int i = fish[next++];
+			object->setScale(FISH_SCALE);
+			mInstances[i] = object;
+		}
+	}
+	batch->setVisible(true);
+}
+
+//Removes all instanced batches
+void FishRenderer::destroy(void)
+{
+	for (int i = 0; i < FISH_VARIANTS; i++)
+	{
+		if (mBatches[i])
+		{
+			mSceneMgr->destroyInstancedGeometry(mBatches[i]);
+			mBatches[i] = NULL;
+		}
+	}
+	mBatchInstances.clear();
+	mInstances.clear();
+	mVisible.clear();
+	mFishCount = 0;
+}
+
+//Batches move with their fish, so their bounds are refreshed once per frame
+void FishRenderer::update(void)
+{
+	for (unsigned int i = 0; i < mBatchInstances.size(); i++)
+		mBatchInstances[i]->updateBoundingBox();
+}
+
+//Moves a single fish instance
+void FishRenderer::setTransform(int fish, const Vector3 &position, const Quaternion &orientation)
+{
+	if (fish < 0 || fish >= mFishCount || !mInstances[fish])
+		return;
+
+	mInstances[fish]->setPosition(position);
+	mInstances[fish]->setOrientation(orientation);
+}
+
+//Instances can't be detached from their batch, so hidden fish are collapsed to nothing
+void FishRenderer::setVisible(int fish, bool visible)
+{
+	if (fish < 0 || fish >= mFishCount || !mInstances[fish] || mVisible[fish] == visible)
+		return;
+
+	mVisible[fish] = visible;
+	mInstances[fish]->setScale(visible ? FISH_SCALE : Vector3::ZERO);
+}
+
+//Local bounds of the fish mesh, used to size the fish's collision shapes
+const AxisAlignedBox& FishRenderer::getFishBounds(void) const
+{
+	return mFishBounds;
+}
@@ -0,0 +1,139 @@
+#include "stdafx.h"
+#include "FishScheduler.h"
+#include <algorithm>
+
+/* This class decides how much work each fish gets per frame.
+ * Visible fish close to the camera are updated every frame, mid-range fish every few frames
+ * (their bodies carry on moving in between), and distant or unseen fish are frozen in place. The tiers only
+ * cover the flocking and movement done on the CPU, the swim cycle is played by the vertex program for every
+ * fish alike, so frozen fish keep swimming on the spot. Stopping that would save nothing, as the GPU
+ * does the same work for a paused pose.
+ * The distances and budgets are read from Fish.cfg so they can be tuned without a rebuild.
+ */
+
+//Radius used when testing a fish against the camera frustum
+const Real FISH_VISIBILITY_RADIUS = 30.0f;
+
+//Constructor
+FishScheduler::FishScheduler() :
+	mNearDistance(600), mFarDistance(1500), mMidInterval(4), mNearBudget(40), mFrame(0)
+{
+	for (int i = 0; i < TIER_COUNT; i++)
+		mTierCounts[i] = 0;
+}
+
+//Destructor
+FishScheduler::~FishScheduler()
+{
+}
+
+//Reads the scheduling budgets, keeping the defaults for anything missing
+void FishScheduler::loadSettings(const String &fileName)
+{
+	ConfigFile config;
+	try
+	{
+		config.loadFromResourceSystem(fileName, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME, "=", true);
+	}
+	catch (Ogre::Exception& e)
+	{
+		LogManager::getSingleton().logMessage("FishScheduler: could not load " + fileName + ", using default budgets");
+		return;
+	}
+
+	mNearDistance = StringConverter::parseReal(config.getSetting("NearDistance"), mNearDistance);
+	mFarDistance = StringConverter::parseReal(config.getSetting("FarDistance"), mFarDistance);
+	mMidInterval = StringConverter::parseInt(config.getSetting("MidInterval"), mMidInterval);
+	mNearBudget = StringConverter::parseInt(config.getSetting("NearBudget"), mNearBudget);
+
+	if (mMidInterval < 1)
+		mMidInterval = 1;
+	if (mFarDistance < mNearDistance)
+		mFarDistance = mNearDistance;
+}
+
+//Starts scheduling a new school of fish
+void FishScheduler::reset(int fishCount)
+{
+	mTiers.assign(fishCount, TIER_NEAR);
+	mLastTiers.assign(fishCount, TIER_NEAR);
+	mNearCandidates.reserve(fishCount);
+	for (int i = 0; i < TIER_COUNT; i++)
+		mTierCounts[i] = 0;
+}
+
+//Sorts every fish into a tier for this frame
+void FishScheduler::schedule(Camera* camera, const std::vector<Vector3> &positions, const std::vector<bool> &active)
+{
+	mFrame++;
+	mLastTiers = mTiers;
+	mNearCandidates.clear();
+
+	const Vector3 eye = camera->getDerivedPosition();
+	const Real near2 = mNearDistance * mNearDistance;
+	const Real far2 = mFarDistance * mFarDistance;
+
+	for (unsigned int i = 0; i < mTiers.size(); i++)
+	{
+		if (!active[i])
+		{
+			mTiers[i] = TIER_FAR;
+			continue;
+		}
+
+		Real distance2 = (positions[i] - eye).squaredLength();
+		bool visible = camera->isVisible(Sphere(positions[i], FISH_VISIBILITY_RADIUS));
+
+		if (distance2 <= near2 && visible)
+			mNearCandidates.push_back(std::make_pair(distance2, (int) i));
+		else if (distance2 <= near2 || (distance2 <= far2 && visible))
+			mTiers[i] = TIER_MID; //Keeps schooling behind the player, just less often
+		else
+			mTiers[i] = TIER_FAR;
+	}
+
+	//Only the closest fish within budget get a full update, the rest drop to mid-range
+	int budget = mNearBudget;
+	if (budget < 0)
+		budget = 0;
+	if ((int) mNearCandidates.size() > budget)
+		std::nth_element(mNearCandidates.begin(), mNearCandidates.begin() + budget, mNearCandidates.end());
+	for (unsigned int i = 0; i < mNearCandidates.size(); i++)
+		mTiers[mNearCandidates[i].second] = ((int) i < budget) ? TIER_NEAR : TIER_MID;
+
+	for (int i = 0; i < TIER_COUNT; i++)
+		mTierCounts[i] = 0;
+	for (unsigned int i = 0; i < mTiers.size(); i++)
+	{
+		if (active[i])
+			mTierCounts[mTiers[i]]++;
+	}
+}
+
+//Which tier a fish is in this frame
+FishScheduler::Tier FishScheduler::getTier(int fish) const
+{
+	return mTiers[fish];
+}
+
+//Mid-range fish are staggered so only a fraction of them update each frame
+bool FishScheduler::isUpdateFrame(int fish) const
+{
+	if (mTiers[fish] == TIER_NEAR)
+		return true;
+	if (mTiers[fish] == TIER_MID)
+		return ((mFrame + fish) % mMidInterval) == 0;
+	return false;
+}
+
+//True on the frame a fish is first frozen, so its velocity can be stopped
+bool FishScheduler::wasFrozen(int fish) const
+{
+	return mTiers[fish] == TIER_FAR && mLastTiers[fish] != TIER_FAR;
+}
+
+//Number of live fish in a tier, shown on the debug overlay
+int FishScheduler::getTierCount(Tier tier) const
+{
+	return mTierCounts[tier];
+}
@@ -0,0 +1,71 @@
+#include "stdafx.h"
+#include "FishSchool.h"
+#include "LevelTextParser.h"
+
+/* Fish schools are read from each level's fish file, one school per line.
+ * The file uses the same comma separated format as the level object files.
+ */
+
+//Columns of a level fish file, in file order
+const LevelColumn SCHOOL_COLUMNS[] = {
+	{ "count",			LevelColumn::COLUMN_INT,	NULL },
+	{ "spawnX",			LevelColumn::COLUMN_REAL,	NULL },
+	{ "spawnY",			LevelColumn::COLUMN_REAL,	NULL },
+	{ "spawnZ",			LevelColumn::COLUMN_REAL,	NULL },
+	{ "spawnSpread",	LevelColumn::COLUMN_REAL,	"0" },
+	{ "variant",		LevelColumn::COLUMN_STRING,	"Normal" },
+	{ "minX",			LevelColumn::COLUMN_REAL,	"0" },
+	{ "minZ",			LevelColumn::COLUMN_REAL,	"0" },
+	{ "maxX",			LevelColumn::COLUMN_REAL,	"3000" },
+	{ "maxZ",			LevelColumn::COLUMN_REAL,	"3000" }
+};
+const int SCHOOL_COLUMN_COUNT = sizeof(SCHOOL_COLUMNS) / sizeof(SCHOOL_COLUMNS[0]);
+
+//Works out which material a fish in the school is drawn with
+FishRenderer::Variant FishSchool::getVariant(int fishInSchool) const
+{
+	if (variant == "Blue")
+		return FishRenderer::FISH_BLUE;
+	if (variant == "Mixed" && fishInSchool % 3 == 0)
+		return FishRenderer::FISH_BLUE;
+	return FishRenderer::FISH_NORMAL;
+}
+
+//Loads every school in a level's fish file, a missing file means no fish
+void FishSchool::loadSchools(const String &fileName, std::vector<FishSchool> &schools)
+{
+	schools.clear();
+
+	LevelTextParser file(SCHOOL_COLUMNS, SCHOOL_COLUMN_COUNT);
+	file.open(fileName);
+
+	while(file.nextLine()) {
+		FishSchool school;
+		school.count = file.getInt(0);
+		school.spawnCentre = Vector3(file.getReal(1), file.getReal(2), file.getReal(3));
+		school.spawnSpread = file.getReal(4);
+		school.variant = file.getString(5);
+		school.minX = file.getReal(6);
+		school.minZ = file.getReal(7);
+		school.maxX = file.getReal(8);
+		school.maxZ = file.getReal(9);
+		school.alive = 0;
+
+		if (school.count > 0)
+			schools.push_back(school);
+	}
+}
+
+//Constructor
+Fish::Fish() :
+	body(NULL), deadBody(NULL), deadShape(NULL), node(NULL), deadNode(NULL), deadEntity(NULL),
+	bodyInWorld(false), deadBodyInWorld(false), active(false), dead(false), school(0),
+	variant(FishRenderer::FISH_NORMAL), lastMove(0), lastDirection(1, -0.2, 1)
+{
+}
+
+//Whichever body currently represents the fish in the physics world
+OgreBulletDynamics::RigidBody* Fish::getBody(void) const
+{
+	return dead ? deadBody : body;
+}
@@ -0,0 +1,68 @@
+#include "stdafx.h"
+#include "GameEvents.h"
+#include <algorithm>
+
+/* Passes gameplay events from the collision callback to the systems that care about them.
+ * The callback only records what happened, as the physics world can't be changed during its step.
+ * Events are handed to their subscribers once per frame, so scoring, the HUD and level end checks
+ * only do work on the frames where something actually happened.
+ */
+
+//Constructor
+GameEvents::GameEvents()
+{
+}
+
+//Destructor
+GameEvents::~GameEvents()
+{
+}
+
+//Registers a listener for one type of event
+void GameEvents::subscribe(EventType type, Listener* listener)
+{
+	mListeners[type].push_back(listener);
+}
+
+//Stops a listener receiving any events
+void GameEvents::unsubscribe(Listener* listener)
+{
+	for (int type = 0; type < EVENT_TYPES; type++)
+	{
+		std::vector<Listener *> &listeners = mListeners[type];
+		listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+	}
+}
+
+//Queues an event, safe to call from inside the physics step
+void GameEvents::publish(EventType type, const btCollisionObject* body)
+{
+	Event event;
+	event.type = type;
+	event.body = body;
+	mQueue.push_back(event);
+}
+
+//Hands every queued event to its subscribers in the order they were published, returns whether there were any
+bool GameEvents::dispatch(void)
+{
+	if (mQueue.empty())
+		return false;
+
+	mDelivering.swap(mQueue);
+	for (unsigned int i = 0; i < mDelivering.size(); i++)
+	{
+		const Event &event = mDelivering[i];
+		const std::vector<Listener *> &listeners = mListeners[event.type];
+		for (unsigned int l = 0; l < listeners.size(); l++)
+			listeners[l]->gameEvent(event);
+	}
+	mDelivering.clear();
+	return true;
+}
+
+//Drops queued events, used when the bodies they refer to are about to be destroyed
+void GameEvents::clear(void)
+{
+	mQueue.clear();
+}
@@ -0,0 +1,271 @@
+#include "stdafx.h"
+#include "HUDLayer.h"
+#include "ReflectionUpdater.h"
+
+/* Draws every HUD string straight onto the screen in one batch, with one material.
+ * Each field owns a fixed run of quads in a single vertex buffer sized when the layer is built. Setting
+ * a field's text only marks it dirty if the text really changed, and dirty fields rewrite just their own
+ * quads before the frame is drawn. Unused characters are collapsed to nothing, so the draw call never
+ * changes size. Numbers and times are formatted into the field's own characters rather than through
+ * strings, so updating the HUD allocates nothing.
+ */
+
+//Vertex buffer bindings, and floats per vertex in the position and texture buffer
+const unsigned short POS_TEX_BINDING = 0;
+const unsigned short COLOUR_BINDING = 1;
+const int FLOATS_PER_VERTEX = 5;
+
+//Constructor
+HUDLayer::HUDLayer(const String &fontName, Viewport* viewport) :
+	mViewport(viewport), mScreenAspect(0), mVertexCount(0)
+{
+	mFont = (Font *)FontManager::getSingleton().getByName(fontName).getPointer();
+	if (!mFont)
+		throw Exception(Exception::ERR_ITEM_NOT_FOUND, "Could not find font " + fontName, "HUDLayer::HUDLayer");
+	mFont->load();
+
+	mGlyphs = MovableText::getGlyphCache(mFont);
+
+	String materialName = "HUDLayer/" + fontName;
+	MaterialPtr material = MaterialManager::getSingleton().getByName(materialName);
+	if (material.isNull())
+	{
+		material = mFont->getMaterial()->clone(materialName);
+		material->setDepthCheckEnabled(false);
+		material->setDepthWriteEnabled(false);
+		material->setLightingEnabled(false);
+		material->setCullingMode(CULL_NONE);
+		material->load();
+	}
+	setMaterial(materialName);
+
+	//Drawn straight in screen space after everything else, and never culled
+	setUseIdentityProjection(true);
+	setUseIdentityView(true);
+	setRenderQueueGroup(RENDER_QUEUE_OVERLAY);
+	AxisAlignedBox bounds;
+	bounds.setInfinite();
+	setBoundingBox(bounds);
+	setCastShadows(false);
+	setQueryFlags(0);
+	removeVisibilityFlags(VISIBLE_IN_REFLECTION);
+
+	mRenderOp.vertexData = NULL;
+	mRenderOp.indexData = NULL;
+	mRenderOp.operationType = RenderOperation::OT_TRIANGLE_LIST;
+	mRenderOp.useIndexes = false;
+}
+
+//Destructor
+HUDLayer::~HUDLayer()
+{
+	delete mRenderOp.vertexData;
+}
+
+//Adds a field centred on x with its bottom at y, in screen coordinates from -1 to 1, returns its index
+int HUDLayer::addField(Real x, Real y, Real charHeight, const ColourValue &colour, int capacity)
+{
+	Field field;
+	field.x = x;
+	field.y = y;
+	field.charHeight = charHeight;
+	field.colour = colour;
+	field.capacity = (capacity > MAX_FIELD_CHARS) ? MAX_FIELD_CHARS : capacity;
+	field.firstVertex = mVertexCount;
+	field.visible = true;
+	field.dirty = true;
+	field.text[0] = 0;
+	mFields.push_back(field);
+	mVertexCount += field.capacity * 6;
+	return mFields.size() - 1;
+}
+
+//Makes the vertex buffers once every field has been added, colours are written here and never change
+void HUDLayer::build(void)
+{
+	delete mRenderOp.vertexData;
+	mRenderOp.vertexData = new VertexData();
+	mRenderOp.vertexData->vertexStart = 0;
+	mRenderOp.vertexData->vertexCount = mVertexCount;
+
+	VertexDeclaration* decl = mRenderOp.vertexData->vertexDeclaration;
+	decl->addElement(POS_TEX_BINDING, 0, VET_FLOAT3, VES_POSITION);
+	decl->addElement(POS_TEX_BINDING, VertexElement::getTypeSize(VET_FLOAT3), VET_FLOAT2, VES_TEXTURE_COORDINATES, 0);
+	decl->addElement(COLOUR_BINDING, 0, VET_COLOUR, VES_DIFFUSE);
+
+	HardwareVertexBufferSharedPtr positions = HardwareBufferManager::getSingleton().createVertexBuffer(
+		decl->getVertexSize(POS_TEX_BINDING), mVertexCount, HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+	mRenderOp.vertexData->vertexBufferBinding->setBinding(POS_TEX_BINDING, positions);
+	HardwareVertexBufferSharedPtr colours = HardwareBufferManager::getSingleton().createVertexBuffer(
+		decl->getVertexSize(COLOUR_BINDING), mVertexCount, HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+	mRenderOp.vertexData->vertexBufferBinding->setBinding(COLOUR_BINDING, colours);
+
+	RGBA* colour = static_cast<RGBA*>(colours->lock(HardwareBuffer::HBL_DISCARD));
+	for (unsigned int f = 0; f < mFields.size(); f++)
+	{
+		RGBA fieldColour;
+		Root::getSingleton().convertColourValue(mFields[f].colour, &fieldColour);
+		for (int v = 0; v < mFields[f].capacity * 6; v++)
+			*colour++ = fieldColour;
+		mFields[f].dirty = true;
+	}
+	colours->unlock();
+
+	mScratch.resize(MAX_FIELD_CHARS * 6 * FLOATS_PER_VERTEX);
+}
+
+//Sets a field's text, the field is only rewritten if it changed
+void HUDLayer::changeText(int field, const char* text)
+{
+	Field &target = mFields[field];
+	if (strncmp(target.text, text, target.capacity) == 0)
+		return;
+
+	strncpy(target.text, text, target.capacity);
+	target.text[target.capacity] = 0;
+	target.dirty = true;
+}
+
+//Shows some text, anything past the field's capacity is cut off
+void HUDLayer::setText(int field, const char* text)
+{
+	changeText(field, text);
+}
+
+//Shows a label followed by a number, e.g. "Score: " and 1500
+void HUDLayer::setNumber(int field, const char* label, int number)
+{
+	char text[MAX_FIELD_CHARS + 16];
+	int length = 0;
+	while (label[length] && length < MAX_FIELD_CHARS)
+	{
+		text[length] = label[length];
+		length++;
+	}
+	formatNumber(text + length, number);
+	changeText(field, text);
+}
+
+//Shows a time as minutes and seconds, e.g. 2:05
+void HUDLayer::setTime(int field, unsigned long milliseconds)
+{
+	char text[24];
+	int seconds = (int) (milliseconds / 1000);
+	int length = formatNumber(text, seconds / 60);
+	text[length++] = ':';
+	text[length++] = (char) ('0' + (seconds % 60) / 10);
+	text[length++] = (char) ('0' + seconds % 10);
+	text[length] = 0;
+	changeText(field, text);
+}
+
+//Writes a number's digits, returns how many characters were written not counting the terminator
+int HUDLayer::formatNumber(char* out, int number)
+{
+	char digits[12];
+	int count = 0;
+	unsigned int value = (number < 0) ? (unsigned int) -number : (unsigned int) number;
+	do
+	{
+		digits[count++] = (char) ('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+
+	int length = 0;
+	if (number < 0)
+		out[length++] = '-';
+	while (count > 0)
+		out[length++] = digits[--count];
+	out[length] = 0;
+	return length;
+}
+
+//Hides or shows a field, hidden fields keep their text
+void HUDLayer::setFieldVisible(int field, bool visible)
+{
+	if (mFields[field].visible == visible)
+		return;
+	mFields[field].visible = visible;
+	mFields[field].dirty = true;
+}
+
+//Builds a field's quads and writes them over its run of the vertex buffer
+void HUDLayer::writeField(int field)
+{
+	Field &target = mFields[field];
+	float* vertex = &mScratch[0];
+
+	//Measure the text so it can be centred
+	Real width = 0;
+	int length = 0;
+	for (; length < target.capacity && target.text[length]; length++)
+		width += mGlyphs->aspectRatios[(unsigned char) target.text[length]];
+	Real scale = target.charHeight / mScreenAspect;
+	Real left = target.x - width * scale / 2;
+	Real bottom = target.y;
+	Real top = target.y + target.charHeight;
+
+	for (int c = 0; c < target.capacity; c++)
+	{
+		//Unused and hidden characters are collapsed onto one point
+		Real x1 = left, x2 = left, y1 = bottom, y2 = bottom;
+		Font::UVRect uv(0, 0, 0, 0);
+		if (target.visible && c < length)
+		{
+			unsigned char glyph = (unsigned char) target.text[c];
+			x2 = left + mGlyphs->aspectRatios[glyph] * scale;
+			y1 = top;
+			uv = mGlyphs->uvs[glyph];
+			left = x2;
+		}
+
+		//Two tris: upper left, bottom left, top right, then top right, bottom left, bottom right
+		Real corners[6][4] = {
+			{ x1, y1, uv.left, uv.top }, { x1, y2, uv.left, uv.bottom }, { x2, y1, uv.right, uv.top },
+			{ x2, y1, uv.right, uv.top }, { x1, y2, uv.left, uv.bottom }, { x2, y2, uv.right, uv.bottom } };
+		for (int v = 0; v < 6; v++)
+		{
+			*vertex++ = corners[v][0];
+			*vertex++ = corners[v][1];
+			*vertex++ = -1.0f;
+			*vertex++ = corners[v][2];
+			*vertex++ = corners[v][3];
+		}
+	}
+
+	HardwareVertexBufferSharedPtr positions = mRenderOp.vertexData->vertexBufferBinding->getBuffer(POS_TEX_BINDING);
+	size_t vertexSize = positions->getVertexSize();
+	positions->writeData(target.firstVertex * vertexSize, target.capacity * 6 * vertexSize, &mScratch[0]);
+	target.dirty = false;
+}
+
+//Text has no depth to sort by
+Real HUDLayer::getSquaredViewDepth(const Camera* cam) const
+{
+	return 0;
+}
+
+//Covers the whole screen
+Real HUDLayer::getBoundingRadius(void) const
+{
+	return 0;
+}
+
+//Rewrites dirty fields, or all of them if the window's shape has changed, then queues the batch
+void HUDLayer::_updateRenderQueue(RenderQueue* queue)
+{
+	//Water reflections are drawn with the player's camera too
+	if (!mRenderOp.vertexData || (mCamera && mCamera->isReflected()))
+		return;
+
+	Real aspect = (Real) mViewport->getActualWidth() / mViewport->getActualHeight();
+	bool resized = (aspect != mScreenAspect);
+	mScreenAspect = aspect;
+	for (unsigned int f = 0; f < mFields.size(); f++)
+	{
+		if (mFields[f].dirty || resized)
+			writeField(f);
+	}
+
+	queue->addRenderable(this, mRenderQueueID, OGRE_RENDERABLE_DEFAULT_PRIORITY);
+}
@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "HighScoreStore.h"
+
+/* Keeps the best runs of every built in level in one small binary file.
+ * The file is read once at start up and the tables stay in memory, so menus can ask for scores
+ * as often as they like. A new entry rewrites the whole file, which is only a few KB, through
+ * the background writer so the level complete screen never waits on the disk.
+ */
+
+const char HIGH_SCORE_MAGIC[4] = { 'P', 'G', 'H', 'S' };
+//Built in levels that had a LevelNHighScore.txt before this file existed
+const int TEXT_SCORE_LEVELS = 3;
+
+//Constructor
+HighScoreStore::HighScoreStore(BackgroundWriter* writer, const String &fileName) :
+	mWriter(writer), mFileName(fileName)
+{
+}
+
+//Destructor
+HighScoreStore::~HighScoreStore()
+{
+}
+
+//Reads the score file, falling back to the old per level text files the first time
+void HighScoreStore::load(void)
+{
+	mTables.clear();
+	if (loadTables())
+		return;
+
+	mTables.clear();
+	importTextScores();
+	if (!mTables.empty())
+		save();
+}
+
+//Reads and checks every table in the score file
+bool HighScoreStore::loadTables(void)
+{
+	std::ifstream file(mFileName.c_str(), std::ios::in | std::ios::binary);
+	if (!file)
+		return false;
+
+	Header header;
+	if (!file.read((char*) &header, sizeof(header)) || memcmp(header.magic, HIGH_SCORE_MAGIC, 4) != 0
+		|| header.version != VERSION || header.entriesPerTable != TOP_ENTRIES)
+	{
+		LogManager::getSingleton().logMessage("HighScoreStore: " + mFileName + " is not a valid score file");
+		return false;
+	}
+
+	for (Ogre::uint32 t = 0; t < header.tableCount; t++)
+	{
+		Table table;
+		if (!file.read((char*) &table, sizeof(table)) || table.count > TOP_ENTRIES)
+		{
+			LogManager::getSingleton().logMessage("HighScoreStore: " + mFileName + " is truncated");
+			return false;
+		}
+		mTables[table.levelId] = table;
+	}
+	return true;
+}
+
+//Brings scores over from the LevelNHighScore.txt files used before
+void HighScoreStore::importTextScores(void)
+{
+	for (int level = 1; level <= TEXT_SCORE_LEVELS; level++)
+	{
+		std::ifstream objects(("../../res/Levels/Level"+StringConverter::toString(level)+"HighScore.txt").c_str());
+		std::string line;
+		float score = 0;
+		while(std::getline(objects, line)) {
+			if(line.substr(0, 1) != "#") { //Ignore comments in file
+				score = StringConverter::parseReal(line);
+			}
+		}
+
+		if (score > 0)
+		{
+			Table &table = mTables[level];
+			memset(&table, 0, sizeof(table));
+			table.levelId = level;
+			table.count = 1;
+			table.entries[0].score = score;
+		}
+	}
+}
+
+//Queues the whole file on the background writer
+void HighScoreStore::save(void)
+{
+	Header header;
+	memcpy(header.magic, HIGH_SCORE_MAGIC, 4);
+	header.version = VERSION;
+	header.tableCount = mTables.size();
+	header.entriesPerTable = TOP_ENTRIES;
+
+	String contents;
+	contents.reserve(sizeof(Header) + mTables.size() * sizeof(Table));
+	contents.append((const char*) &header, sizeof(header));
+	for (std::map<int, Table>::const_iterator it = mTables.begin(); it != mTables.end(); ++it)
+		contents.append((const char*) &it->second, sizeof(Table));
+
+	mWriter->write(mFileName, contents);
+}
+
+//Returns a level's table, or NULL if it has no scores yet
+const HighScoreStore::Table* HighScoreStore::findTable(int levelId) const
+{
+	std::map<int, Table>::const_iterator found = mTables.find(levelId);
+	return (found == mTables.end()) ? NULL : &found->second;
+}
+
+//Best score for a level, 0 if it hasn't been completed
+float HighScoreStore::getBest(int levelId) const
+{
+	const Table* table = findTable(levelId);
+	return (table && table->count > 0) ? table->entries[0].score : 0;
+}
+
+//Number of runs kept for a level
+unsigned int HighScoreStore::getEntryCount(int levelId) const
+{
+	const Table* table = findTable(levelId);
+	return table ? table->count : 0;
+}
+
+//One of a level's runs, rank 0 is the best
+const HighScoreEntry& HighScoreStore::getEntry(int levelId, unsigned int rank) const
+{
+	return findTable(levelId)->entries[rank];
+}
+
+//Adds a finished run, returns its rank or -1 if it didn't make the table. Ties go to the newer run
+int HighScoreStore::submit(int levelId, float score, double timeMillis, int coconuts)
+{
+	Table &table = mTables[levelId];
+	if (table.levelId != levelId || table.count > TOP_ENTRIES)
+	{
+		memset(&table, 0, sizeof(table));
+		table.levelId = levelId;
+	}
+
+	unsigned int rank = 0;
+	while (rank < table.count && table.entries[rank].score > score)
+		rank++;
+	if (rank >= TOP_ENTRIES)
+		return -1;
+
+	unsigned int last = (table.count < TOP_ENTRIES) ? table.count : TOP_ENTRIES - 1;
+	for (unsigned int i = last; i > rank; i--)
+		table.entries[i] = table.entries[i - 1];
+	if (table.count < TOP_ENTRIES)
+		table.count++;
+
+	HighScoreEntry &entry = table.entries[rank];
+	entry.score = score;
+	entry.timeMillis = (Ogre::uint32) timeMillis;
+	entry.coconuts = coconuts;
+	entry.reserved = 0;
+
+	save();
+	return rank;
+}
@@ -0,0 +1,291 @@
+#include "stdafx.h"
+#include "ImpostorRenderer.h"
+
+/* Swaps distant palms and props for camera facing billboards.
+ * The first time a mesh is used its atlas is baked: the mesh is rendered from a number of directions around
+ * its up axis into one texture, in a scene manager of its own. Objects are added in groups matching the
+ * batches and static geometry cells that draw their meshes, and each frame a group's distance from the camera
+ * decides what is drawn. Billboards fade in over the fade range, the group's meshes are hidden past the swap
+ * distance, and each billboard shows the baked view closest to the direction it is seen from.
+ */
+
+//Constructor
+ImpostorRenderer::ImpostorRenderer(SceneManager* sceneMgr) :
+	mSceneMgr(sceneMgr), mBakeSceneMgr(NULL), mBakeCamera(NULL),
+	mDistance(1500), mFadeRange(300), mAngles(8), mTileSize(128)
+{
+	mBillboardNode = mSceneMgr->getRootSceneNode()->createChildSceneNode();
+}
+
+//Destructor
+ImpostorRenderer::~ImpostorRenderer()
+{
+	clear();
+	for (std::map<String, Atlas>::iterator it = mAtlases.begin(); it != mAtlases.end(); ++it)
+		mSceneMgr->destroyBillboardSet(it->second.billboards);
+	mSceneMgr->destroySceneNode(mBillboardNode);
+	if (mBakeSceneMgr)
+		Root::getSingleton().destroySceneManager(mBakeSceneMgr);
+}
+
+//Reads the swap distance, atlas layout and meshes from the settings file, keeping the defaults if it can't be read
+void ImpostorRenderer::loadSettings(const String &fileName)
+{
+	ConfigFile config;
+	try
+	{
+		config.loadFromResourceSystem(fileName, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME, "=", true);
+	}
+	catch (Ogre::Exception& e)
+	{
+		LogManager::getSingleton().logMessage("ImpostorRenderer: could not load " + fileName + ", no meshes get billboards");
+		return;
+	}
+
+	mDistance = StringConverter::parseReal(config.getSetting("Distance"), mDistance);
+	mFadeRange = StringConverter::parseReal(config.getSetting("FadeRange"), mFadeRange);
+	mAngles = StringConverter::parseInt(config.getSetting("Angles"), mAngles);
+	mTileSize = StringConverter::parseInt(config.getSetting("TileSize"), mTileSize);
+	mMeshes = config.getMultiSetting("Mesh");
+
+	if (mAngles < 1)
+		mAngles = 1;
+	if (!Bitwise::isPO2(mTileSize) || mTileSize < 16)
+		mTileSize = 128;
+	if (mFadeRange < 0)
+		mFadeRange = 0;
+	if (mFadeRange > mDistance)
+		mFadeRange = mDistance;
+}
+
+//Whether a mesh is listed in the settings
+bool ImpostorRenderer::hasImpostor(const String &mesh) const
+{
+	return std::find(mMeshes.begin(), mMeshes.end(), mesh) != mMeshes.end();
+}
+
+//Starts a new group, returns its index until the next clear
+int ImpostorRenderer::addGroup(void)
+{
+	Group group;
+	group.fade = 0;
+	group.shown = false;
+	mGroups.push_back(group);
+	return mGroups.size() - 1;
+}
+
+/* Atlas for a mesh, baked the first time the mesh is used. Whichever of the mesh's axes is nearest
+ * to straight up for that first object is treated as up for every object using the mesh */
+ImpostorRenderer::Atlas& ImpostorRenderer::getAtlas(const String &mesh, const Quaternion &orientation)
+{
+	std::map<String, Atlas>::iterator found = mAtlases.find(mesh);
+	if (found != mAtlases.end())
+		return found->second;
+
+	Vector3 up = orientation.Inverse() * Vector3::UNIT_Y;
+	Vector3 axis = Vector3::UNIT_X * ((up.x < 0) ? -1 : 1);
+	if (Math::Abs(up.y) > Math::Abs(up.x) && Math::Abs(up.y) >= Math::Abs(up.z))
+		axis = Vector3::UNIT_Y * ((up.y < 0) ? -1 : 1);
+	else if (Math::Abs(up.z) > Math::Abs(up.x))
+		axis = Vector3::UNIT_Z * ((up.z < 0) ? -1 : 1);
+
+	Atlas atlas;
+	atlas.bakeRotation = axis.getRotationTo(Vector3::UNIT_Y);
+	bake(mesh, atlas);
+	return mAtlases.insert(std::make_pair(mesh, atlas)).first->second;
+}
+
+//Renders the mesh from every direction into its atlas and makes the billboard set that draws from it
+void ImpostorRenderer::bake(const String &mesh, Atlas &atlas)
+{
+	if (!mBakeSceneMgr)
+	{
+		mBakeSceneMgr = Root::getSingleton().createSceneManager(ST_GENERIC, "ImpostorBaker");
+		mBakeSceneMgr->setAmbientLight(ColourValue(0.6f, 0.6f, 0.6f));
+		Light* sun = mBakeSceneMgr->createLight("ImpostorSun");
+		sun->setType(Light::LT_DIRECTIONAL);
+		sun->setDirection(Vector3(-0.3f, -1, -0.5f).normalisedCopy());
+		sun->setDiffuseColour(ColourValue(0.8f, 0.8f, 0.8f));
+		mBakeCamera = mBakeSceneMgr->createCamera("ImpostorCamera");
+		mBakeCamera->setProjectionType(PT_ORTHOGRAPHIC);
+		mBakeCamera->setAutoAspectRatio(false);
+	}
+
+	Entity* entity = mBakeSceneMgr->createEntity(mesh);
+	SceneNode* node = mBakeSceneMgr->getRootSceneNode()->createChildSceneNode();
+	node->attachObject(entity);
+
+	//Bounds of the mesh once turned upright, the width covers it from every direction
+	AxisAlignedBox bounds = entity->getMesh()->getBounds();
+	AxisAlignedBox upright;
+	const Vector3* corners = bounds.getAllCorners();
+	for (int c = 0; c < 8; c++)
+		upright.merge(atlas.bakeRotation * corners[c]);
+	atlas.centre = upright.getCenter();
+	Real radius = 0;
+	for (int c = 0; c < 8; c++)
+	{
+		Vector3 offset = atlas.bakeRotation * corners[c] - atlas.centre;
+		Real across = Math::Sqrt(offset.x * offset.x + offset.z * offset.z);
+		radius = (across > radius) ? across : radius;
+	}
+	atlas.width = radius * 2;
+	atlas.height = upright.getSize().y;
+
+	Real depth = upright.getHalfSize().length();
+	mBakeCamera->setOrthoWindow(atlas.width, atlas.height);
+	mBakeCamera->setPosition(0, 0, depth * 2);
+	mBakeCamera->lookAt(Vector3::ZERO);
+	mBakeCamera->setNearClipDistance(depth * 0.5f);
+	mBakeCamera->setFarClipDistance(depth * 4);
+
+	TexturePtr texture = TextureManager::getSingleton().createManual("Impostor/" + mesh, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+		TEX_TYPE_2D, mTileSize * mAngles, mTileSize, MIP_UNLIMITED, PF_A8R8G8B8, TU_RENDERTARGET | TU_AUTOMIPMAP);
+	RenderTarget* target = texture->getBuffer()->getRenderTarget();
+	target->setAutoUpdated(false);
+	for (int i = 0; i < mAngles; i++)
+	{
+		Viewport* viewport = target->addViewport(mBakeCamera, i, (Real) i / mAngles, 0, 1.0f / mAngles, 1);
+		viewport->setBackgroundColour(ColourValue(0, 0, 0, 0));
+		viewport->setClearEveryFrame(true);
+		viewport->setOverlaysEnabled(false);
+		viewport->setSkiesEnabled(false);
+		viewport->setShadowsEnabled(false);
+	}
+
+	//Turning the mesh the opposite way to each view is the same as moving the camera around it
+	target->_beginUpdate();
+	for (int i = 0; i < mAngles; i++)
+	{
+		Quaternion turn(Radian(-Math::TWO_PI * i / mAngles), Vector3::UNIT_Y);
+		node->setOrientation(turn * atlas.bakeRotation);
+		node->setPosition(-(turn * atlas.centre));
+		target->_updateViewport(i, false);
+	}
+	target->_endUpdate();
+	target->removeAllViewports();
+
+	node->detachAllObjects();
+	mBakeSceneMgr->destroyEntity(entity);
+	mBakeSceneMgr->destroySceneNode(node);
+
+	MaterialPtr material = MaterialManager::getSingleton().getByName("Impostor")->clone("Impostor/" + mesh);
+	material->getTechnique(0)->getPass(0)->getTextureUnitState(0)->setTextureName(texture->getName());
+
+	atlas.billboards = mSceneMgr->createBillboardSet("Impostor/" + mesh);
+	atlas.billboards->setMaterialName(material->getName());
+	atlas.billboards->setBillboardType(BBT_ORIENTED_COMMON);
+	atlas.billboards->setCommonDirection(Vector3::UNIT_Y);
+	atlas.billboards->setTextureStacksAndSlices(1, (Ogre::uchar) mAngles);
+	atlas.billboards->setAutoextend(true);
+	atlas.billboards->setSortingEnabled(true);
+	atlas.billboards->setCastShadows(false);
+	mBillboardNode->attachObject(atlas.billboards);
+
+	LogManager::getSingleton().logMessage("ImpostorRenderer: baked " + StringConverter::toString(mAngles) + " views of " + mesh);
+}
+
+//Adds a billboard for an object, it stays hidden until its group is far enough away
+void ImpostorRenderer::add(int group, const String &mesh, const Vector3 &position, const Quaternion &orientation, const Vector3 &scale)
+{
+	Atlas &atlas = getAtlas(mesh, orientation);
+
+	Impostor impostor;
+	impostor.centre = position + orientation * (scale * (atlas.bakeRotation.Inverse() * atlas.centre));
+	impostor.toBakeFrame = atlas.bakeRotation * orientation.Inverse();
+	impostor.width = atlas.width * scale.x;
+	impostor.height = atlas.height * scale.y;
+	impostor.billboards = atlas.billboards;
+	impostor.billboard = atlas.billboards->createBillboard(impostor.centre, ColourValue(1, 1, 1, 0));
+	impostor.billboard->setDimensions(0, 0);
+
+	Group &target = mGroups[group];
+	target.impostors.push_back(impostor);
+	target.bounds.merge(AxisAlignedBox(impostor.centre - Vector3(impostor.width, impostor.height, impostor.width) * 0.5f,
+		impostor.centre + Vector3(impostor.width, impostor.height, impostor.width) * 0.5f));
+	target.fade = 0;
+	target.shown = false;
+}
+
+//Removes a group's billboards so it can be filled again, the group index stays valid
+void ImpostorRenderer::clearGroup(int group)
+{
+	Group &target = mGroups[group];
+	for (unsigned int i = 0; i < target.impostors.size(); i++)
+		target.impostors[i].billboards->removeBillboard(target.impostors[i].billboard);
+	target.impostors.clear();
+	target.bounds.setNull();
+	target.fade = 0;
+	target.shown = false;
+}
+
+//Removes every group and billboard, atlases are kept for the next level
+void ImpostorRenderer::clear(void)
+{
+	for (std::map<String, Atlas>::iterator it = mAtlases.begin(); it != mAtlases.end(); ++it)
+		it->second.billboards->clear();
+	mGroups.clear();
+}
+
+//Works out each group's fade from its distance to the camera and points far billboards at their nearest view
+void ImpostorRenderer::update(const Camera* camera)
+{
+	Vector3 eye = camera->getDerivedPosition();
+	Real fadeStart = mDistance - mFadeRange;
+	Real step = Math::TWO_PI / mAngles;
+
+	for (unsigned int g = 0; g < mGroups.size(); g++)
+	{
+		Group &group = mGroups[g];
+		if (group.impostors.empty())
+			continue;
+
+		//Distance to the nearest point of the group's bounds
+		Vector3 nearest = eye;
+		nearest.makeFloor(group.bounds.getMaximum());
+		nearest.makeCeil(group.bounds.getMinimum());
+		Real distance = eye.distance(nearest);
+		if (distance <= fadeStart)
+			group.fade = 0;
+		else if (distance >= mDistance || mFadeRange <= 0)
+			group.fade = 1;
+		else
+			group.fade = (distance - fadeStart) / mFadeRange;
+
+		//Near groups only need their billboards shrinking away once
+		if (group.fade == 0)
+		{
+			if (group.shown)
+			{
+				for (unsigned int i = 0; i < group.impostors.size(); i++)
+					group.impostors[i].billboard->setDimensions(0, 0);
+				group.shown = false;
+			}
+			continue;
+		}
+
+		ColourValue colour(1, 1, 1, group.fade);
+		for (unsigned int i = 0; i < group.impostors.size(); i++)
+		{
+			Impostor &impostor = group.impostors[i];
+			if (!group.shown)
+				impostor.billboard->setDimensions(impostor.width, impostor.height);
+			impostor.billboard->setColour(colour);
+
+			Vector3 view = impostor.toBakeFrame * (eye - impostor.centre);
+			Real angle = Math::ATan2(view.x, view.z).valueRadians();
+			if (angle < 0)
+				angle += Math::TWO_PI;
+			impostor.billboard->setTexcoordIndex((Ogre::uint16) ((int) Math::Floor(angle / step + 0.5f) % mAngles));
+		}
+		group.shown = true;
+	}
+}
+
+//Whether a group's meshes should still be drawn
+bool ImpostorRenderer::isNear(int group) const
+{
+	if (group < 0 || group >= (int) mGroups.size() || mGroups[group].impostors.empty())
+		return true;
+	return mGroups[group].fade < 1;
+}
@@ -0,0 +1,241 @@
+#include "stdafx.h"
+#include "LevelCatalog.h"
+#include "LevelTextParser.h"
+#include "MappedFile.h"
+
+/* Index of the custom levels in res/Levels/Custom, kept in Catalog.txt.
+ * At start up the index is read and checked against a listing of the folder. Only levels that are new,
+ * or whose size or modified time differ from the index, are opened and counted again, levels that have
+ * gone are dropped, and each newly saved level is added to it in memory and written in the background.
+ */
+
+const String CATALOG_FILE = "Catalog.txt";
+
+//Columns of the catalog file, in file order
+const LevelColumn CATALOG_COLUMNS[] = {
+	{ "id",			LevelColumn::COLUMN_INT,	NULL },
+	{ "island",		LevelColumn::COLUMN_INT,	NULL },
+	{ "objects",	LevelColumn::COLUMN_INT,	"0" },
+	{ "fileSize",	LevelColumn::COLUMN_UINT,	"0" },
+	{ "modified",	LevelColumn::COLUMN_UINT,	"0" }
+};
+const int CATALOG_COLUMN_COUNT = sizeof(CATALOG_COLUMNS) / sizeof(CATALOG_COLUMNS[0]);
+
+//Orders entries by level id
+bool entryBefore(const LevelCatalogEntry &a, const LevelCatalogEntry &b)
+{
+	return a.id < b.id;
+}
+
+//Constructor
+LevelCatalog::LevelCatalog(BackgroundWriter* writer, const String &directory) :
+	mWriter(writer), mDirectory(directory)
+{
+}
+
+//Destructor
+LevelCatalog::~LevelCatalog()
+{
+}
+
+//Reads the index and brings it up to date with the folder, building it from scratch if it doesn't exist
+void LevelCatalog::load(void)
+{
+	mEntries.clear();
+	bool changed = !readIndex();
+	if (scan())
+		changed = true;
+
+	if (changed)
+		save();
+}
+
+//Reads Catalog.txt, returns false if there isn't one
+bool LevelCatalog::readIndex(void)
+{
+	if (GetFileAttributesA((mDirectory + CATALOG_FILE).c_str()) == INVALID_FILE_ATTRIBUTES)
+		return false;
+
+	LevelTextParser catalog(CATALOG_COLUMNS, CATALOG_COLUMN_COUNT);
+	if (!catalog.open(mDirectory + CATALOG_FILE))
+		return false;
+
+	while (catalog.nextLine())
+	{
+		LevelCatalogEntry entry;
+		entry.id = catalog.getInt(0);
+		entry.island = catalog.getInt(1);
+		entry.objectCount = catalog.getInt(2);
+		entry.fileSize = catalog.getUint(3);
+		entry.modified = catalog.getUint(4);
+		insert(entry);
+	}
+	return true;
+}
+
+/* Checks the index against every UserLevelNObjects.txt in the folder, returns whether anything changed.
+ * The listing gives each file's size and time, so unchanged levels are never opened */
+bool LevelCatalog::scan(void)
+{
+	std::vector<LevelCatalogEntry> entries;
+	bool changed = false;
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((mDirectory + "UserLevel*Objects.txt").c_str(), &found);
+	if (search != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			int id = atoi(found.cFileName + strlen("UserLevel"));
+			if (id <= 0)
+				continue;
+
+			const LevelCatalogEntry* indexed = find(id);
+			LevelCatalogEntry entry;
+			if (indexed && indexed->fileSize == found.nFileSizeLow && indexed->modified == toUnixTime(found.ftLastWriteTime))
+				entries.push_back(*indexed);
+			else if (readLevel(id, entry))
+			{
+				entries.push_back(entry);
+				changed = true;
+			}
+		} while (FindNextFileA(search, &found));
+		FindClose(search);
+	}
+
+	//Anything left in the index without a file has been deleted
+	if (entries.size() != mEntries.size())
+		changed = true;
+	std::sort(entries.begin(), entries.end(), entryBefore);
+	mEntries.swap(entries);
+
+	if (changed)
+		LogManager::getSingleton().logMessage("LevelCatalog: indexed " + StringConverter::toString(mEntries.size()) + " custom levels");
+	return changed;
+}
+
+//Reads one level's details from its files, returns false if it doesn't exist
+bool LevelCatalog::readLevel(int id, LevelCatalogEntry &entry) const
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(getLevelFile(id, "Objects.txt").c_str(), GetFileExInfoStandard, &attributes))
+		return false;
+
+	entry.id = id;
+	entry.island = 1;
+	entry.fileSize = attributes.nFileSizeLow;
+	entry.modified = toUnixTime(attributes.ftLastWriteTime);
+
+	std::ifstream island(getLevelFile(id, "Island.txt").c_str());
+	std::string line;
+	while(std::getline(island, line)) {
+		if(line.substr(0, 1) != "#") { //Ignore comments in file
+			entry.island = atoi(line.c_str());
+		}
+	}
+
+	MappedFile objects;
+	entry.objectCount = objects.open(getLevelFile(id, "Objects.txt")) ? countObjects(objects.getData(), objects.getSize()) : 0;
+	return true;
+}
+
+//Adds or replaces an entry, keeping them in id order
+void LevelCatalog::insert(const LevelCatalogEntry &entry)
+{
+	std::vector<LevelCatalogEntry>::iterator it = std::lower_bound(mEntries.begin(), mEntries.end(), entry, entryBefore);
+	if (it != mEntries.end() && it->id == entry.id)
+		*it = entry;
+	else
+		mEntries.insert(it, entry);
+}
+
+//Queues the index on the background writer
+void LevelCatalog::save(void)
+{
+	String contents = "# Custom level index, rebuilt from the level files if deleted\n# id, island, objects, fileSize, modified\n";
+	char line[96];
+	for (unsigned int i = 0; i < mEntries.size(); i++)
+	{
+		const LevelCatalogEntry &entry = mEntries[i];
+		sprintf_s(line, sizeof(line), "%d,%d,%d,%u,%u\n", entry.id, entry.island, entry.objectCount, entry.fileSize, entry.modified);
+		contents += line;
+	}
+	mWriter->write(mDirectory + CATALOG_FILE, contents);
+}
+
+//Number of custom levels
+unsigned int LevelCatalog::getCount(void) const
+{
+	return mEntries.size();
+}
+
+//Returns a level by its position in id order
+const LevelCatalogEntry& LevelCatalog::getEntry(unsigned int i) const
+{
+	return mEntries[i];
+}
+
+//Returns a level by id, or NULL if there is no such level
+const LevelCatalogEntry* LevelCatalog::find(int id) const
+{
+	LevelCatalogEntry key;
+	key.id = id;
+	std::vector<LevelCatalogEntry>::const_iterator it = std::lower_bound(mEntries.begin(), mEntries.end(), key, entryBefore);
+	return (it != mEntries.end() && it->id == id) ? &*it : NULL;
+}
+
+//Number a newly saved level should use
+int LevelCatalog::getNextId(void) const
+{
+	return mEntries.empty() ? 1 : mEntries.back().id + 1;
+}
+
+//Records a level that has just been queued for saving
+void LevelCatalog::add(int id, int island, const String &objectText)
+{
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+
+	LevelCatalogEntry entry;
+	entry.id = id;
+	entry.island = island;
+	entry.objectCount = countObjects(objectText.data(), objectText.size());
+	entry.fileSize = objectText.size();
+	//The file is written a moment later, so a mismatched time only means it is read once more next start up
+	entry.modified = toUnixTime(now);
+	insert(entry);
+	save();
+}
+
+//Counts the object lines in a level objects file, skipping blank lines and comments
+int LevelCatalog::countObjects(const char* data, size_t size)
+{
+	int count = 0;
+	const char* end = data + size;
+	while (data < end)
+	{
+		const char* lineEnd = (const char*) memchr(data, '\n', end - data);
+		if (!lineEnd)
+			lineEnd = end;
+
+		const char* p = data;
+		while (p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+			p++;
+		if (p < lineEnd && *p != '#')
+			count++;
+		data = lineEnd + 1;
+	}
+	return count;
+}
+
+//Path of one of a level's files
+String LevelCatalog::getLevelFile(int id, const String &suffix) const
+{
+	return mDirectory + "UserLevel" + StringConverter::toString(id) + suffix;
+}
+
+//Converts a file time to seconds since 1970
+Ogre::uint32 LevelCatalog::toUnixTime(const FILETIME &time)
+{
+	unsigned long long ticks = ((unsigned long long) time.dwHighDateTime << 32) | time.dwLowDateTime;
+	return (Ogre::uint32) (ticks / 10000000ULL - 11644473600ULL);
+}
@@ -0,0 +1,113 @@
+#include "stdafx.h"
+#include "LevelDescriptor.h"
+
+/* Each challenge level is described by a LevelN.level file in the levels folder.
+ * It lists the island, water, sky, player start, time limit and other per level facts,
+ * plus a manifest of the meshes, materials and textures the level uses so they can be
+ * loaded ahead of time. Anything missing from the file keeps the defaults set here.
+ */
+
+//Constructor
+LevelDescriptor::LevelDescriptor() :
+	mLevel(0), mIslandConfig("Island.cfg"), mHeightmap("terrain.png"), mOcean("PGOcean.hdx"), mSky(SKY_CAELUM),
+	mSpawnPosition(413, 166, 2534), mSpawnOrientation(Quaternion::IDENTITY), mSpawnDirection(Vector3::NEGATIVE_UNIT_Z),
+	mUseSpawnDirection(false), mLevelTime(0), mJengaPlatform(false), mNextLevel(0), mWinBonus(0), mPalmCount(0)
+{
+}
+
+//Destructor
+LevelDescriptor::~LevelDescriptor()
+{
+}
+
+//Descriptor file for a challenge level
+String LevelDescriptor::getFileName(int level)
+{
+	return "../../res/Levels/Level" + StringConverter::toString(level) + ".level";
+}
+
+//Reads a level's descriptor, returns false and keeps the defaults if it can't be read
+bool LevelDescriptor::load(int level)
+{
+	*this = LevelDescriptor();
+	mObjectFile = "Level" + StringConverter::toString(level) + "Objects.txt";
+	mFishFile = "Level" + StringConverter::toString(level) + "Fish.txt";
+
+	ConfigFile config;
+	try
+	{
+		config.load(getFileName(level), "=", true);
+	}
+	catch (Ogre::Exception& e)
+	{
+		LogManager::getSingleton().logMessage("LevelDescriptor: could not load " + getFileName(level) + ", using defaults");
+		return false;
+	}
+
+	//Only set once the file has been read, a level of 0 means no descriptor
+	mLevel = level;
+	mIslandConfig = config.getSetting("IslandConfig", StringUtil::BLANK, mIslandConfig);
+	mHeightmap = config.getSetting("Heightmap", StringUtil::BLANK, mHeightmap);
+	mOcean = config.getSetting("Ocean", StringUtil::BLANK, mOcean);
+	mObjectFile = config.getSetting("Objects", StringUtil::BLANK, mObjectFile);
+	mFishFile = config.getSetting("Fish", StringUtil::BLANK, mFishFile);
+	mLevelTime = StringConverter::parseInt(config.getSetting("LevelTime"), mLevelTime);
+	mJengaPlatform = StringConverter::parseBool(config.getSetting("JengaPlatform"), mJengaPlatform);
+	mNextLevel = StringConverter::parseInt(config.getSetting("NextLevel"), mNextLevel);
+	mWinBonus = StringConverter::parseInt(config.getSetting("WinBonus"), mWinBonus);
+
+	String sky = config.getSetting("Sky");
+	if (sky == "SkyX")
+		mSky = SKY_SKYX;
+	else if (sky == "CaelumClouds")
+		mSky = SKY_CAELUM_CLOUDS;
+	else if (!sky.empty())
+		mSky = SKY_CAELUM;
+
+	mSpawnPosition = StringConverter::parseVector3(config.getSetting("SpawnPosition"), mSpawnPosition);
+	String direction = config.getSetting("SpawnDirection");
+	if (!direction.empty())
+	{
+		mSpawnDirection = StringConverter::parseVector3(direction, mSpawnDirection);
+		mUseSpawnDirection = true;
+	}
+	else
+		mSpawnOrientation = StringConverter::parseQuaternion(config.getSetting("SpawnOrientation"), mSpawnOrientation);
+
+	mMeshes = config.getMultiSetting("Mesh", "Manifest");
+	mMaterials = config.getMultiSetting("Material", "Manifest");
+	mTextures = config.getMultiSetting("Texture", "Manifest");
+
+	StringVector probes = config.getMultiSetting("Probe", "Probes");
+	for (unsigned int i = 0; i < probes.size(); i++)
+		mProbes.push_back(StringConverter::parseVector3(probes[i]));
+
+	mPalmDensityMap = config.getSetting("PalmDensityMap", "Vegetation", mPalmDensityMap);
+	mPalmCount = StringConverter::parseInt(config.getSetting("PalmCount", "Vegetation"), mPalmCount);
+
+	loadObjectives(config.getMultiSetting("Win", "Objectives"), false);
+	loadObjectives(config.getMultiSetting("Lose", "Objectives"), true);
+	return true;
+}
+
+//Reads objectives written as "category amount" or "category amount above height", amount may be "all"
+void LevelDescriptor::loadObjectives(const StringVector &settings, bool lose)
+{
+	for (unsigned int i = 0; i < settings.size(); i++)
+	{
+		StringVector words = StringUtil::split(settings[i]);
+		if (words.size() != 2 && !(words.size() == 4 && words[2] == "above"))
+		{
+			LogManager::getSingleton().logMessage("LevelDescriptor: bad objective \"" + settings[i] + "\" in " + getFileName(mLevel));
+			continue;
+		}
+
+		LevelObjective objective;
+		objective.category = words[0];
+		objective.amount = (words[1] == "all") ? LevelObjective::ALL_OBJECTS : StringConverter::parseInt(words[1], 1);
+		objective.lose = lose;
+		objective.aboveHeight = (words.size() == 4);
+		objective.height = objective.aboveHeight ? StringConverter::parseReal(words[3]) : 0;
+		mObjectives.push_back(objective);
+	}
+}
@@ -23,18 +23,28 @@ bool LevelLoad::preLoad(const CEGUI::EventArgs& e) {
 // Loads the text file that determines which island is needed for the level to be loaded and
 // passes the value to loadLevel for creation
 void LevelLoad::load() {
-	std::ifstream island;
-	island.open("../../res/Levels/Custom/UserLevel"+mLevelName+"Island.txt");
-	std::string line;
-	int islandLevel;
-
-	while(std::getline(island, line)) { //Reads in each line of the file
-		if(line.substr(0, 1) != "#") { //Ignore comments in file
-			islandLevel = atoi(line.c_str());
+	mFrameListener->waitForSaves(); //The level may have only just been saved
+	int levelNumber = atoi(mLevelName.c_str());
+	int islandLevel = 1;
+
+	//The catalog already knows the island, the file is only read for levels it hasn't seen
+	const LevelCatalogEntry* level = mFrameListener->mLevelCatalog->find(levelNumber);
+	if(level != NULL) {
+		islandLevel = level->island;
+	}
+	else {
+		std::ifstream island;
+		island.open("../../res/Levels/Custom/UserLevel"+mLevelName+"Island.txt");
+		std::string line;
+
+		while(std::getline(island, line)) { //Reads in each line of the file
+			if(line.substr(0, 1) != "#") { //Ignore comments in file
+				islandLevel = atoi(line.c_str());
+			}
 		}
 	}
 
-	mFrameListener->loadLevel(atoi(mLevelName.c_str()), islandLevel, true);
+	mFrameListener->loadLevel(levelNumber, islandLevel, true);
 }
 
 // Destructor
@@ -0,0 +1,297 @@
+#include "stdafx.h"
+#include "LevelPack.h"
+#include "LevelTextParser.h"
+
+/* Level object text files are compiled into binary level packs the first time a level is loaded,
+ * and again whenever the text file changes. A pack holds one fixed size record per object with
+ * the object and mesh names already interned and the collision sizes already worked out, so
+ * loading a level only needs to map the file and hand each record to EnvironmentObject. Shapes and
+ * materials come from each name's archetype when the level loads, so they aren't stored here.
+ */
+
+const char PACK_MAGIC[4] = { 'P', 'G', 'L', 'P' };
+
+//Columns of a level object text file, in file order
+const LevelColumn OBJECT_COLUMNS[] = {
+	{ "name",			LevelColumn::COLUMN_STRING,	NULL },
+	{ "mesh",			LevelColumn::COLUMN_STRING,	NULL },
+	{ "posX",			LevelColumn::COLUMN_REAL,	NULL },
+	{ "posY",			LevelColumn::COLUMN_REAL,	NULL },
+	{ "posZ",			LevelColumn::COLUMN_REAL,	NULL },
+	{ "orientationW",	LevelColumn::COLUMN_REAL,	"1" },
+	{ "orientationX",	LevelColumn::COLUMN_REAL,	"0" },
+	{ "orientationY",	LevelColumn::COLUMN_REAL,	"0" },
+	{ "orientationZ",	LevelColumn::COLUMN_REAL,	"0" },
+	{ "scaleX",			LevelColumn::COLUMN_REAL,	"1" },
+	{ "scaleY",			LevelColumn::COLUMN_REAL,	"1" },
+	{ "scaleZ",			LevelColumn::COLUMN_REAL,	"1" },
+	{ "restitution",	LevelColumn::COLUMN_REAL,	"0.1" },
+	{ "friction",		LevelColumn::COLUMN_REAL,	"0.5" },
+	{ "mass",			LevelColumn::COLUMN_REAL,	"1" },
+	{ "animate",		LevelColumn::COLUMN_INT,	"0" },
+	{ "xMovement",		LevelColumn::COLUMN_REAL,	"0" },
+	{ "yMovement",		LevelColumn::COLUMN_REAL,	"0" },
+	{ "zMovement",		LevelColumn::COLUMN_REAL,	"0" },
+	{ "speed",			LevelColumn::COLUMN_REAL,	"1" },
+	{ "rotationX",		LevelColumn::COLUMN_REAL,	"0" },
+	{ "rotationY",		LevelColumn::COLUMN_REAL,	"0" },
+	{ "rotationZ",		LevelColumn::COLUMN_REAL,	"0" },
+	{ "billboard",		LevelColumn::COLUMN_INT,	"0" }
+};
+const int OBJECT_COLUMN_COUNT = sizeof(OBJECT_COLUMNS) / sizeof(OBJECT_COLUMNS[0]);
+
+//Constructor
+LevelPack::LevelPack() :
+	mData(NULL), mHeader(NULL),
+	mRecords(NULL), mStringOffsets(NULL), mStrings(NULL)
+{
+}
+
+//Destructor
+LevelPack::~LevelPack()
+{
+	close();
+}
+
+//Packs sit next to their text file, LevelNObjects.txt becomes LevelNObjects.pgl
+String LevelPack::getPackFileName(const String &textFile)
+{
+	String::size_type dot = textFile.find_last_of('.');
+	if (dot == String::npos)
+		return textFile + ".pgl";
+	return textFile.substr(0, dot) + ".pgl";
+}
+
+//Size and last write time of a text file, used to spot edited levels
+bool LevelPack::getSourceStamp(const String &textFile, Ogre::uint32 &size, Ogre::uint32 &timeLow, Ogre::uint32 &timeHigh)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(textFile.c_str(), GetFileExInfoStandard, &attributes))
+		return false;
+
+	size = attributes.nFileSizeLow;
+	timeLow = attributes.ftLastWriteTime.dwLowDateTime;
+	timeHigh = attributes.ftLastWriteTime.dwHighDateTime;
+	return true;
+}
+
+//A pack needs rebuilding if it is missing, from an older version or from a different text file
+bool LevelPack::isStale(const String &textFile, const String &packFile)
+{
+	Ogre::uint32 size, timeLow, timeHigh;
+	if (!getSourceStamp(textFile, size, timeLow, timeHigh))
+		return false; //Nothing to compile from, use whatever pack exists
+
+	std::ifstream pack(packFile.c_str(), std::ios::in | std::ios::binary);
+	Header header;
+	if (!pack.read((char*) &header, sizeof(header)))
+		return true;
+
+	return memcmp(header.magic, PACK_MAGIC, 4) != 0 || header.version != VERSION
+		|| header.sourceSize != size || header.sourceTimeLow != timeLow || header.sourceTimeHigh != timeHigh;
+}
+
+//Compiles a level object text file into a pack, see the text file's header for its format
+bool LevelPack::compile(const String &textFile, const String &packFile)
+{
+	Header header;
+	memcpy(header.magic, PACK_MAGIC, 4);
+	header.version = VERSION;
+	if (!getSourceStamp(textFile, header.sourceSize, header.sourceTimeLow, header.sourceTimeHigh))
+	{
+		LogManager::getSingleton().logMessage("LevelPack: can't find " + textFile);
+		return false;
+	}
+
+	LevelTextParser objects(OBJECT_COLUMNS, OBJECT_COLUMN_COUNT);
+	objects.open(textFile);
+	std::vector<LevelObjectRecord> records;
+	std::vector<String> strings;
+	std::map<String, Ogre::uint16> stringIds;
+	strings.push_back("");
+	stringIds[""] = 0;
+
+	while(objects.nextLine()) {
+		String name = objects.getString(0);
+		String mesh = objects.getString(1);
+
+		LevelObjectRecord record;
+		String names[2] = { name, mesh };
+		Ogre::uint16 ids[2];
+		for (int s = 0; s < 2; s++)
+		{
+			std::map<String, Ogre::uint16>::iterator found = stringIds.find(names[s]);
+			if (found == stringIds.end())
+			{
+				ids[s] = (Ogre::uint16) strings.size();
+				stringIds[names[s]] = ids[s];
+				strings.push_back(names[s]);
+			}
+			else
+				ids[s] = found->second;
+		}
+		record.name = ids[0];
+		record.mesh = ids[1];
+
+		for (int c = 0; c < 3; c++)
+		{
+			record.position[c] = objects.getReal(2 + c);
+			record.scale[c] = objects.getReal(9 + c);
+			record.movement[c] = objects.getReal(16 + c);
+			record.rotation[c] = objects.getReal(20 + c);
+		}
+		for (int c = 0; c < 4; c++)
+			record.orientation[c] = objects.getReal(5 + c);
+		record.restitution = objects.getReal(12);
+		record.friction = objects.getReal(13);
+		record.mass = objects.getReal(14);
+		record.animated = objects.getInt(15);
+		record.speed = objects.getReal(19);
+		record.billboard = objects.getInt(23);
+
+		//Same sizing EnvironmentObject uses for its collision shapes
+		Vector3 size = Vector3::ZERO;
+		try
+		{
+			MeshPtr meshPtr = MeshManager::getSingleton().load(mesh, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+			size = meshPtr->getBounds().getSize() * Vector3(record.scale[0], record.scale[1], record.scale[2]);
+			size /= 2.0f;
+			size *= 0.97f;
+		}
+		catch (Ogre::Exception& e)
+		{
+			LogManager::getSingleton().logMessage("LevelPack: skipping " + name + " on line " + StringConverter::toString(objects.getLineNumber())
+				+ " of " + textFile + ", " + e.getDescription());
+			continue;
+		}
+		record.collisionSize[0] = size.x;
+		record.collisionSize[1] = size.y;
+		record.collisionSize[2] = size.z;
+
+		records.push_back(record);
+	}
+
+	//Lay the file out as header, records, string offsets, string data
+	std::vector<Ogre::uint32> stringOffsets;
+	Ogre::uint32 stringBytes = 0;
+	for (unsigned int s = 0; s < strings.size(); s++)
+	{
+		stringOffsets.push_back(stringBytes);
+		stringBytes += strings[s].size() + 1;
+	}
+	header.recordCount = records.size();
+	header.recordOffset = sizeof(Header);
+	header.stringCount = strings.size();
+	header.stringOffset = header.recordOffset + header.recordCount * sizeof(LevelObjectRecord);
+	header.fileSize = header.stringOffset + header.stringCount * sizeof(Ogre::uint32) + stringBytes;
+
+	//Written to a temporary file first so a half written pack is never picked up
+	String tempFile = packFile + ".tmp";
+	std::ofstream pack(tempFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	pack.write((const char*) &header, sizeof(header));
+	if (!records.empty())
+		pack.write((const char*) &records[0], records.size() * sizeof(LevelObjectRecord));
+	pack.write((const char*) &stringOffsets[0], stringOffsets.size() * sizeof(Ogre::uint32));
+	for (unsigned int s = 0; s < strings.size(); s++)
+		pack.write(strings[s].c_str(), strings[s].size() + 1);
+	pack.close();
+
+	if (pack.fail() || !MoveFileExA(tempFile.c_str(), packFile.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		LogManager::getSingleton().logMessage("LevelPack: failed to write " + packFile);
+		DeleteFileA(tempFile.c_str());
+		return false;
+	}
+
+	LogManager::getSingleton().logMessage("LevelPack: compiled " + StringConverter::toString(records.size()) + " objects into " + packFile
+		+ ", skipped " + StringConverter::toString(objects.getErrorCount()) + " bad lines");
+	return true;
+}
+
+//Checks a header against the size of the file it came from
+bool LevelPack::isValidHeader(const Header &header, Ogre::uint32 fileSize)
+{
+	if (memcmp(header.magic, PACK_MAGIC, 4) != 0 || header.version != VERSION || header.fileSize != fileSize)
+		return false;
+	if (header.recordOffset != sizeof(Header) || header.recordCount > fileSize / sizeof(LevelObjectRecord))
+		return false;
+	if (header.stringOffset != header.recordOffset + header.recordCount * sizeof(LevelObjectRecord))
+		return false;
+	return header.stringCount > 0 && header.stringCount <= 0xFFFF
+		&& header.stringOffset + header.stringCount * sizeof(Ogre::uint32) <= fileSize;
+}
+
+//Maps a pack into memory, records are then read straight from the mapping
+bool LevelPack::open(const String &packFile)
+{
+	close();
+
+	if (!mFile.open(packFile))
+		return false;
+
+	Ogre::uint32 fileSize = mFile.getSize();
+	if (fileSize >= sizeof(Header))
+		mData = mFile.getData();
+
+	if (!mData || !isValidHeader(*(const Header*) mData, fileSize))
+	{
+		LogManager::getSingleton().logMessage("LevelPack: " + packFile + " is not a valid level pack");
+		close();
+		return false;
+	}
+
+	mHeader = (const Header*) mData;
+	mRecords = (const LevelObjectRecord*) (mData + mHeader->recordOffset);
+	mStringOffsets = (const Ogre::uint32*) (mData + mHeader->stringOffset);
+	mStrings = (const char*) (mStringOffsets + mHeader->stringCount);
+	return true;
+}
+
+//Unmaps the pack
+void LevelPack::close(void)
+{
+	mFile.close();
+	mData = NULL;
+	mHeader = NULL;
+	mRecords = NULL;
+	mStringOffsets = NULL;
+	mStrings = NULL;
+}
+
+//Returns whether a pack is mapped
+bool LevelPack::isOpen(void) const
+{
+	return mData != NULL;
+}
+
+//Number of objects in the pack
+unsigned int LevelPack::getRecordCount(void) const
+{
+	return mHeader ? mHeader->recordCount : 0;
+}
+
+//Returns one object's record
+const LevelObjectRecord& LevelPack::getRecord(unsigned int i) const
+{
+	return mRecords[i];
+}
+
+//Number of interned names, ids run from 0 to one less than this
+unsigned int LevelPack::getStringCount(void) const
+{
+	return mHeader ? mHeader->stringCount : 0;
+}
+
+//Looks up an interned name, bad ids give an empty string
+const char* LevelPack::getString(Ogre::uint16 id) const
+{
+	if (!mHeader || id >= mHeader->stringCount)
+		return "";
+
+	Ogre::uint32 offset = mStringOffsets[id];
+	const char* end = mData + mHeader->fileSize;
+	const char* string = mStrings + offset;
+	if (string >= end || !memchr(string, '\0', end - string))
+		return "";
+	return string;
+}
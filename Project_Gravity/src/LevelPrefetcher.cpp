@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "LevelPrefetcher.h"
+#include "LevelPack.h"
+
+/* Loads the next level's assets while the level complete screen is showing.
+ * Everything in the level's manifest is queued and loaded a few at a time each frame within
+ * a time budget, on the render thread so it is safe for any render system. Once loaded the
+ * resources stay in their managers, so starting the next level only has to create the scene.
+ */
+
+//Constructor
+LevelPrefetcher::LevelPrefetcher() :
+	mLevel(0)
+{
+}
+
+//Destructor
+LevelPrefetcher::~LevelPrefetcher()
+{
+}
+
+//Queues everything a level needs
+void LevelPrefetcher::start(const LevelDescriptor &level)
+{
+	cancel();
+	mLevel = level.mLevel;
+
+	Item item;
+	item.type = Item::ITEM_PACK;
+	item.name = "../../res/Levels/" + level.mObjectFile;
+	mQueue.push_back(item);
+
+	if (level.mHeightmap != mHeightmapName)
+	{
+		item.type = Item::ITEM_HEIGHTMAP;
+		item.name = level.mHeightmap;
+		mQueue.push_back(item);
+	}
+
+	addItems(Item::ITEM_MESH, level.mMeshes);
+	addItems(Item::ITEM_MATERIAL, level.mMaterials);
+	addItems(Item::ITEM_TEXTURE, level.mTextures);
+
+	LogManager::getSingleton().logMessage("LevelPrefetcher: queued " + StringConverter::toString(mQueue.size()) + " items for level " + StringConverter::toString(mLevel));
+}
+
+//Adds one kind of asset to the queue
+void LevelPrefetcher::addItems(Item::Type type, const StringVector &names)
+{
+	Item item;
+	item.type = type;
+	for (unsigned int i = 0; i < names.size(); i++)
+	{
+		item.name = names[i];
+		mQueue.push_back(item);
+	}
+}
+
+//Drops anything not loaded yet, what has been loaded stays loaded
+void LevelPrefetcher::cancel(void)
+{
+	mQueue.clear();
+}
+
+//Loads queued items until the frame's budget is used up
+void LevelPrefetcher::update(unsigned long budgetMillis)
+{
+	if (mQueue.empty())
+		return;
+
+	mTimer.reset();
+	do
+	{
+		Item item = mQueue.front();
+		mQueue.pop_front();
+		loadItem(item);
+	}
+	while (!mQueue.empty() && mTimer.getMilliseconds() < budgetMillis);
+
+	if (mQueue.empty())
+		LogManager::getSingleton().logMessage("LevelPrefetcher: level " + StringConverter::toString(mLevel) + " is ready");
+}
+
+//Loads a single item, failures are logged and left for the level load to report
+void LevelPrefetcher::loadItem(const Item &item)
+{
+	try
+	{
+		switch (item.type)
+		{
+		case Item::ITEM_PACK:
+			if (LevelPack::isStale(item.name, LevelPack::getPackFileName(item.name)))
+				LevelPack::compile(item.name, LevelPack::getPackFileName(item.name));
+			break;
+		case Item::ITEM_HEIGHTMAP:
+			mHeightmap.load(item.name, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+			mHeightmapName = item.name;
+			break;
+		case Item::ITEM_MESH:
+			MeshManager::getSingleton().load(item.name, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+			break;
+		case Item::ITEM_MATERIAL:
+			{
+				//Loading a material also loads its textures
+				MaterialPtr material = MaterialManager::getSingleton().getByName(item.name);
+				if (!material.isNull())
+					material->load();
+			}
+			break;
+		case Item::ITEM_TEXTURE:
+			TextureManager::getSingleton().load(item.name, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+			break;
+		}
+	}
+	catch (Ogre::Exception& e)
+	{
+		if (item.type == Item::ITEM_HEIGHTMAP)
+			mHeightmapName = "";
+		LogManager::getSingleton().logMessage("LevelPrefetcher: could not load " + item.name + ", " + e.getDescription());
+	}
+}
+
+//Returns whether everything queued has been loaded
+bool LevelPrefetcher::isDone(void) const
+{
+	return mQueue.empty();
+}
+
+//Copies out the prefetched heightmap if it is the one asked for
+bool LevelPrefetcher::getHeightmap(const String &name, Image &image) const
+{
+	if (mHeightmapName.empty() || name != mHeightmapName)
+		return false;
+
+	image = mHeightmap;
+	return true;
+}
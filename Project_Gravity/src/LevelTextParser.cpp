@@ -0,0 +1,284 @@
+#include "stdafx.h"
+#include "LevelTextParser.h"
+
+/* Reads comma separated level files in a single pass over the mapped file.
+ * Every line is checked against a column schema: numbers must parse completely, missing
+ * trailing columns take their default, and bad lines are logged with their line number
+ * and skipped rather than loaded with half their values.
+ */
+
+//Exact powers of ten, used to scale parsed numbers
+const double POWERS_OF_TEN[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+//Constructor
+LevelTextParser::LevelTextParser(const LevelColumn* columns, int columnCount) :
+	mColumns(columns), mColumnCount(columnCount), mCursor(NULL), mEnd(NULL), mLineNumber(0), mErrorCount(0),
+	mFieldBegin(columnCount, (const char*) NULL), mFieldEnd(columnCount, (const char*) NULL), mNumbers(columnCount, 0.0)
+{
+}
+
+//Destructor
+LevelTextParser::~LevelTextParser()
+{
+}
+
+//Opens a level file, a missing file is logged and gives no lines
+bool LevelTextParser::open(const String &fileName)
+{
+	mFileName = fileName;
+	mLineNumber = 0;
+	mErrorCount = 0;
+
+	if (!mFile.open(fileName))
+	{
+		LogManager::getSingleton().logMessage("LevelTextParser: can't open " + fileName);
+		mCursor = mEnd = NULL;
+		return false;
+	}
+
+	mCursor = mFile.getData();
+	mEnd = mCursor + mFile.getSize();
+	return true;
+}
+
+//Moves on to the next line that matches the schema, returns false at the end of the file
+bool LevelTextParser::nextLine(void)
+{
+	while (mCursor && mCursor < mEnd)
+	{
+		const char* lineBegin = mCursor;
+		const char* lineEnd = (const char*) memchr(lineBegin, '\n', mEnd - lineBegin);
+		if (!lineEnd)
+			lineEnd = mEnd;
+		mCursor = (lineEnd < mEnd) ? lineEnd + 1 : mEnd;
+		mLineNumber++;
+
+		//Trim line endings and surrounding whitespace
+		while (lineBegin < lineEnd && (*lineBegin == ' ' || *lineBegin == '\t'))
+			lineBegin++;
+		while (lineEnd > lineBegin && (lineEnd[-1] == '\r' || lineEnd[-1] == ' ' || lineEnd[-1] == '\t'))
+			lineEnd--;
+
+		if (lineBegin == lineEnd || *lineBegin == '#') //Ignore comments and blank lines
+			continue;
+
+		if (parseLine(lineBegin, lineEnd))
+			return true;
+		mErrorCount++;
+	}
+	return false;
+}
+
+//Splits a line into its columns and checks each one
+bool LevelTextParser::parseLine(const char* begin, const char* end)
+{
+	int column = 0;
+	const char* field = begin;
+	while (field <= end)
+	{
+		const char* fieldEnd = (const char*) memchr(field, ',', end - field);
+		if (!fieldEnd)
+			fieldEnd = end;
+
+		const char* valueBegin = field;
+		const char* valueEnd = fieldEnd;
+		while (valueBegin < valueEnd && (*valueBegin == ' ' || *valueBegin == '\t'))
+			valueBegin++;
+		while (valueEnd > valueBegin && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t'))
+			valueEnd--;
+
+		if (column < mColumnCount)
+		{
+			if (!parseField(column, valueBegin, valueEnd))
+				return false;
+		}
+		else if (valueBegin != valueEnd) //Saved levels end with a comma, so only complain about real values
+			logProblem("ignoring extra value '" + String(valueBegin, valueEnd) + "'");
+
+		column++;
+		field = fieldEnd + 1;
+	}
+
+	//Fill in whatever was left off the end of the line
+	for (; column < mColumnCount; column++)
+	{
+		if (!parseField(column, NULL, NULL))
+			return false;
+	}
+	return true;
+}
+
+//Stores one column's value, falling back to its default if the value is empty
+bool LevelTextParser::parseField(int column, const char* begin, const char* end)
+{
+	const LevelColumn &schema = mColumns[column];
+	if (begin == end)
+	{
+		if (!schema.defaultValue)
+		{
+			logProblem(String("missing value for ") + schema.name);
+			return false;
+		}
+		begin = schema.defaultValue;
+		end = begin + strlen(begin);
+	}
+
+	mFieldBegin[column] = begin;
+	mFieldEnd[column] = end;
+
+	bool valid = true;
+	if (schema.type == LevelColumn::COLUMN_REAL)
+		valid = parseReal(begin, end, mNumbers[column]);
+	else if (schema.type == LevelColumn::COLUMN_INT)
+	{
+		int value;
+		valid = parseInt(begin, end, value);
+		mNumbers[column] = value;
+	}
+	else if (schema.type == LevelColumn::COLUMN_UINT)
+	{
+		Ogre::uint32 value;
+		valid = parseUint(begin, end, value);
+		mNumbers[column] = value;
+	}
+
+	if (!valid)
+	{
+		logProblem(String(schema.name) + " expects " + ((schema.type == LevelColumn::COLUMN_REAL) ? "a number" : "a whole number")
+			+ ", got '" + String(begin, end) + "'");
+		return false;
+	}
+	return true;
+}
+
+//Logs a problem with the current line
+void LevelTextParser::logProblem(const String &problem) const
+{
+	LogManager::getSingleton().logMessage("LevelTextParser: " + mFileName + " line " + StringConverter::toString(mLineNumber) + ": " + problem);
+}
+
+//Parses a decimal number such as -12.5 or 1e-005, the whole range must be used
+bool LevelTextParser::parseReal(const char* begin, const char* end, double &value)
+{
+	const char* p = begin;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+
+	double mantissa = 0;
+	int exponent = 0;
+	int digits = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+		mantissa = mantissa * 10 + (*p - '0');
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++, exponent--)
+			mantissa = mantissa * 10 + (*p - '0');
+	}
+	if (digits == 0)
+		return false;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		int power;
+		if (!parseInt(p + 1, end, power))
+			return false;
+		exponent += power;
+		p = end;
+	}
+	if (p != end)
+		return false;
+
+	int magnitude = (exponent < 0) ? -exponent : exponent;
+	double scale = (magnitude <= 22) ? POWERS_OF_TEN[magnitude] : pow(10.0, magnitude);
+	value = (exponent < 0) ? mantissa / scale : mantissa * scale;
+	if (negative)
+		value = -value;
+	return true;
+}
+
+//Parses a whole number, the whole range must be used
+bool LevelTextParser::parseInt(const char* begin, const char* end, int &value)
+{
+	const char* p = begin;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+	if (p == end)
+		return false;
+
+	long long result = 0;
+	for (; p < end; p++)
+	{
+		if (*p < '0' || *p > '9')
+			return false;
+		result = result * 10 + (*p - '0');
+		if (result > 0x7FFFFFFF)
+			return false;
+	}
+
+	value = (int) (negative ? -result : result);
+	return true;
+}
+
+//Parses a whole number that can't be negative, the whole unsigned 32 bit range can be used
+bool LevelTextParser::parseUint(const char* begin, const char* end, Ogre::uint32 &value)
+{
+	const char* p = begin;
+	if (p < end && *p == '+')
+		p++;
+	if (p == end)
+		return false;
+
+	unsigned long long result = 0;
+	for (; p < end; p++)
+	{
+		if (*p < '0' || *p > '9')
+			return false;
+		result = result * 10 + (*p - '0');
+		if (result > 0xFFFFFFFF)
+			return false;
+	}
+
+	value = (Ogre::uint32) result;
+	return true;
+}
+
+//Current line number, for callers reporting their own problems
+int LevelTextParser::getLineNumber(void) const
+{
+	return mLineNumber;
+}
+
+//Number of lines skipped because they didn't match the schema
+int LevelTextParser::getErrorCount(void) const
+{
+	return mErrorCount;
+}
+
+//Copy of a column's text
+String LevelTextParser::getString(int column) const
+{
+	return String(mFieldBegin[column], mFieldEnd[column]);
+}
+
+//Value of a number column
+Real LevelTextParser::getReal(int column) const
+{
+	return (Real) mNumbers[column];
+}
+
+//Value of a whole number column
+int LevelTextParser::getInt(int column) const
+{
+	return (int) mNumbers[column];
+}
+
+//Value of an unsigned whole number column, doubles hold every 32 bit value exactly
+Ogre::uint32 LevelTextParser::getUint(int column) const
+{
+	return (Ogre::uint32) mNumbers[column];
+}
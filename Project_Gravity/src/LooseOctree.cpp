@@ -0,0 +1,243 @@
+#include "stdafx.h"
+#include "LooseOctree.h"
+
+/* A loose octree over axis aligned boxes, used to find level objects near a point, inside a box or along a ray.
+ * Every cell's bounds are stretched to twice its size, so an item is stored by where its centre is and how big
+ * it is, and a moving item only has to be moved to another cell once it leaves the stretched bounds. Items
+ * outside the world bounds are kept in the root, which is always searched.
+ */
+
+//Constructor
+LooseOctree::LooseOctree(const AxisAlignedBox &worldBounds, int maxDepth) :
+	mWorldBounds(worldBounds), mMaxDepth(maxDepth), mCount(0)
+{
+	clear();
+}
+
+//Destructor
+LooseOctree::~LooseOctree()
+{
+}
+
+//Adds a cell to the tree, returns its index
+int LooseOctree::createNode(const Vector3 &centre, Real halfSize, int depth)
+{
+	Node node;
+	node.centre = centre;
+	node.halfSize = halfSize;
+	node.depth = depth;
+	node.looseBounds = AxisAlignedBox(centre - Vector3(halfSize * 2), centre + Vector3(halfSize * 2));
+	for (int c = 0; c < 8; c++)
+		node.children[c] = -1;
+
+	mNodes.push_back(node);
+	return mNodes.size() - 1;
+}
+
+//Removes every item and cell, leaving an empty root
+void LooseOctree::clear(void)
+{
+	mNodes.clear();
+	mItems.clear();
+	mFreeItems.clear();
+	mCount = 0;
+
+	Vector3 size = mWorldBounds.getSize();
+	Real halfSize = size.x;
+	if (size.y > halfSize)
+		halfSize = size.y;
+	if (size.z > halfSize)
+		halfSize = size.z;
+	createNode(mWorldBounds.getCenter(), halfSize / 2, 0);
+}
+
+//Number of items in the tree
+int LooseOctree::getCount(void) const
+{
+	return mCount;
+}
+
+//Deepest cell that can hold the bounds, making cells on the way down as needed
+int LooseOctree::findNode(const AxisAlignedBox &bounds)
+{
+	Vector3 centre = bounds.getCenter();
+	Vector3 half = bounds.getHalfSize();
+	Real extent = half.x;
+	if (half.y > extent)
+		extent = half.y;
+	if (half.z > extent)
+		extent = half.z;
+
+	//Anything centred outside the world stays in the root
+	const Node &root = mNodes[0];
+	if (Math::Abs(centre.x - root.centre.x) > root.halfSize || Math::Abs(centre.y - root.centre.y) > root.halfSize
+		|| Math::Abs(centre.z - root.centre.z) > root.halfSize)
+		return 0;
+
+	int node = 0;
+	while (mNodes[node].depth < mMaxDepth)
+	{
+		//A child's stretched bounds reach half its size past its cell, so that is the biggest item it takes
+		Real childHalf = mNodes[node].halfSize / 2;
+		if (extent > childHalf)
+			break;
+
+		const Vector3 &nodeCentre = mNodes[node].centre;
+		int child = ((centre.x >= nodeCentre.x) ? 1 : 0) | ((centre.y >= nodeCentre.y) ? 2 : 0) | ((centre.z >= nodeCentre.z) ? 4 : 0);
+		if (mNodes[node].children[child] < 0)
+		{
+			Vector3 childCentre = nodeCentre + Vector3((child & 1) ? childHalf : -childHalf,
+				(child & 2) ? childHalf : -childHalf, (child & 4) ? childHalf : -childHalf);
+			int created = createNode(childCentre, childHalf, mNodes[node].depth + 1);
+			mNodes[node].children[child] = created;
+		}
+		node = mNodes[node].children[child];
+	}
+	return node;
+}
+
+//Whether an item can stay in its cell, root items are always placed again in case they now fit further down
+bool LooseOctree::fitsNode(int node, const AxisAlignedBox &bounds) const
+{
+	return node != 0 && mNodes[node].looseBounds.contains(bounds);
+}
+
+//Puts an item into a cell's list
+void LooseOctree::link(int item, int node)
+{
+	mItems[item].node = node;
+	mItems[item].slot = mNodes[node].items.size();
+	mNodes[node].items.push_back(item);
+}
+
+//Takes an item out of its cell's list, the cell's last item fills the gap
+void LooseOctree::unlink(int item)
+{
+	std::vector<int> &items = mNodes[mItems[item].node].items;
+	int slot = mItems[item].slot;
+	int last = items.back();
+	items[slot] = last;
+	mItems[last].slot = slot;
+	items.pop_back();
+	mItems[item].node = -1;
+}
+
+//Adds an item, returns its id which stays the same until the item is removed
+int LooseOctree::insert(Ogre::uint32 owner, const AxisAlignedBox &bounds)
+{
+	int item;
+	if (!mFreeItems.empty())
+	{
+		item = mFreeItems.back();
+		mFreeItems.pop_back();
+	}
+	else
+	{
+		item = mItems.size();
+		mItems.push_back(Item());
+	}
+
+	mItems[item].bounds = bounds;
+	mItems[item].owner = owner;
+	link(item, findNode(bounds));
+	mCount++;
+	return item;
+}
+
+//Moves an item, it only changes cell if it has left its cell's stretched bounds
+void LooseOctree::update(int item, const AxisAlignedBox &bounds)
+{
+	if (item < 0 || item >= (int) mItems.size() || mItems[item].node < 0)
+		return;
+
+	mItems[item].bounds = bounds;
+	if (fitsNode(mItems[item].node, bounds))
+		return;
+
+	unlink(item);
+	link(item, findNode(bounds));
+}
+
+//Removes an item, its id may be handed out again
+void LooseOctree::remove(int item)
+{
+	if (item < 0 || item >= (int) mItems.size() || mItems[item].node < 0)
+		return;
+
+	unlink(item);
+	mFreeItems.push_back(item);
+	mCount--;
+}
+
+//Finds the owners of every item touching a sphere
+void LooseOctree::queryRadius(const Vector3 &centre, Real radius, std::vector<Ogre::uint32> &owners) const
+{
+	Sphere sphere(centre, radius);
+	queryBoxNode(0, AxisAlignedBox(centre - Vector3(radius), centre + Vector3(radius)), &sphere, owners);
+}
+
+//Finds the owners of every item touching a box
+void LooseOctree::queryBox(const AxisAlignedBox &box, std::vector<Ogre::uint32> &owners) const
+{
+	queryBoxNode(0, box, NULL, owners);
+}
+
+//Searches a cell and its children for items touching a box, and the sphere inside it if one is given
+void LooseOctree::queryBoxNode(int node, const AxisAlignedBox &box, const Sphere *sphere, std::vector<Ogre::uint32> &owners) const
+{
+	const Node &cell = mNodes[node];
+	if (node != 0 && !cell.looseBounds.intersects(box))
+		return;
+
+	for (unsigned int i = 0; i < cell.items.size(); i++)
+	{
+		const Item &item = mItems[cell.items[i]];
+		if (item.bounds.intersects(box) && (!sphere || item.bounds.intersects(*sphere)))
+			owners.push_back(item.owner);
+	}
+
+	for (int c = 0; c < 8; c++)
+	{
+		if (cell.children[c] >= 0)
+			queryBoxNode(cell.children[c], box, sphere, owners);
+	}
+}
+
+//Finds the nearest item whose bounds the ray passes through within the given distance
+bool LooseOctree::queryRay(const Ray &ray, Real maxDistance, Ogre::uint32 &owner, Real &distance) const
+{
+	bool found = false;
+	distance = maxDistance;
+	queryRayNode(0, ray, owner, distance, found);
+	return found;
+}
+
+//Searches a cell and its children for the nearest item along a ray, skipping cells beyond the best so far
+void LooseOctree::queryRayNode(int node, const Ray &ray, Ogre::uint32 &owner, Real &distance, bool &found) const
+{
+	const Node &cell = mNodes[node];
+	if (node != 0)
+	{
+		std::pair<bool, Real> hit = ray.intersects(cell.looseBounds);
+		if (!hit.first || hit.second > distance)
+			return;
+	}
+
+	for (unsigned int i = 0; i < cell.items.size(); i++)
+	{
+		const Item &item = mItems[cell.items[i]];
+		std::pair<bool, Real> hit = ray.intersects(item.bounds);
+		if (hit.first && hit.second <= distance)
+		{
+			distance = hit.second;
+			owner = item.owner;
+			found = true;
+		}
+	}
+
+	for (int c = 0; c < 8; c++)
+	{
+		if (cell.children[c] >= 0)
+			queryRayNode(cell.children[c], ray, owner, distance, found);
+	}
+}
@@ -0,0 +1,88 @@
+#include "stdafx.h"
+#include "MappedFile.h"
+
+/* Read only view of a whole file mapped into memory.
+ * Used for level files so they can be read in place without copying them into strings first.
+ */
+
+//Constructor
+MappedFile::MappedFile() :
+	mFile(INVALID_HANDLE_VALUE), mMapping(NULL), mData(NULL), mSize(0), mOpen(false)
+{
+}
+
+//Destructor
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+//Maps a file, an empty file opens fine but has no data
+bool MappedFile::open(const String &fileName)
+{
+	close();
+
+	mFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (mFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD sizeHigh = 0;
+	DWORD size = GetFileSize(mFile, &sizeHigh);
+	if (size == INVALID_FILE_SIZE || sizeHigh != 0)
+	{
+		close();
+		return false;
+	}
+
+	//Zero length files can't be mapped
+	if (size > 0)
+	{
+		mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mMapping)
+			mData = (const char*) MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+		if (!mData)
+		{
+			close();
+			return false;
+		}
+	}
+
+	mSize = size;
+	mOpen = true;
+	return true;
+}
+
+//Unmaps the file
+void MappedFile::close(void)
+{
+	if (mData)
+		UnmapViewOfFile(mData);
+	if (mMapping)
+		CloseHandle(mMapping);
+	if (mFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mFile);
+
+	mFile = INVALID_HANDLE_VALUE;
+	mMapping = NULL;
+	mData = NULL;
+	mSize = 0;
+	mOpen = false;
+}
+
+//Returns whether a file is mapped
+bool MappedFile::isOpen(void) const
+{
+	return mOpen;
+}
+
+//Start of the file's contents, NULL for an empty file
+const char* MappedFile::getData(void) const
+{
+	return mData;
+}
+
+//Size of the file in bytes
+Ogre::uint32 MappedFile::getSize(void) const
+{
+	return mSize;
+}
@@ -5,12 +5,17 @@
  * Contains all of the menu screens and methods that are called on button presses.
  */
 
+//Custom levels listed on each page of the user level menu
+const int USER_LEVELS_PER_PAGE = 5;
+//Best runs listed for each level on the high scores menu
+const unsigned int HIGH_SCORE_ROWS = 5;
+
 //Constructor - initialises variables
 MenuScreen::MenuScreen(PGFrameListener* frameListener) :
 	mFrameListener(frameListener),
 		mMainMenu(true), mMainMenuCreated(false), mInGameMenu(false), mInGameMenuCreated(false), mInEditorMenu(false), mEditorMenuCreated(false),
 		mLoadingScreenCreated(false), mInLoadingScreen(false), mInLevelMenu(false), mLevelMenuCreated(false), mInUserLevelMenu(false), mUserLevelMenuCreated(false), 
-		mUserLevelLoader(NULL), 
+		mUserLevelLoader(NULL), mCatalogLevelLoader(NULL), mUserLevelPage(0), mUserLevelsShown(-1),
 		mControlScreenCreated(false), mInControlMenu(false), mHighScoresCreated(false), mHighScoresOpen(false),
 		mLevel1AimsCreated(false), mLevel1AimsOpen(false), mLevel2AimsCreated(false), mLevel2AimsOpen(false), mLevel3AimsCreated(false), mLevel3AimsOpen(false),
 		mLevelCompleteCreated(false), mLevelCompleteOpen(false), mLevelFailedCreated(false), mLevelFailedOpen(false)
@@ -349,36 +354,35 @@ void MenuScreen::loadUserLevelSelectorMenu() {
 		CEGUI::System::getSingleton().getGUISheet()->addChildWindow(userLevelMenu); //Attach to current (inGameMenuRoot) GUI sheet
 		
 		CEGUI::System::getSingleton().setGUISheet(userLevelMenu); 
-		
-		// Create a ScrollablePane for buttons to be put in		
-		mScroll = CEGUI::WindowManager::getSingleton().createWindow("TaharezLook/ScrollablePane", "userLevelScroll");
-		mScroll->setPosition(CEGUI::UVector2(CEGUI::UDim(0, 0),CEGUI::UDim(0.1, 0)));
-		mScroll->setSize(CEGUI::UVector2(CEGUI::UDim(1, 0),CEGUI::UDim(0.6, 0)));
-		((CEGUI::ScrollablePane*)mScroll)->setContentPaneAutoSized(true);
-		CEGUI::System::getSingleton().getGUISheet()->addChildWindow(mScroll);
-		
-		//Put buttons inside the scroll-able area
-		CEGUI::System::getSingleton().setGUISheet(mScroll);
 
-		//Iteratively adds buttons for each user level that currently exists
+		//One button per visible row, re-labelled as the pages change rather than one button per level
 		CEGUI::Window *loadLevelBtn;
 		int i;
-		for(i=1; i <= mNumberOfCustomLevels; i++) {
-			std::string buttonName = "userLoadLevel"+StringConverter::toString(i)+"Btn";
+		for(i=0; i < USER_LEVELS_PER_PAGE; i++) {
+			std::string buttonName = "userLoadLevelRow"+StringConverter::toString(i)+"Btn";
 
 			loadLevelBtn = CEGUI::WindowManager::getSingleton().createWindow("TaharezLook/SystemButton", buttonName);
 			loadLevelBtn->setSize(CEGUI::UVector2(CEGUI::UDim(0.3,0),CEGUI::UDim(0,70)));
-			loadLevelBtn->setPosition(CEGUI::UVector2(CEGUI::UDim(1,-100)-loadLevelBtn->getWidth(), CEGUI::UDim((0.2*(i-1)),0)));
-			loadLevelBtn->setText("Custom Level "+StringConverter::toString(i));
+			loadLevelBtn->setPosition(CEGUI::UVector2(CEGUI::UDim(1,-100)-loadLevelBtn->getWidth(), CEGUI::UDim(0.1+(0.12*i),0)));
+			loadLevelBtn->setID(i);
 			CEGUI::System::getSingleton().getGUISheet()->addChildWindow(loadLevelBtn);
 
-			//Set up on-click events for new button
-			LevelLoad *level = new LevelLoad(mFrameListener, StringConverter::toString(i));
-			loadLevelBtn->subscribeEvent(CEGUI::PushButton::EventMouseClick, CEGUI::Event::Subscriber(&LevelLoad::preLoad, level));
+			//Set up on-click events for the row
+			loadLevelBtn->subscribeEvent(CEGUI::PushButton::EventMouseClick, CEGUI::Event::Subscriber(&MenuScreen::userLevelRowPressed, this));
 		}
 
-		//Set buttons outside of scroll-able area
-		CEGUI::System::getSingleton().setGUISheet(userLevelMenu);
+		//Buttons for moving between pages
+		CEGUI::Window *previousBtn = CEGUI::WindowManager::getSingleton().createWindow("TaharezLook/SystemButton","userLoadLvlPreviousBtn");
+		previousBtn->setSize(CEGUI::UVector2(CEGUI::UDim(0.14,0),CEGUI::UDim(0,70)));
+		previousBtn->setPosition(CEGUI::UVector2(CEGUI::UDim(1,-100)-CEGUI::UDim(0.3,0),CEGUI::UDim(0.7,0)));
+		previousBtn->setText("Previous");
+		CEGUI::System::getSingleton().getGUISheet()->addChildWindow(previousBtn);
+
+		CEGUI::Window *nextBtn = CEGUI::WindowManager::getSingleton().createWindow("TaharezLook/SystemButton","userLoadLvlNextBtn");
+		nextBtn->setSize(CEGUI::UVector2(CEGUI::UDim(0.14,0),CEGUI::UDim(0,70)));
+		nextBtn->setPosition(CEGUI::UVector2(CEGUI::UDim(1,-100)-nextBtn->getWidth(),CEGUI::UDim(0.7,0)));
+		nextBtn->setText("Next");
+		CEGUI::System::getSingleton().getGUISheet()->addChildWindow(nextBtn);
 
 		//Button to return the user to the previous menu
 		CEGUI::Window *backBtn = CEGUI::WindowManager::getSingleton().createWindow("TaharezLook/SystemButton","userLoadLvlBackBtn");  // Create Window
@@ -387,40 +391,49 @@ void MenuScreen::loadUserLevelSelectorMenu() {
 		backBtn->setText("Back");
 		CEGUI::System::getSingleton().getGUISheet()->addChildWindow(backBtn);
 
-		//Register on-click events for the back button
+		//Register on-click events
+		previousBtn->subscribeEvent(CEGUI::PushButton::EventMouseClick, CEGUI::Event::Subscriber(&MenuScreen::userLevelPreviousPressed, this));
+		nextBtn->subscribeEvent(CEGUI::PushButton::EventMouseClick, CEGUI::Event::Subscriber(&MenuScreen::userLevelNextPressed, this));
 		backBtn->subscribeEvent(CEGUI::PushButton::EventMouseClick, CEGUI::Event::Subscriber(&MenuScreen::levelBackPressed, this));
+		mUserLevelMenu = userLevelMenu;
 		mUserLevelMenuCreated=true;
-	} else {
-		//Do we need to update the number of level loading buttons?
-		if(mNewLevelsMade > 0) {
-			//Put buttons inside the scroll-able area
-			CEGUI::System::getSingleton().setGUISheet(mScroll);
-
-			CEGUI::Window *loadLevelBtn;
-			int i;
-			int newNumberOfLevels = mNumberOfCustomLevels + mNewLevelsMade;
-			//Iteratively add new buttons for new levels below previously existing buttons
-			for(i=1; i <= mNewLevelsMade; i++) {
-				int buttonNumber = i+mNumberOfCustomLevels;
-				std::string buttonName = "userLoadLevel"+to_string(buttonNumber)+"Btn";
-
-				loadLevelBtn = CEGUI::WindowManager::getSingleton().createWindow("TaharezLook/SystemButton", buttonName);
-				loadLevelBtn->setSize(CEGUI::UVector2(CEGUI::UDim(0.3,0),CEGUI::UDim(0,70)));
-				loadLevelBtn->setPosition(CEGUI::UVector2(CEGUI::UDim(1,-100)-loadLevelBtn->getWidth(), CEGUI::UDim((0.2*((i-1)+mNumberOfCustomLevels)),0)));
-				loadLevelBtn->setText("Custom Level "+StringConverter::toString((i+mNumberOfCustomLevels)));
-				CEGUI::System::getSingleton().getGUISheet()->addChildWindow(loadLevelBtn);
-
-				LevelLoad *level = new LevelLoad(mFrameListener, StringConverter::toString((i+mNumberOfCustomLevels)));
-				loadLevelBtn->subscribeEvent(CEGUI::PushButton::EventMouseClick, CEGUI::Event::Subscriber(&LevelLoad::preLoad, level));
-			}
-			//Reset so these new buttons are re-generated
-			mNewLevelsMade = 0;
-			mNumberOfCustomLevels = newNumberOfLevels;
-		}
+	}
+	//Only re-label the rows if levels have been saved since they were last shown
+	if(mUserLevelsShown != (int) mFrameListener->mLevelCatalog->getCount()) {
+		showUserLevelPage(mUserLevelPage);
 	}
 	CEGUI::System::getSingleton().setGUISheet(userLevelMenuRoot);
 }
 
+//Labels the row buttons with one page of the custom level catalog
+void MenuScreen::showUserLevelPage(int page) {
+	int levelCount = mFrameListener->mLevelCatalog->getCount();
+	int pageCount = (levelCount + USER_LEVELS_PER_PAGE - 1) / USER_LEVELS_PER_PAGE;
+	if(page >= pageCount) {
+		page = pageCount - 1;
+	}
+	if(page < 0) {
+		page = 0;
+	}
+	mUserLevelPage = page;
+	mUserLevelsShown = levelCount;
+
+	for(int i=0; i < USER_LEVELS_PER_PAGE; i++) {
+		CEGUI::Window* button = mUserLevelMenu->getChild("userLoadLevelRow"+StringConverter::toString(i)+"Btn");
+		int entry = page*USER_LEVELS_PER_PAGE + i;
+		if(entry < levelCount) {
+			const LevelCatalogEntry &level = mFrameListener->mLevelCatalog->getEntry(entry);
+			button->setText("Custom Level "+StringConverter::toString(level.id)+" - Island "+StringConverter::toString(level.island)
+				+", "+StringConverter::toString(level.objectCount)+" objects");
+			button->setVisible(true);
+		} else {
+			button->setVisible(false);
+		}
+	}
+	mUserLevelMenu->getChild("userLoadLvlPreviousBtn")->setVisible(page > 0);
+	mUserLevelMenu->getChild("userLoadLvlNextBtn")->setVisible(page < pageCount - 1);
+}
+
 //Code to set up the loading screen for the levels
 void MenuScreen::loadLoadingScreen() {
 	CEGUI::Window *loadingScreen;
@@ -500,23 +513,26 @@ void MenuScreen::loadHighScoresScreen() {
 
 		//Setup high score static text for level 1
 		CEGUI::Window* level1Txt = CEGUI::WindowManager::getSingleton().createWindow("TaharezLook/StaticText", "level1HighScoreText");
-		level1Txt->setSize(CEGUI::UVector2(CEGUI::UDim(0.25,0),CEGUI::UDim(0,70)));
-		level1Txt->setPosition(CEGUI::UVector2(CEGUI::UDim(0.4,0),CEGUI::UDim(0.22,0)));
+		level1Txt->setSize(CEGUI::UVector2(CEGUI::UDim(0.28,0),CEGUI::UDim(0.5,0)));
+		level1Txt->setPosition(CEGUI::UVector2(CEGUI::UDim(0.08,0),CEGUI::UDim(0.22,0)));
 		level1Txt->setProperty( "BackgroundEnabled", "False" );
+		level1Txt->setProperty( "VertFormatting", "TopAligned" );
 		CEGUI::System::getSingleton().getGUISheet()->addChildWindow(level1Txt);
 
 		//Setup high score static text for level 2
 		CEGUI::Window* level2Txt = CEGUI::WindowManager::getSingleton().createWindow("TaharezLook/StaticText", "level2HighScoreText");
-		level2Txt->setSize(CEGUI::UVector2(CEGUI::UDim(0.25,0),CEGUI::UDim(0,70)));
-		level2Txt->setPosition(CEGUI::UVector2(CEGUI::UDim(0.4,0),CEGUI::UDim(0.34,0)));
+		level2Txt->setSize(CEGUI::UVector2(CEGUI::UDim(0.28,0),CEGUI::UDim(0.5,0)));
+		level2Txt->setPosition(CEGUI::UVector2(CEGUI::UDim(0.38,0),CEGUI::UDim(0.22,0)));
 		level2Txt->setProperty( "BackgroundEnabled", "False" );
+		level2Txt->setProperty( "VertFormatting", "TopAligned" );
 		CEGUI::System::getSingleton().getGUISheet()->addChildWindow(level2Txt);
 
 		//Setup high score static text for level 3
 		CEGUI::Window* level3Txt = CEGUI::WindowManager::getSingleton().createWindow("TaharezLook/StaticText", "level3HighScoreText");
-		level3Txt->setSize(CEGUI::UVector2(CEGUI::UDim(0.25,0),CEGUI::UDim(0,70)));
-		level3Txt->setPosition(CEGUI::UVector2(CEGUI::UDim(0.4,0),CEGUI::UDim(0.46,0)));
+		level3Txt->setSize(CEGUI::UVector2(CEGUI::UDim(0.28,0),CEGUI::UDim(0.5,0)));
+		level3Txt->setPosition(CEGUI::UVector2(CEGUI::UDim(0.68,0),CEGUI::UDim(0.22,0)));
 		level3Txt->setProperty( "BackgroundEnabled", "False" );
+		level3Txt->setProperty( "VertFormatting", "TopAligned" );
 		CEGUI::System::getSingleton().getGUISheet()->addChildWindow(level3Txt);
 
 		//Back button
@@ -532,17 +548,34 @@ void MenuScreen::loadHighScoresScreen() {
 		mHighScoresCreated = true;
 	}
 	//Update the text each time the menu is loaded so that the most recent high scores are displayed
-	CEGUI::Window* button = highScoresRoot->getChild("level1HighScoreText");
-	button->setText("Level 1: "+to_string(mFrameListener->getOldHighScore(1)));
-	button = highScoresRoot->getChild("level2HighScoreText");
-	button->setText("Level 2: "+to_string(mFrameListener->getOldHighScore(2)));
-	button = highScoresRoot->getChild("level3HighScoreText");
-	button->setText("Level 3: "+to_string(mFrameListener->getOldHighScore(3)));
+	for (int level = 1; level <= 3; level++)
+	{
+		CEGUI::Window* button = highScoresRoot->getChild("level"+to_string(level)+"HighScoreText");
+		button->setText(getHighScoreTable(level));
+	}
 
 	CEGUI::System::getSingleton().setGUISheet(highScoresRoot);
 	highScoresRoot->setVisible(true);
 }
 
+//Lists a level's best runs with their time and coconuts, one per line
+String MenuScreen::getHighScoreTable(int level) {
+	const HighScoreStore* scores = mFrameListener->mHighScores;
+	String table = "Level "+to_string(level)+"\n";
+	unsigned int count = std::min(scores->getEntryCount(level), HIGH_SCORE_ROWS);
+	if (count == 0)
+		return table + "Not completed yet";
+
+	for (unsigned int rank = 0; rank < count; rank++)
+	{
+		const HighScoreEntry& entry = scores->getEntry(level, rank);
+		table += to_string(rank + 1)+". "+to_string(entry.score)
+			+"  "+StringConverter::toString(entry.timeMillis/60000)+":"+StringConverter::toString((entry.timeMillis/1000)%60, 2, '0')
+			+"  "+to_string(entry.coconuts)+" coconuts\n";
+	}
+	return table;
+}
+
 //Code for creating the level 1 aims screen
 void MenuScreen::loadLevel1Aims() {
 	if(!mLevel1AimsCreated) {
@@ -617,6 +650,9 @@ void MenuScreen::loadLevel3Aims() {
 
 //Code for creating the 'level completed' screen
 void MenuScreen::loadLevelComplete(float time, int coconuts, float score, int level, bool highScore) {
+	//Start loading the next level while this screen is up
+	mFrameListener->prefetchLevel(mFrameListener->getLevelDescriptor(level).mNextLevel);
+
 	if(!mLevelCompleteCreated) {
 		CEGUI::System::getSingleton().setDefaultMouseCursor( "TaharezLook", "MouseArrow" );
 		CEGUI::MouseCursor::getSingleton().setVisible(true);
@@ -821,6 +857,33 @@ bool MenuScreen::loadUserLevelPressed(const CEGUI::EventArgs& e) {
 	return 1;
 }
 
+//Loads the custom level shown on the pressed row
+bool MenuScreen::userLevelRowPressed(const CEGUI::EventArgs& e) {
+	int entry = mUserLevelPage*USER_LEVELS_PER_PAGE + ((const CEGUI::WindowEventArgs&) e).window->getID();
+	if(entry >= (int) mFrameListener->mLevelCatalog->getCount()) {
+		return 1;
+	}
+
+	//A single loader is reused for every custom level
+	if(mCatalogLevelLoader == NULL) {
+		mCatalogLevelLoader = new LevelLoad(mFrameListener, "");
+	}
+	mCatalogLevelLoader->mLevelName = StringConverter::toString(mFrameListener->mLevelCatalog->getEntry(entry).id);
+	return mCatalogLevelLoader->preLoad(e);
+}
+
+//Shows the previous page of custom levels
+bool MenuScreen::userLevelPreviousPressed(const CEGUI::EventArgs& e) {
+	showUserLevelPage(mUserLevelPage - 1);
+	return 1;
+}
+
+//Shows the next page of custom levels
+bool MenuScreen::userLevelNextPressed(const CEGUI::EventArgs& e) {
+	showUserLevelPage(mUserLevelPage + 1);
+	return 1;
+}
+
 //Loads the high score menu
 bool MenuScreen::loadHighScoresPressed(const CEGUI::EventArgs& e) {
 	mMainMenu=false;
@@ -1064,4 +1127,5 @@ void MenuScreen::closeMenus(void) {
 
 //Destructor method
 MenuScreen::~MenuScreen() {
+	delete mCatalogLevelLoader;
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ using namespace Ogre;
  
 #define POS_TEX_BINDING    0
 #define COLOUR_BINDING     1
+#define FLOATS_PER_VERTEX  5
  
 MovableText::MovableText(const String &name, const String &caption, const String &fontName, Real charHeight, const ColourValue &color)
 : mpCam(NULL)
@@ -33,6 +34,11 @@ MovableText::MovableText(const String &name, const String &caption, const String
 , mVerticalAlignment(V_BELOW)
 , mGlobalTranslation(0.0)
 , mLocalTranslation(0.0)
+, mpGlyphs(NULL)
+, mVertexCapacity(0)
+, mWrittenCount(0)
+, mDirtyStart(0)
+, mDirtyEnd(0)
 {
     if (name == "")
         throw Exception(Exception::ERR_INVALIDPARAMS, "Trying to create MovableText without name", "MovableText::MovableText");
@@ -69,6 +75,7 @@ void MovableText::setFontName(const String &fontName)
             throw Exception(Exception::ERR_ITEM_NOT_FOUND, "Could not find font " + fontName, "MovableText::setFontName");
  
         mpFont->load();
+        mpGlyphs = getGlyphCache(mpFont);
         if (!mpMaterial.isNull())
         {
             MaterialManager::getSingletonPtr()->remove(mpMaterial->getName());
@@ -158,64 +165,101 @@ void MovableText::showOnTop(bool show)
     }
 }
  
-void MovableText::_setupGeometry()
-{
-    assert(mpFont);
-    assert(!mpMaterial.isNull());
+// Glyph caches shared by every MovableText, keyed by font name
+std::map<String, MovableText::GlyphCache> MovableText::msGlyphCaches;
  
-    unsigned int vertexCount = static_cast<unsigned int>(mCaption.size() * 6);
+const MovableText::GlyphCache *MovableText::getGlyphCache(Font *font)
+{
+    std::map<String, GlyphCache>::iterator found = msGlyphCaches.find(font->getName());
+    if (found != msGlyphCaches.end())
+        return &found->second;
  
-    if (mRenderOp.vertexData)
+    // Look every 8 bit glyph up once, fonts return an empty rect and an aspect of 1 for glyphs they don't have
+    GlyphCache &cache = msGlyphCaches[font->getName()];
+    for (int c = 0; c < 256; c++)
     {
-        // Removed this test as it causes problems when replacing a caption
-        // of the same size: replacing "Hello" with "hello"
-        // as well as when changing the text alignment
-        //if (mRenderOp.vertexData->vertexCount != vertexCount)
-        {
-            delete mRenderOp.vertexData;
-            mRenderOp.vertexData = NULL;
-            mUpdateColors = true;
-        }
+        cache.uvs[c] = font->getGlyphTexCoords((Font::CodePoint)c);
+        cache.aspectRatios[c] = font->getGlyphAspectRatio((Font::CodePoint)c);
     }
+    return &cache;
+}
  
-    if (!mRenderOp.vertexData)
-        mRenderOp.vertexData = new VertexData();
- 
-    mRenderOp.indexData = 0;
-    mRenderOp.vertexData->vertexStart = 0;
-    mRenderOp.vertexData->vertexCount = vertexCount;
-    mRenderOp.operationType = RenderOperation::OT_TRIANGLE_LIST; 
-    mRenderOp.useIndexes = false; 
+void MovableText::_createBuffers(size_t vertexCount)
+{
+    // Grow geometrically so a caption that keeps getting longer only reallocates a few times
+    size_t capacity = mVertexCapacity * 2;
+    if (capacity < vertexCount)
+        capacity = vertexCount;
+    if (capacity < 6)
+        capacity = 6;
  
     VertexDeclaration  *decl = mRenderOp.vertexData->vertexDeclaration;
     VertexBufferBinding   *bind = mRenderOp.vertexData->vertexBufferBinding;
-    size_t offset = 0;
- 
-    // create/bind positions/tex.ccord. buffer
-    if (!decl->findElementBySemantic(VES_POSITION))
-        decl->addElement(POS_TEX_BINDING, offset, VET_FLOAT3, VES_POSITION);
- 
-    offset += VertexElement::getTypeSize(VET_FLOAT3);
- 
-    if (!decl->findElementBySemantic(VES_TEXTURE_COORDINATES))
-        decl->addElement(POS_TEX_BINDING, offset, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES, 0);
  
     HardwareVertexBufferSharedPtr ptbuf = HardwareBufferManager::getSingleton().createVertexBuffer(decl->getVertexSize(POS_TEX_BINDING),
-        mRenderOp.vertexData->vertexCount,
+        capacity,
         HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
     bind->setBinding(POS_TEX_BINDING, ptbuf);
  
-    // Colours - store these in a separate buffer because they change less often
-    if (!decl->findElementBySemantic(VES_DIFFUSE))
-        decl->addElement(COLOUR_BINDING, 0, VET_COLOUR, VES_DIFFUSE);
- 
     HardwareVertexBufferSharedPtr cbuf = HardwareBufferManager::getSingleton().createVertexBuffer(decl->getVertexSize(COLOUR_BINDING),
-        mRenderOp.vertexData->vertexCount,
+        capacity,
         HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
     bind->setBinding(COLOUR_BINDING, cbuf);
  
-    size_t charlen = mCaption.size();
-    float *pPCBuff = static_cast<float*>(ptbuf->lock(HardwareBuffer::HBL_DISCARD));
+    // The new buffers hold nothing yet, so everything is written next time
+    mVertexCapacity = capacity;
+    mVertices.assign(capacity * FLOATS_PER_VERTEX, 0.0f);
+    mWrittenCount = 0;
+    mUpdateColors = true;
+}
+ 
+void MovableText::_writeVertex(size_t vertex, float x, float y, float u, float v)
+{
+    // Vertices the card already has are left alone
+    float *pVert = &mVertices[vertex * FLOATS_PER_VERTEX];
+    if (vertex < mWrittenCount && pVert[0] == x && pVert[1] == y && pVert[3] == u && pVert[4] == v)
+        return;
+ 
+    pVert[0] = x;
+    pVert[1] = y;
+    pVert[2] = -1.0f;
+    pVert[3] = u;
+    pVert[4] = v;
+    if (vertex < mDirtyStart)
+        mDirtyStart = vertex;
+    if (vertex + 1 > mDirtyEnd)
+        mDirtyEnd = vertex + 1;
+}
+ 
+void MovableText::_setupGeometry()
+{
+    assert(mpFont);
+    assert(!mpMaterial.isNull());
+ 
+    // Only glyphs that aren't spaces get tris, the buffers are sized for the whole caption
+    size_t vertexCount = mCaption.size() * 6;
+ 
+    if (!mRenderOp.vertexData)
+    {
+        mRenderOp.vertexData = new VertexData();
+        mRenderOp.indexData = 0;
+        mRenderOp.vertexData->vertexStart = 0;
+        mRenderOp.operationType = RenderOperation::OT_TRIANGLE_LIST; 
+        mRenderOp.useIndexes = false; 
+ 
+        // positions/tex.coord. buffer, then colours in a separate buffer because they change less often
+        VertexDeclaration  *decl = mRenderOp.vertexData->vertexDeclaration;
+        decl->addElement(POS_TEX_BINDING, 0, VET_FLOAT3, VES_POSITION);
+        decl->addElement(POS_TEX_BINDING, VertexElement::getTypeSize(VET_FLOAT3), Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES, 0);
+        decl->addElement(COLOUR_BINDING, 0, VET_COLOUR, VES_DIFFUSE);
+    }
+ 
+    if (vertexCount > mVertexCapacity)
+        _createBuffers(vertexCount);
+ 
+    mDirtyStart = mVertexCapacity;
+    mDirtyEnd = 0;
+    size_t vertex = 0;
  
     float largestWidth = 0;
     float left = 0 * 2.0 - 1.0;
@@ -224,11 +268,11 @@ void MovableText::_setupGeometry()
     Real spaceWidth = mSpaceWidth;
     // Derive space width from a capital A
     if (spaceWidth == 0)
-        spaceWidth = mpFont->getGlyphAspectRatio('A') * mCharHeight * 2.0;
+        spaceWidth = mpGlyphs->aspectRatios['A'] * mCharHeight * 2.0;
  
     // for calculation of AABB
     Ogre::Vector3 min, max, currPos;
-    Ogre::Real maxSquaredRadius;
+    Ogre::Real maxSquaredRadius = 0;
     bool first = true;
  
     // Use iterator
@@ -236,6 +280,7 @@ void MovableText::_setupGeometry()
     iend = mCaption.end();
     bool newLine = true;
     Real len = 0.0f;
+    Real lineOffset = 0.0f;
  
     Real verticalOffset = 0;
     switch (mVerticalAlignment)
@@ -268,8 +313,9 @@ void MovableText::_setupGeometry()
                 if (*j == ' ')
                     len += spaceWidth;
                 else 
-                    len += mpFont->getGlyphAspectRatio((unsigned char)*j) * mCharHeight * 2.0;
+                    len += mpGlyphs->aspectRatios[(unsigned char)*j] * mCharHeight * 2.0;
             }
+            lineOffset = (mHorizontalAlignment == MovableText::H_LEFT) ? 0 : len / 2;
             newLine = false;
         }
  
@@ -285,163 +331,69 @@ void MovableText::_setupGeometry()
         {
             // Just leave a gap, no tris
             left += spaceWidth;
-            // Also reduce tri count
-            mRenderOp.vertexData->vertexCount -= 6;
             continue;
         }
  
-        Real horiz_height = mpFont->getGlyphAspectRatio((unsigned char)*i);
-        Real u1, u2, v1, v2; 
-        Ogre::Font::UVRect utmp;
-        utmp = mpFont->getGlyphTexCoords((unsigned char)*i);
-        u1 = utmp.left;
-        u2 = utmp.right;
-        v1 = utmp.top;
-        v2 = utmp.bottom;
- 
-        // each vert is (x, y, z, u, v)
-        //-------------------------------------------------------------------------------------
-        // First tri
-        //
-        // Upper left
-        if(mHorizontalAlignment == MovableText::H_LEFT)
-            *pPCBuff++ = left;
-        else
-            *pPCBuff++ = left - (len / 2);
-        *pPCBuff++ = top;
-        *pPCBuff++ = -1.0;
-        *pPCBuff++ = u1;
-        *pPCBuff++ = v1;
- 
-        // Deal with bounds
-        if(mHorizontalAlignment == MovableText::H_LEFT)
-            currPos = Ogre::Vector3(left, top, -1.0);
-        else
-            currPos = Ogre::Vector3(left - (len / 2), top, -1.0);
-        if (first)
-        {
-            min = max = currPos;
-            maxSquaredRadius = currPos.squaredLength();
-            first = false;
-        }
-        else
+        Real horiz_height = mpGlyphs->aspectRatios[(unsigned char)*i];
+        const Font::UVRect &utmp = mpGlyphs->uvs[(unsigned char)*i];
+        Real u1 = utmp.left;
+        Real u2 = utmp.right;
+        Real v1 = utmp.top;
+        Real v2 = utmp.bottom;
+ 
+        Real x1 = left - lineOffset;
+        Real x2 = x1 + horiz_height * mCharHeight * 2.0;
+        Real y1 = top;
+        Real y2 = top - mCharHeight * 2.0;
+ 
+        // each vert is (x, y, z, u, v), two tris: upper left, bottom left, top right, then top right, bottom left, bottom right
+        _writeVertex(vertex++, x1, y1, u1, v1);
+        _writeVertex(vertex++, x1, y2, u1, v2);
+        _writeVertex(vertex++, x2, y1, u2, v1);
+        _writeVertex(vertex++, x2, y1, u2, v1);
+        _writeVertex(vertex++, x1, y2, u1, v2);
+        _writeVertex(vertex++, x2, y2, u2, v2);
+ 
+        // Deal with bounds, the glyph's corners are enough
+        Ogre::Vector3 corners[4] = { Ogre::Vector3(x1, y1, -1.0), Ogre::Vector3(x1, y2, -1.0), Ogre::Vector3(x2, y1, -1.0), Ogre::Vector3(x2, y2, -1.0) };
+        for (int c = 0; c < 4; c++)
         {
-            min.makeFloor(currPos);
-            max.makeCeil(currPos);
-            maxSquaredRadius = std::max(maxSquaredRadius, currPos.squaredLength());
+            currPos = corners[c];
+            if (first)
+            {
+                min = max = currPos;
+                maxSquaredRadius = currPos.squaredLength();
+                first = false;
+            }
+            else
+            {
+                min.makeFloor(currPos);
+                max.makeCeil(currPos);
+                maxSquaredRadius = std::max(maxSquaredRadius, currPos.squaredLength());
+            }
         }
  
-        top -= mCharHeight * 2.0;
- 
-        // Bottom left
-        if(mHorizontalAlignment == MovableText::H_LEFT)
-            *pPCBuff++ = left;
-        else
-            *pPCBuff++ = left - (len / 2);
-        *pPCBuff++ = top;
-        *pPCBuff++ = -1.0;
-        *pPCBuff++ = u1;
-        *pPCBuff++ = v2;
- 
-        // Deal with bounds
-        if(mHorizontalAlignment == MovableText::H_LEFT)
-            currPos = Ogre::Vector3(left, top, -1.0);
-        else
-            currPos = Ogre::Vector3(left - (len / 2), top, -1.0);
-        min.makeFloor(currPos);
-        max.makeCeil(currPos);
-        maxSquaredRadius = std::max(maxSquaredRadius, currPos.squaredLength());
- 
-        top += mCharHeight * 2.0;
         left += horiz_height * mCharHeight * 2.0;
  
-        // Top right
-        if(mHorizontalAlignment == MovableText::H_LEFT)
-            *pPCBuff++ = left;
-        else
-            *pPCBuff++ = left - (len / 2);
-        *pPCBuff++ = top;
-        *pPCBuff++ = -1.0;
-        *pPCBuff++ = u2;
-        *pPCBuff++ = v1;
-        //-------------------------------------------------------------------------------------
- 
-        // Deal with bounds
-        if(mHorizontalAlignment == MovableText::H_LEFT)
-            currPos = Ogre::Vector3(left, top, -1.0);
-        else
-            currPos = Ogre::Vector3(left - (len / 2), top, -1.0);
-        min.makeFloor(currPos);
-        max.makeCeil(currPos);
-        maxSquaredRadius = std::max(maxSquaredRadius, currPos.squaredLength());
- 
-        //-------------------------------------------------------------------------------------
-        // Second tri
-        //
-        // Top right (again)
-        if(mHorizontalAlignment == MovableText::H_LEFT)
-            *pPCBuff++ = left;
-        else
-            *pPCBuff++ = left - (len / 2);
-        *pPCBuff++ = top;
-        *pPCBuff++ = -1.0;
-        *pPCBuff++ = u2;
-        *pPCBuff++ = v1;
- 
-        currPos = Ogre::Vector3(left, top, -1.0);
-        min.makeFloor(currPos);
-        max.makeCeil(currPos);
-        maxSquaredRadius = std::max(maxSquaredRadius, currPos.squaredLength());
- 
-        top -= mCharHeight * 2.0;
-        left -= horiz_height  * mCharHeight * 2.0;
- 
-        // Bottom left (again)
-        if(mHorizontalAlignment == MovableText::H_LEFT)
-            *pPCBuff++ = left;
-        else
-            *pPCBuff++ = left - (len / 2);
-        *pPCBuff++ = top;
-        *pPCBuff++ = -1.0;
-        *pPCBuff++ = u1;
-        *pPCBuff++ = v2;
- 
-        currPos = Ogre::Vector3(left, top, -1.0);
-        min.makeFloor(currPos);
-        max.makeCeil(currPos);
-        maxSquaredRadius = std::max(maxSquaredRadius, currPos.squaredLength());
- 
-        left += horiz_height  * mCharHeight * 2.0;
- 
-        // Bottom right
-        if(mHorizontalAlignment == MovableText::H_LEFT)
-            *pPCBuff++ = left;
-        else
-            *pPCBuff++ = left - (len / 2);
-        *pPCBuff++ = top;
-        *pPCBuff++ = -1.0;
-        *pPCBuff++ = u2;
-        *pPCBuff++ = v2;
-        //-------------------------------------------------------------------------------------
- 
-        currPos = Ogre::Vector3(left, top, -1.0);
-        min.makeFloor(currPos);
-        max.makeCeil(currPos);
-        maxSquaredRadius = std::max(maxSquaredRadius, currPos.squaredLength());
- 
-        // Go back up with top
-        top += mCharHeight * 2.0;
- 
         float currentWidth = (left + 1)/2 - 0;
         if (currentWidth > largestWidth)
             largestWidth = currentWidth;
     }
  
-    // Unlock vertex buffer
-    ptbuf->unlock();
+    // Only the glyphs that moved or changed are sent to the card, vertices past the end are simply not drawn
+    mRenderOp.vertexData->vertexCount = vertex;
+    if (vertex > mWrittenCount)
+        mWrittenCount = vertex;
+    if (mDirtyStart < mDirtyEnd)
+    {
+        HardwareVertexBufferSharedPtr ptbuf = mRenderOp.vertexData->vertexBufferBinding->getBuffer(POS_TEX_BINDING);
+        size_t vertexSize = ptbuf->getVertexSize();
+        ptbuf->writeData(mDirtyStart * vertexSize, (mDirtyEnd - mDirtyStart) * vertexSize, &mVertices[mDirtyStart * FLOATS_PER_VERTEX],
+            mDirtyStart == 0 && mDirtyEnd == mWrittenCount);
+    }
  
     // update AABB/Sphere radius
-    mAABB = Ogre::AxisAlignedBox(min, max);
+    mAABB = first ? Ogre::AxisAlignedBox() : Ogre::AxisAlignedBox(min, max);
     mRadius = Ogre::Math::Sqrt(maxSquaredRadius);
  
     if (mUpdateColors)
@@ -458,9 +410,10 @@ void MovableText::_updateColors(void)
     // Convert to system-specific
     RGBA color;
     Root::getSingleton().convertColourValue(mColor, &color);
+    // Every vertex is one colour, so the whole buffer is filled and never needs touching when the caption changes
     HardwareVertexBufferSharedPtr vbuf = mRenderOp.vertexData->vertexBufferBinding->getBuffer(COLOUR_BINDING);
     RGBA *pDest = static_cast<RGBA*>(vbuf->lock(HardwareBuffer::HBL_DISCARD));
-    for (int i = 0; i < (int)mRenderOp.vertexData->vertexCount; ++i)
+    for (int i = 0; i < (int)mVertexCapacity; ++i)
         *pDest++ = color;
     vbuf->unlock();
     mUpdateColors = false;
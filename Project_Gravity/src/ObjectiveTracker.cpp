@@ -0,0 +1,150 @@
+#include "stdafx.h"
+#include "ObjectiveTracker.h"
+#include "ArchetypeRegistry.h"
+
+/* Keeps track of a level's win and lose objectives as the level is played.
+ * Objectives come from the level descriptor as counts of a category of level object. Each hit bumps
+ * its category's counter and checks only the objectives on that category, and the tracker keeps a
+ * tally of how many win objectives are still outstanding and how many lose objectives have been met,
+ * so asking whether the level is won or lost is constant time however many objects the level has.
+ * Objectives on getting objects above a height are checked against the live bodies until they are met.
+ */
+
+//Constructor
+ObjectiveTracker::ObjectiveTracker()
+{
+	reset();
+}
+
+//Destructor
+ObjectiveTracker::~ObjectiveTracker()
+{
+}
+
+//Drops every objective, the level can then be neither won nor lost
+void ObjectiveTracker::reset(void)
+{
+	mObjectives.clear();
+	for (int t = 0; t < EntityStore::ENTITY_TYPES; t++)
+	{
+		mHitObjectives[t].clear();
+		mHits[t] = 0;
+	}
+	mHeightObjectives.clear();
+	mWinsLeft = 0;
+	mLossesMet = 0;
+	mHasWin = false;
+}
+
+/* Sets up a newly loaded level's objectives.
+ * "all" is resolved to how many objects of the category the level has */
+void ObjectiveTracker::begin(const std::vector<LevelObjective> &objectives, const EntityStore &entities)
+{
+	reset();
+
+	for (unsigned int i = 0; i < objectives.size(); i++)
+	{
+		const LevelObjective &levelObjective = objectives[i];
+		Objective objective;
+		if (!ArchetypeRegistry::parseCategory(levelObjective.category, objective.category))
+		{
+			LogManager::getSingleton().logMessage("ObjectiveTracker: unknown category " + levelObjective.category);
+			continue;
+		}
+		objective.lose = levelObjective.lose;
+		objective.required = levelObjective.amount;
+		objective.height = levelObjective.height;
+		if (objective.required == LevelObjective::ALL_OBJECTS)
+		{
+			//Every one of nothing is treated as one, so a level missing its objects can't be won straight away
+			objective.required = entities.getTypeCount(objective.category);
+		}
+		if (objective.required < 1)
+			objective.required = 1;
+
+		int index = mObjectives.size();
+		mObjectives.push_back(objective);
+		if (!objective.lose)
+		{
+			mHasWin = true;
+			mWinsLeft++;
+		}
+
+		if (levelObjective.aboveHeight)
+			mHeightObjectives.push_back(index);
+		else
+			mHitObjectives[objective.category].push_back(index);
+	}
+}
+
+//Whether any objective counts hits on a category
+bool ObjectiveTracker::isTracked(EntityStore::EntityType type) const
+{
+	return !mHitObjectives[type].empty();
+}
+
+//Counts one hit on a category, updating only the objectives that count it
+void ObjectiveTracker::recordHit(EntityStore::EntityType type)
+{
+	mHits[type]++;
+	const std::vector<int> &objectives = mHitObjectives[type];
+	for (unsigned int i = 0; i < objectives.size(); i++)
+	{
+		//Counts go up one at a time, so this is only true on the hit that meets the objective
+		if (mHits[type] == mObjectives[objectives[i]].required)
+			meet(objectives[i]);
+	}
+}
+
+/* Counts the objects above each height objective's height where their bodies are now, returns whether
+ * any objective was met. Only objects whose bounds reach above the height are looked at, found through the
+ * entity index, so the index must be up to date. Met objectives stay met, like hits, and stop being checked */
+bool ObjectiveTracker::checkHeights(const EntityStore &entities)
+{
+	bool met = false;
+	for (unsigned int i = 0; i < mHeightObjectives.size();)
+	{
+		const Objective &objective = mObjectives[mHeightObjectives[i]];
+		mRaised.clear();
+		entities.findInBox(AxisAlignedBox(-Math::POS_INFINITY, objective.height, -Math::POS_INFINITY,
+			Math::POS_INFINITY, Math::POS_INFINITY, Math::POS_INFINITY), mRaised);
+
+		int raised = 0;
+		for (unsigned int r = 0; r < mRaised.size() && raised < objective.required; r++)
+		{
+			int e = entities.getIndex(mRaised[r]);
+			if (e >= 0 && entities.getType(e) == objective.category && entities.getBody(e)->getWorldPosition().y > objective.height)
+				raised++;
+		}
+
+		if (raised < objective.required)
+		{
+			i++;
+			continue;
+		}
+		meet(mHeightObjectives[i]);
+		mHeightObjectives[i] = mHeightObjectives.back();
+		mHeightObjectives.pop_back();
+		met = true;
+	}
+	return met;
+}
+
+//Updates the tallies for an objective that has just been met
+void ObjectiveTracker::meet(int objective)
+{
+	if (mObjectives[objective].lose)
+		mLossesMet++;
+	else
+		mWinsLeft--;
+}
+
+//Where the level stands, a met lose objective outweighs everything else
+ObjectiveTracker::State ObjectiveTracker::getState(void) const
+{
+	if (mLossesMet > 0)
+		return OBJECTIVES_LOST;
+	if (mHasWin && mWinsLeft == 0)
+		return OBJECTIVES_WON;
+	return OBJECTIVES_PLAYING;
+}
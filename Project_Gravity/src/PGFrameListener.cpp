@@ -1,8 +1,20 @@
 #include "stdafx.h"
 #include "PGFrameListener.h"
+#include "ArchetypeRegistry.h"
 #include <iostream>
 
-extern const int NUM_FISH;
+//Every level's random streams are derived from this, so a level always plays out the same way
+const Ogre::uint32 BASE_LEVEL_SEED = 0x5EED0000;
+//Stream number of the fish school's shared heading, fish use their index
+const Ogre::uint32 SCHOOL_RANDOM_STREAM = 0xFFFFFFFF;
+//Time per frame spent loading the next level's assets on the level complete screen
+const unsigned long PREFETCH_BUDGET_MS = 8;
+//Height of HUD text, the screen is 2 high
+const Real HUD_CHAR_HEIGHT = 0.11f;
+//Bullet wants a name for every body, entities and scene nodes are named by the scene manager
+static NameGenerator bodyNames("Body");
+//Where the collision callback reports gameplay events, it has no other way to reach the frame listener
+static GameEvents* contactEvents = NULL;
 
 using namespace std;
 /* This class is the main class of the project. It is what deals with all triggered events (mouse or keyboard)
@@ -48,6 +60,7 @@ bool CustomCallback(btManifoldPoint& cp, const btCollisionObject* obj0,int partI
 			double zDiff = target->getCenterOfMassPosition().z() - rbProjectile->getCenterOfMassPosition().z();
 			target->setFriction(0.94f);
 			target->setRestitution((double) ((105 - (2*sqrt(xDiff*xDiff + yDiff*yDiff + zDiff*zDiff)))/1000));
+			contactEvents->publish(GameEvents::EVENT_TARGET_HIT, target);
 		}
 		else
 		{
@@ -59,6 +72,7 @@ bool CustomCallback(btManifoldPoint& cp, const btCollisionObject* obj0,int partI
 			double zDiff = target->getCenterOfMassPosition().z() - rbProjectile->getCenterOfMassPosition().z();
 			target->setFriction(0.94f);
 			target->setRestitution((double) ((105 - (2*sqrt(xDiff*xDiff + yDiff*yDiff + zDiff*zDiff)))/1000));
+			contactEvents->publish(GameEvents::EVENT_TARGET_HIT, target);
 		}
 	}
 
@@ -72,6 +86,7 @@ bool CustomCallback(btManifoldPoint& cp, const btCollisionObject* obj0,int partI
 			btRigidBody* coconut = (btRigidBody*)obj0;
 			coconut->setCollisionFlags(btCollisionObject::CF_NO_CONTACT_RESPONSE);
 			coconut->setFriction(0.94f);
+			contactEvents->publish(GameEvents::EVENT_COCONUT_COLLECTED, coconut);
 		}
 		else
 		{
@@ -79,6 +94,7 @@ bool CustomCallback(btManifoldPoint& cp, const btCollisionObject* obj0,int partI
 			btCollisionShape* player = (btCollisionShape*)obj0->getCollisionShape();
 			coconut->setCollisionFlags(btCollisionObject::CF_NO_CONTACT_RESPONSE);
 			coconut->setFriction(0.94f);
+			contactEvents->publish(GameEvents::EVENT_COCONUT_COLLECTED, coconut);
 		}
 	}
 
@@ -90,11 +106,13 @@ bool CustomCallback(btManifoldPoint& cp, const btCollisionObject* obj0,int partI
 		{
 			btRigidBody* red = (btRigidBody*)obj1;
 			red->setFriction(0.94f);
+			contactEvents->publish(GameEvents::EVENT_RED_HIT, red);
 		}
 		else
 		{
 			btRigidBody* red = (btRigidBody*)obj0;
 			red->setFriction(0.94f);
+			contactEvents->publish(GameEvents::EVENT_RED_HIT, red);
 		}
 		std::cout << "Fail - you hit a red block with a coconut D:" << std::endl;
 	}
@@ -106,11 +124,13 @@ bool CustomCallback(btManifoldPoint& cp, const btCollisionObject* obj0,int partI
 		{
 			btRigidBody* orange = (btRigidBody*)obj1;
 			orange->setFriction(0.94f);
+			contactEvents->publish(GameEvents::EVENT_BLOCK_GROUNDED, orange);
 		}
 		else
 		{
 			btRigidBody* orange = (btRigidBody*)obj0;
 			orange->setFriction(0.94f);
+			contactEvents->publish(GameEvents::EVENT_BLOCK_GROUNDED, orange);
 		}
 		std::cout << "Orange block hit ground" << std::endl;
 	}
@@ -122,11 +142,13 @@ bool CustomCallback(btManifoldPoint& cp, const btCollisionObject* obj0,int partI
 		{
 			btRigidBody* blue = (btRigidBody*)obj1;
 			blue->setFriction(0.94f);
+			contactEvents->publish(GameEvents::EVENT_BLOCK_GROUNDED, blue);
 		}
 		else
 		{
 			btRigidBody* blue = (btRigidBody*)obj0;
 			blue->setFriction(0.94f);
+			contactEvents->publish(GameEvents::EVENT_BLOCK_GROUNDED, blue);
 		}
 		std::cout << "Fail - you let a blue block touch the ground D:" << std::endl;
 	}
@@ -151,7 +173,7 @@ PGFrameListener::PGFrameListener (
 			mInputManager(0), mMouse(0), mKeyboard(0), mShutDown(false), mTopSpeed(150), 
 			mVelocity(Ogre::Vector3::ZERO), mGoingForward(false), mGoingBack(false), mGoingLeft(false), 
 			mGoingRight(false), mGoingUp(false), mGoingDown(false), mFastMove(false),
-			freeRoam(false), mPaused(true), gunActive(false), shotGun(false), mFishAlive(NUM_FISH),
+			freeRoam(false), mPaused(true), gunActive(false), shotGun(false), mFishAlive(0),
 			mLastPositionLength((Ogre::Vector3(1500, 100, 1500) - mCamera->getDerivedPosition()).length()), mTimeMultiplier(0.1f),mPalmShapeCreated(false),
 			mFrameCount(0)
 {
@@ -219,7 +241,33 @@ PGFrameListener::PGFrameListener (
 	gContactAddedCallback = CustomCallback;
 	cout << "CALLBACK: " << gContactAddedCallback << endl;
 
+	mLevelPrefetcher = new LevelPrefetcher();
+	mEntities = new EntityStore();
+	mImpostors = new ImpostorRenderer(mSceneMgr);
+	mImpostors->loadSettings("Impostor.cfg");
+	mPropBatcher = new PropBatcher(mSceneMgr, mImpostors);
+	mVegetation = new VegetationRenderer(mSceneMgr, mImpostors);
+	mGameEvents = new GameEvents();
+	mGameEvents->subscribe(GameEvents::EVENT_COCONUT_COLLECTED, this);
+	mGameEvents->subscribe(GameEvents::EVENT_TARGET_HIT, this);
+	mGameEvents->subscribe(GameEvents::EVENT_BLOCK_GROUNDED, this);
+	mGameEvents->subscribe(GameEvents::EVENT_RED_HIT, this);
+	contactEvents = mGameEvents;
+	mCheckLevelEnd = false;
+	mObjectives = new ObjectiveTracker();
+	mArchetypes = new ArchetypeRegistry();
+	mArchetypes->load("../../res/Levels/Archetypes.txt");
+	mBackgroundWriter = new BackgroundWriter();
+	mEditorJournal = new EditorJournal(mBackgroundWriter);
+	mHighScores = new HighScoreStore(mBackgroundWriter, "../../res/Levels/HighScores.dat");
+	mHighScores->load();
+	mLevelCatalog = new LevelCatalog(mBackgroundWriter, "../../res/Levels/Custom/");
+	mLevelCatalog->load();
+
 	// Create the flocking fish
+	mFishRenderer = new FishRenderer(mSceneMgr);
+	mFishScheduler = new FishScheduler();
+	mFishScheduler->loadSettings("Fish.cfg");
 	spawnFish();
 
 	// Create RaySceneQuery
@@ -261,6 +309,8 @@ PGFrameListener::PGFrameListener (
 	gravityGun->roll(Degree(4));
 	gravityGun->setScale(3.0, 3.0, 3.0);
 	gravityGunEnt->setCastShadows(false);
+	gravityGunEnt->removeVisibilityFlags(VISIBLE_IN_REFLECTION); //The gun shouldn't reflect itself
+	gravityGunEnt->setQueryFlags(0);
 	gravityGun->attachObject(gravityGunEnt);
 	fovy = mCamera->getFOVy();
 	camAsp = mCamera->getAspectRatio();
@@ -316,45 +366,34 @@ PGFrameListener::PGFrameListener (
 	spinTime = 0;
 	
 	/*We set up variables for edit mode.
-	* objSpawnType indicates the type of object to be placed:
-	* 1		Box
-	* 2		Coconut
-	* 3		Target
+	* objSpawnType is the editor slot of the archetype to be placed,
+	* see Archetypes.txt for which object each number key places
 	*/
 	editMode = false;
 	snap = true;
 	objSpawnType = 1;
-	//Create the box to show where spawned object will be placed
- 	boxEntity = mSceneMgr->createEntity(
- 			"CrateDefault",
- 			"Crate.mesh");
-	coconutEntity = mSceneMgr->createEntity(
-			"CoconutDefault",
-			"Coco.mesh");
-	targetEntity = mSceneMgr->createEntity(
-			"TargetDefault",
-			"Target.mesh");
-	blockEntity = mSceneMgr->createEntity(
-			"DynBlockDefault",
-			"Jenga.mesh");
-	palm1Entity = mSceneMgr->createEntity(
-			"Palm1Default",
-			"Palm1.mesh");
-	palm2Entity = mSceneMgr->createEntity(
-			"Palm2Default",
-			"Palm2.mesh");
-	orangeEntity = mSceneMgr->createEntity(
-		"orangeDefault",
-		"Jenga.mesh");
-	blueEntity = mSceneMgr->createEntity(
-		"blueDefault",
-		"Jenga.mesh");
-	redEntity = mSceneMgr->createEntity(
-		"redDefault",
-		"Jenga.mesh");
- 	boxEntity->setCastShadows(true);
+	//Debug overlay shows how many fish are in each update tier, toggled with F3
+	mDebugOverlay = OverlayManager::getSingleton().getByName("Core/DebugOverlay");
+	mDebugTextElement = OverlayManager::getSingleton().hasOverlayElement("Core/DebugText") ?
+		OverlayManager::getSingleton().getOverlayElement("Core/DebugText") : NULL;
+	mStatsOn = false;
+
+	//Create the objects to show where spawned objects will be placed
+	mSpawnPreviews.assign(ArchetypeRegistry::EDITOR_SLOTS, (Ogre::Entity *) NULL);
+	for (int slot = 0; slot < ArchetypeRegistry::EDITOR_SLOTS; slot++)
+	{
+		const Archetype* archetype = mArchetypes->getEditorArchetype(slot);
+		if (!archetype)
+			continue;
+
+		mSpawnPreviews[slot] = mSceneMgr->createEntity(archetype->key + "Default", archetype->mesh);
+		if (!archetype->material.empty())
+			mSpawnPreviews[slot]->setMaterialName(archetype->material);
+		mSpawnPreviews[slot]->setCastShadows(true);
+		mSpawnPreviews[slot]->removeVisibilityFlags(VISIBLE_IN_REFLECTION);
+	}
 	mSpawnObject = mSceneMgr->getRootSceneNode()->createChildSceneNode("spawnObject");
-    mSpawnObject->attachObject(boxEntity);
+	selectSpawnType(objSpawnType);
 	mSpawnObject->setScale(15, 15, 15);
 	mSpawnLocation = Ogre::Vector3(2000.f,2000.f,2000.f);
 
@@ -365,21 +404,14 @@ PGFrameListener::PGFrameListener (
 	gridsize = 3;
 	weatherSystem = 0;
 
-	for (int i = 0; i < NUM_FISH; i++)
-	{
-		mFishDead[i] = false;
-		mFishLastMove[i] = GetTickCount();
-		mFishLastDirection[i] = Vector3(1, -0.2, 1);
-	}
-
 	// Create the day/night system
-	createCaelumSystem();
+	createCaelumSystem(getLevelDescriptor(currentLevel).mSky == LevelDescriptor::SKY_CAELUM_CLOUDS);
 	mCaelumSystem->getSun()->setSpecularMultiplier(Ogre::ColourValue(0.3, 0.3, 0.3));
 
 	// Shadow caster
-	Ogre::Light *mLight1 = mSceneMgr->createLight("Light1");
-	mLight1->setType(Ogre::Light::LT_DIRECTIONAL);
-	spotOn = false;
+	mShadowLight = mSceneMgr->createLight("Light1");
+	mShadowLight->setType(Ogre::Light::LT_DIRECTIONAL);
+	mSpotLight = NULL;
 
 	// Create SkyX object
 	mSkyX = new SkyX::SkyX(mSceneMgr, mCamera);
@@ -432,9 +464,8 @@ PGFrameListener::PGFrameListener (
     mTerrainGroup = OGRE_NEW Ogre::TerrainGroup(mSceneMgr, Ogre::Terrain::ALIGN_X_Z, 129, 3000.0f);
 	createTerrain(currentLevel);
 
-	//How many custom levels have been generated so far
-	mMenus->mNumberOfCustomLevels = findUniqueName()-1;
-	mMenus->mNewLevelsMade = 0;
+	//Any edit left unfinished by a crash is saved as a custom level
+	recoverEditorAutosave();
 
 	//Particles :)
 	gunParticle = mSceneMgr->createParticleSystem("spiral", "Spiral");		//Grabbing
@@ -443,45 +474,31 @@ PGFrameListener::PGFrameListener (
 	gravityGun->attachObject(gunParticle2);
 	gunParticle->setEmitting(false);
 	gunParticle2->setEmitting(false);
+	gunParticle->removeVisibilityFlags(VISIBLE_IN_REFLECTION);
+	gunParticle2->removeVisibilityFlags(VISIBLE_IN_REFLECTION);
 	//Sun :D
 	sunParticle = mSceneMgr->createParticleSystem("Sun", "Sun");
 	sunNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("SunNode");
 	sunNode->attachObject(sunParticle);
 	sunParticle->setEmitting(true);
 	//HUD
-	HUDTargetText = new MovableText("targetText" + StringConverter::toString(mNumEntitiesInstanced), "Targets hit: 0 ", "000_@KaiTi_33", 3.3f);
-	HUDCoconutText = new MovableText("coconutText" + StringConverter::toString(mNumEntitiesInstanced), "Coconuts: 0 ", "000_@KaiTi_33", 3.3f);
-	HUDScoreText = new MovableText("scoreText" + StringConverter::toString(mNumEntitiesInstanced), "Score: 0 ", "000_@KaiTi_33", 3.3f);
-	timerText = new MovableText("timerText" + StringConverter::toString(mNumEntitiesInstanced), "00:00 ", "000_@KaiTi_33", 3.3f);
-	String timeString = "00:00";
-	HUDTargetText->setTextAlignment(MovableText::H_CENTER, MovableText::V_ABOVE);
-	HUDTargetText->showOnTop();
-	HUDTargetText->setColor(Ogre::ColourValue(1,0,0,0.9));
-	HUDCoconutText->setTextAlignment(MovableText::H_CENTER, MovableText::V_ABOVE);
-	HUDCoconutText->showOnTop();
-	HUDCoconutText->setColor(Ogre::ColourValue(1,0,0,0.9));
-	HUDScoreText->setTextAlignment(MovableText::H_CENTER, MovableText::V_ABOVE);
-	HUDScoreText->showOnTop();
-	HUDScoreText->setColor(Ogre::ColourValue(1,0,0,0.9));
-	timerText->setTextAlignment(MovableText::H_CENTER, MovableText::V_ABOVE);
-	timerText->showOnTop();
-	timerText->setColor(Ogre::ColourValue(1,0,0,0.9));
-	HUDNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("HUDNode");
-	HUDNode2 = HUDNode->createChildSceneNode("HUDNode2");
-	HUDNode3 = HUDNode->createChildSceneNode("HUDNode3");
-	HUDNode4 = HUDNode->createChildSceneNode("HUDNode4");
-	timerNode = HUDNode->createChildSceneNode("timerNode");
-	HUDNode2->attachObject(HUDTargetText); //Targets killed
-	HUDNode2->setPosition(-30,-25,0);
-	HUDNode3->attachObject(HUDCoconutText); //Coconuts
-	HUDNode3->setPosition(-35, 25,0);
-	HUDNode4->attachObject(HUDScoreText); //Score
-	HUDNode4->setPosition(37, 25,0);
-	timerNode->attachObject(timerText);
-	timerNode->setPosition(0, 25,0);
+	mHUD = new HUDLayer("000_@KaiTi_33", mWindow->getViewport(0));
+	mHUDTargets = mHUD->addField(-0.77f, -0.86f, HUD_CHAR_HEIGHT, ColourValue(1, 0, 0, 0.9f), 24);
+	mHUDCoconuts = mHUD->addField(-0.9f, 0.86f, HUD_CHAR_HEIGHT, ColourValue(1, 0, 0, 0.9f), 24);
+	mHUDScore = mHUD->addField(0.95f, 0.86f, HUD_CHAR_HEIGHT, ColourValue(1, 0, 0, 0.9f), 24);
+	mHUDTimer = mHUD->addField(0, 0.86f, HUD_CHAR_HEIGHT, ColourValue(1, 0, 0, 0.9f), 12);
+	mHUD->build();
+	mHUD->setNumber(mHUDTargets, "Targets hit: ", 0);
+	mHUD->setNumber(mHUDCoconuts, "Coconuts: ", 0);
+	mHUD->setNumber(mHUDScore, "Score: ", 0);
+	mHUD->setTime(mHUDTimer, 0);
+	mSceneMgr->getRootSceneNode()->attachObject(mHUD);
+	mShowHUD = false;
+	mHUD->setVisible(false);
 	timer = new Timer();
 	currentTime = 0;
 	levelTime = 0; //Target time for level in seconds
+	winBonus = 0;
 	mPausedTime = 0;
 }
 
@@ -490,6 +507,23 @@ PGFrameListener::~PGFrameListener()
 {
 	// We created the query, and we are also responsible for deleting it.
     mSceneMgr->destroyQuery(mRaySceneQuery);
+	delete mFishRenderer;
+	delete mFishScheduler;
+	delete mGunReflection;
+	delete mLevelPrefetcher;
+	delete mVegetation;
+	delete mPropBatcher;
+	delete mImpostors;
+	delete mHUD;
+	delete mEntities;
+	contactEvents = NULL;
+	delete mGameEvents;
+	delete mObjectives;
+	delete mArchetypes;
+	delete mEditorJournal;
+	delete mHighScores;
+	delete mLevelCatalog;
+	delete mBackgroundWriter; //Waits for any saves still being written
  	delete mWorld->getDebugDrawer();
  	mWorld->setDebugDrawer(0);
  	delete mWorld;
@@ -570,13 +604,13 @@ bool PGFrameListener::frameStarted(const FrameEvent& evt)
 				Ogre::Vector3 sunPos = mCamera->getDerivedPosition() - lightDir*mSkyX->getMeshManager()->getSkydomeRadius()*0.1;
 				mHydrax->setSunPosition(sunPos);
 
-				if (spotOn)
+				if (mSpotLight)
 				{
-					mSceneMgr->getLight("Spot")->setPosition(mCamera->getDerivedPosition() + mCamera->getDerivedDirection() * 10);
-					mSceneMgr->getLight("Spot")->setDirection(mCamera->getDerivedDirection());
-					mSceneMgr->getLight("Spot")->setDiffuseColour(1, 1, 1);
-					mSceneMgr->getLight("Spot")->setSpecularColour(1, 1, 1);
-					mSceneMgr->getLight("Spot")->setVisible(true);
+					mSpotLight->setPosition(mCamera->getDerivedPosition() + mCamera->getDerivedDirection() * 10);
+					mSpotLight->setDirection(mCamera->getDerivedDirection());
+					mSpotLight->setDiffuseColour(1, 1, 1);
+					mSpotLight->setSpecularColour(1, 1, 1);
+					mSpotLight->setVisible(true);
 				}
 			}
 	
@@ -623,17 +657,19 @@ bool PGFrameListener::frameStarted(const FrameEvent& evt)
 					p2p->setPivotB (newPos);  
 				}
 			}
-			//Position HUD
-			HUDNode->setOrientation(mCamera->getDerivedOrientation());
-			HUDNode->setPosition(mCamera->getDerivedPosition() + mCamera->getDerivedDirection().normalisedCopy() * 70);
 		} //End of non-menu specifics
 
 		//Keep player upright
 		playerBody->getBulletRigidBody()->setAngularFactor(0.0);
 
 		if (editMode)
-		{ //Update preview object location
-			mSpawnLocation = mCamera->getDerivedPosition() + mCamera->getDerivedDirection().normalisedCopy() * spawnDistance;
+		{ //Update preview object location, pulled in front of any level object the camera is looking at
+			Ray aim(mCamera->getDerivedPosition(), mCamera->getDerivedDirection().normalisedCopy());
+			Real aimDistance = spawnDistance;
+			Real hitDistance;
+			if (mEntities->pick(aim, spawnDistance, hitDistance) != NULL_ENTITY)
+				aimDistance = std::max(hitDistance - mSpawnObject->_getWorldAABB().getHalfSize().length(), Real(0));
+			mSpawnLocation = aim.getPoint(aimDistance);
 			if (snap)
 			{
 				mSpawnLocation.x = floor(mSpawnLocation.x/gridsize) * gridsize + (gridsize/2);
@@ -653,15 +689,7 @@ bool PGFrameListener::frameStarted(const FrameEvent& evt)
 			} else {
 				currentTime = (timer->getMilliseconds() + mPausedTime);
 			}
-			if (((int)currentTime/1000)%60<10) //0 padding
-			{
-				timeString = StringConverter::toString((int)currentTime/60000)+":0"+StringConverter::toString(((int)currentTime/1000)%60);
-			}
-			else
-			{
-				timeString = StringConverter::toString((int)currentTime/60000)+":"+StringConverter::toString(((int)currentTime/1000)%60);
-			}
-			timerText->setCaption(timeString);
+			mHUD->setTime(mHUDTimer, (unsigned long) currentTime);
 		}
 	
 	} else {
@@ -680,8 +708,7 @@ bool PGFrameListener::frameEnded(const FrameEvent& evt)
 //Method for pre-rendering hydrax on gun
 void PGFrameListener::preRenderTargetUpdate(const RenderTargetEvent& evt)
 {
-	// Hide hydrax and show ogre ocean for gun reflection
-	gravityGun->setVisible(false);
+	// Hide hydrax and show ogre ocean for gun reflection, the gun itself is kept out by its visibility flags
 	mHydrax->setVisible(false);
 
 	if (weatherSystem == 0)
@@ -689,21 +716,12 @@ void PGFrameListener::preRenderTargetUpdate(const RenderTargetEvent& evt)
 		ocean->setVisible(true);
 		oceanFade->setVisible(true);
 	}
-
-	// point the camera in the right direction based on which face of the cubemap this is
-	mCamera->setOrientation(Quaternion::IDENTITY);
-	if (evt.source == mTargets[0]) mCamera->yaw(Degree(-90));
-	else if (evt.source == mTargets[1]) mCamera->yaw(Degree(90));
-	else if (evt.source == mTargets[2]) mCamera->pitch(Degree(90));
-	else if (evt.source == mTargets[3]) mCamera->pitch(Degree(-90));
-	else if (evt.source == mTargets[5]) mCamera->yaw(Degree(180));
 }
 
 //Method for returning hydrax to usual settings (undoes pre-render changes)
 void PGFrameListener::postRenderTargetUpdate(const RenderTargetEvent& evt)
 {
 	// Return visibility back to normal
-	gravityGun->setVisible(true); 
 	mHydrax->setVisible(hideHydrax);
 	if (weatherSystem == 0)
 	{
@@ -712,9 +730,12 @@ void PGFrameListener::postRenderTargetUpdate(const RenderTargetEvent& evt)
 	}
 }
 
-//Method to hide stars in gun reflection
+//Method to hide stars and the HUD in hydrax render targets
 void PGFrameListener::preRenderTargetUpdate(const Hydrax::RttManager::RttType& Rtt)
 {
+	//The HUD is drawn in screen space so would land on top of every water map
+	mHUD->setVisible(false);
+
 	if (weatherSystem == 1)
 	{
 		// If needed in any case...
@@ -748,6 +769,8 @@ void PGFrameListener::preRenderTargetUpdate(const Hydrax::RttManager::RttType& R
 //Method to undo alteration to stars so they are displayed normally again
 void PGFrameListener::postRenderTargetUpdate(const Hydrax::RttManager::RttType& Rtt)
 {
+	mHUD->setVisible(mShowHUD);
+
 	if (weatherSystem == 1)
 	{
 		bool underwater = mHydrax->_isCurrentFrameUnderwater();
@@ -778,20 +801,9 @@ void PGFrameListener::postRenderTargetUpdate(const Hydrax::RttManager::RttType&
 //Creates cube map for gun reflections
 void PGFrameListener::createCubeMap()
 {
-	// create our dynamic cube map texture
-	TexturePtr tex = TextureManager::getSingleton().createManual("dyncubemap",
-		ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, TEX_TYPE_CUBE_MAP, 256, 256, 0, PF_R8G8B8, TU_RENDERTARGET);
-
-	// assign our camera to all 6 render targets of the texture (1 for each direction)
-	for (unsigned int i = 0; i < 6; i++)
-	{
-		mTargets[i] = tex->getBuffer(i)->getRenderTarget();
-		mTargets[i]->addViewport(mCamera)->setOverlaysEnabled(false);
-		mTargets[i]->getViewport(0)->setClearEveryFrame(true);
-		mTargets[i]->getViewport(0)->setBackgroundColour(Ogre::ColourValue::Blue);
-		mTargets[i]->setAutoUpdated(false);
-		mTargets[i]->addListener(this);
-	}
+	mGunReflection = new ReflectionUpdater();
+	mGunReflection->loadSettings("Reflection.cfg");
+	mGunReflection->create("dyncubemap", "gravityGun", mSceneMgr, mCamera, this);
 }
 
 //Key-pressed event handler
@@ -810,6 +822,11 @@ bool PGFrameListener::keyPressed(const OIS::KeyEvent& evt)
     {
         Ogre::TextureManager::getSingleton().reloadAll();
     }
+    else if (evt.key == OIS::KC_F3)   // fish update stats
+    {
+        mStatsOn = !mStatsOn;
+        showDebugOverlay(mStatsOn);
+    }
     else if (evt.key == OIS::KC_SYSRQ)   // take a screenshot
     {
         mWindow->writeContentsToTimestampedFile("screenshot", ".jpg");
@@ -904,65 +921,19 @@ bool PGFrameListener::keyPressed(const OIS::KeyEvent& evt)
 
 	if(editMode) {
 		//Toggle object to place
-		if (evt.key == OIS::KC_1)
+		if (evt.key >= OIS::KC_1 && evt.key <= OIS::KC_6)
 		{
-			objSpawnType = 1;
-			mSpawnObject->detachAllObjects();
-			mSpawnObject->attachObject(boxEntity);
-		}
-		else if (evt.key == OIS::KC_2)
-		{
-			objSpawnType = 2;
-			mSpawnObject->detachAllObjects();
-			mSpawnObject->attachObject(coconutEntity);
-		}
-		else if (evt.key == OIS::KC_3)
-		{
-			objSpawnType = 3;
-			mSpawnObject->detachAllObjects();
-			mSpawnObject->attachObject(targetEntity);
-		}
-		else if (evt.key == OIS::KC_4)
-		{
-			objSpawnType = 4;
-			mSpawnObject->detachAllObjects();
-			mSpawnObject->attachObject(blockEntity);
-		}
-		else if (evt.key == OIS::KC_5)
-		{
-			objSpawnType = 5;
-			mSpawnObject->detachAllObjects();
-			mSpawnObject->attachObject(palm1Entity);
-		}
-		else if (evt.key == OIS::KC_6)
-		{
-			objSpawnType = 6;
-			mSpawnObject->detachAllObjects();
-			mSpawnObject->attachObject(palm2Entity);
+			selectSpawnType(evt.key - OIS::KC_1 + 1);
 		}
 		else if (evt.key == OIS::KC_7) // Press 7 multiple times to toggle coloured blocks
 		{
 			if (objSpawnType!=7 && objSpawnType!=8 && objSpawnType!=9)
 			{
-				objSpawnType=7;
-			} else if (objSpawnType==7)
-			{
-				objSpawnType = 8;
-			}
-			else if (objSpawnType==8)
-			{
-				objSpawnType = 9;
+				selectSpawnType(7);
 			}
-			else if (objSpawnType==9)
-			{
-				objSpawnType = 7;
-			}
-			mSpawnObject->detachAllObjects();
-			switch (objSpawnType)
+			else
 			{
-				case 7: mSpawnObject->attachObject(orangeEntity); break;
-				case 8: mSpawnObject->attachObject(blueEntity); break;
-				default: mSpawnObject->attachObject(redEntity);
+				selectSpawnType((objSpawnType == 9) ? 7 : objSpawnType + 1);
 			}
 		}
 		else if(evt.key == OIS::KC_0) {
@@ -1093,36 +1064,52 @@ bool PGFrameListener::mousePressed( const OIS::MouseEvent &evt, OIS::MouseButton
 			//Gets mouse co-ordinates
 			rayTo = mCamera->getCameraToViewportRay (mousePos.d_x/mWindow->getWidth(), mousePos.d_y/mWindow->getHeight());
 
+			//Level objects are picked against their bounds in the entity index. Bullet's ray test is only needed for
+			//the terrain, fish and platform, which the index doesn't hold, so it stops at the picked object
+			Real rayLength = mCamera->getFarClipDistance();
+			Real pickDistance;
+			int picked = mEntities->getIndex(mEntities->pick(rayTo, rayLength, pickDistance));
+			if (picked >= 0)
+				rayLength = pickDistance;
+
 			if(mCollisionClosestRayResultCallback != NULL) {
 				delete mCollisionClosestRayResultCallback;
 			}
 
-			mCollisionClosestRayResultCallback = new OgreBulletCollisions::CollisionClosestRayResultCallback(rayTo, mWorld, mCamera->getFarClipDistance());
+			mCollisionClosestRayResultCallback = new OgreBulletCollisions::CollisionClosestRayResultCallback(rayTo, mWorld, rayLength);
 			
 			//Fire ray towards mouse position
 			mWorld->launchRay (*mCollisionClosestRayResultCallback);
 
-			//If there was a collision, select the one nearest the player
+			//Something the index doesn't hold in front of the picked object is selected instead
+			Ogre::Vector3 hitPos;
 			if (mCollisionClosestRayResultCallback->doesCollide ())
 			{
-				std::cout << "Collision found" << std::endl;
 				body = static_cast <OgreBulletDynamics::RigidBody *> 
 					(mCollisionClosestRayResultCallback->getCollidedObject());
-				pickPos = body->getCenterOfMassPosition();//mCollisionClosestRayResultCallback->getCollisionPoint ();
+				hitPos = mCollisionClosestRayResultCallback->getCollisionPoint ();
+			}
+			else if (picked >= 0)
+			{
+				body = mEntities->getBody(picked);
+				hitPos = rayTo.getPoint(pickDistance);
+			}
+
+			//If there was a collision, select the one nearest the player
+			if (body != NULL)
+			{
+				std::cout << "Collision found" << std::endl;
+				pickPos = body->getCenterOfMassPosition();
 
 				//spawn Coconut if body is a tree
-				if (body->getBulletRigidBody()->getFriction()==0.5f)
+				if (isPalmNearPlayer(body, 200))
 				{
-					if(Vector3(playerNode->getPosition().x,0,playerNode->getPosition().z).distance(Vector3(pickPos.x,0,pickPos.z))<200)
-					{
-						std::cout << "spawning coconut" << std::endl;
-						spawnBox(Vector3(playerNode->getPosition().x,playerNode->getPosition().y+80,playerNode->getPosition().z));
-					}
-					
+					std::cout << "spawning coconut" << std::endl;
+					spawnBox(Vector3(playerNode->getPosition().x,playerNode->getPosition().y+80,playerNode->getPosition().z));
 				}
 		
 				if (body->getBulletRigidBody()->getFriction() == 0.12f)
-					platformContact = mCollisionClosestRayResultCallback->getCollisionPoint ();
+					platformContact = hitPos;
 
 				std::cout << body->getName() << std::endl;
 				cout << body->getBulletRigidBody()->getFriction() << endl;
@@ -1252,34 +1239,27 @@ inline std::string to_string (const T& t)
 	return ss.str();
 }
 
+//Switches the object placed in edit mode and shows its preview
+void PGFrameListener::selectSpawnType(int objectType) {
+	objSpawnType = objectType;
+	mSpawnObject->detachAllObjects();
+	if (objectType > 0 && objectType < (int) mSpawnPreviews.size() && mSpawnPreviews[objectType])
+		mSpawnObject->attachObject(mSpawnPreviews[objectType]);
+}
+
 //Places an object in the environment in edit mode
 void PGFrameListener::placeNewObject(int objectType) {
-	std::string name;
-	std::string mesh;
+	const Archetype* archetype = mArchetypes->getEditorArchetype(objectType);
+	if (!archetype)
+		archetype = &mArchetypes->findByName("Crate");
+
 	Vector3 position = mSpawnLocation;//(mCamera->getDerivedPosition() + mCamera->getDerivedDirection().normalisedCopy() * 100);
 	Quaternion orientation = mSpawnObject->getOrientation();
 	Vector3 scale = mSpawnObject->getScale();
-	float mass;
-	double friction;
-
-	//change properties depending on object type
-	switch(objectType)
-	{
-		case 1: name = "Crate"; mesh = "Crate.mesh"; mass = 0; friction = 0.9; break;
-		case 2: name = "Coconut"; mesh = "Coco.mesh"; mass = 0; friction = 0.92;break;
-		case 3: name = "Target"; mesh = "Target.mesh"; mass = 0; friction = 0.93; break;
-		case 4: name = "DynBlock"; mesh = "Jenga.mesh"; mass = 0; friction = 0.6; break;
-		case 5: name = "Palm"; mesh = "Palm1.mesh"; mass = 0; friction = 0.5; break;
-		case 6: name = "Palm"; mesh = "Palm2.mesh"; mass = 0; friction = 0.5; break;
-		case 7: name = "Orange"; mesh = "Jenga.mesh"; mass = 0; friction = 0.7; break;
-		case 8: name = "Blue"; mesh = "Jenga.mesh"; mass = 0; friction = 0.71; break;
-		case 9: name = "Red"; mesh = "Jenga.mesh"; mass = 0; friction = 0.72; break;
-		default: name = "Crate"; mesh = "Crate.mesh"; mass = 0; break;
-	}
 	
 	std::string object[24];
-	object[0] = name;
-	object[1] = mesh;
+	object[0] = archetype->name;
+	object[1] = archetype->mesh;
 	object[2] = to_string(position.x);
 	object[3] = to_string(position.y);
 	object[4] = to_string(position.z);
@@ -1291,8 +1271,8 @@ void PGFrameListener::placeNewObject(int objectType) {
 	object[10] = to_string(scale.y);
 	object[11] = to_string(scale.z);
 	object[12] = "0.1"; //Restitution
-	object[13] = to_string(friction); //Friction
-	object[14] = to_string(mass);
+	object[13] = to_string(archetype->friction); //Friction
+	object[14] = to_string(archetype->mass);
 	object[15] = "0"; //is animated?
 	object[16] = "0"; //movement in x
 	object[17] = "0"; //movement in y
@@ -1303,27 +1283,16 @@ void PGFrameListener::placeNewObject(int objectType) {
 	object[22] = "0"; //rotation in z
 	object[23] = "0"; //has billboard?
 
-	EnvironmentObject* newObject = new EnvironmentObject(this, mWorld, mNumEntitiesInstanced, mSceneMgr, object);
+	EnvironmentObject* newObject = new EnvironmentObject(this, mWorld, mSceneMgr, *archetype, object);
+	mEditorJournal->addObject(object, 24, newObject->getBody());
 		
 	//We want our collision callback function to work with all level objects
 	newObject->getBody()->getBulletRigidBody()->setCollisionFlags(playerBody->getBulletRigidBody()->getCollisionFlags()  | btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
+	if (archetype->editorFriction >= 0)
+		newObject->getBody()->getBulletRigidBody()->setFriction(archetype->editorFriction);
 
-	//Store object in correct location
-	switch(objectType)
-	{
-		case 1: newObject->getBody()->getBulletRigidBody()->setFriction(0.91f); levelBodies.push_back(newObject); break;
-		case 2: newObject->getBody()->getBulletRigidBody()->setFriction(0.92f); levelCoconuts.push_back(newObject); break;
-		case 3: newObject->getBody()->getBulletRigidBody()->setFriction(0.93f); levelTargets.push_back(newObject); break;
-		case 4: newObject->getBody()->getBulletRigidBody()->setFriction(0.80f); levelBlocks.push_back(newObject); break;
-		case 5: newObject->getBody()->getBulletRigidBody()->setFriction(0.5f); levelPalms.push_back(newObject); break;
-		case 6: newObject->getBody()->getBulletRigidBody()->setFriction(0.5f); levelPalms.push_back(newObject); break;
-		case 7: newObject->getBody()->getBulletRigidBody()->setFriction(0.70f); levelOrange.push_back(newObject); break;
-		case 8: newObject->getBody()->getBulletRigidBody()->setFriction(0.71f); levelBlue.push_back(newObject); break;
-		case 9: newObject->getBody()->getBulletRigidBody()->setFriction(0.72f); levelRed.push_back(newObject); break;
-		default: levelBodies.push_back(newObject);
-	}
 	mBodies.push_back(newObject->getBody());
-	mNumEntitiesInstanced++;
+	loadLevelObjects(newObject, *archetype);
 }
 
 
@@ -1355,6 +1324,10 @@ bool PGFrameListener::frameRenderingQueued(const Ogre::FrameEvent& evt)
 
 	if (mShutDown)
 		return false;
+
+	mEditorJournal->update(evt.timeSinceLastFrame);
+	//The HUD is only shown while the world is being played, not behind any menu or loading screen
+	mShowHUD = false;
 	
 	if(mMenus->mLevel1AimsOpen) {
 		mMenus->loadLevel1Aims();
@@ -1365,6 +1338,8 @@ bool PGFrameListener::frameRenderingQueued(const Ogre::FrameEvent& evt)
 	else if(mMenus->mLevelCompleteOpen) {
 		CEGUI::System::getSingleton().setGUISheet(mMenus->level1CompleteRoot);
 		mMenus->level1CompleteRoot->setVisible(true);
+		//Load the next level's assets a little at a time while the player reads their score
+		mLevelPrefetcher->update(PREFETCH_BUDGET_MS);
 	}
 	else if(mMenus->mLevelFailedOpen) {
 		CEGUI::System::getSingleton().setGUISheet(mMenus->levelFailedRoot);
@@ -1386,13 +1361,14 @@ bool PGFrameListener::frameRenderingQueued(const Ogre::FrameEvent& evt)
 		mMenus->mInLoadingScreen = false;
 		CEGUI::MouseCursor::getSingleton().setVisible(true);
 		if(editMode) {
-			clearTargets(levelBodies);
-			clearTargets(levelCoconuts);
-			clearTargets(levelBlocks);
-			clearTargets(levelTargets);
-			clearTargets(levelPalms);
-			levelPalmAnims.clear();
+			mVegetation->clear();
+			mPropBatcher->clear();
+			mImpostors->clear();
+			mEntities->clear();
+			mGameEvents->clear();
+			mObjectives->reset();
 			currentLevel = 0;
+			mEditorJournal->begin(editingLevel);
 		}
 	}
 	else if(mMenus->mMainMenu) {
@@ -1422,12 +1398,15 @@ bool PGFrameListener::frameRenderingQueued(const Ogre::FrameEvent& evt)
 		} 
 		//Else, update the world
 		else {
+			mShowHUD = true;
 			worldUpdates(evt); // Cam, caelum etc.
-			checkObjectsForRemoval(); //Targets and coconuts
+			mGameEvents->dispatch(); //Coconuts, targets and blocks hit since last frame
 			mMenus->loadingScreenRoot->setVisible(false);
-			checkLevelEndCondition();
+			if (mCheckLevelEnd)
+				checkLevelEndCondition();
 		}
 	}
+	mHUD->setVisible(mShowHUD);
     //Need to capture/update each device
     mKeyboard->capture();
     mMouse->capture();
@@ -1440,12 +1419,22 @@ void PGFrameListener::worldUpdates(const Ogre::FrameEvent& evt)
 {	
 	if (currentLevel == 2)
 		moveJengaPlatform(evt.timeSinceLastFrame);
-
-	//Palm animations
-	animatePalms(evt);
+	//Keep object bounds up to date for proximity queries
+	mEntities->updateSpatialIndex();
+	//Objectives on lifting objects follow the bodies as they move
+	if (!levelComplete && mObjectives->checkHeights(*mEntities))
+		mCheckLevelEnd = true;
+
+	//Distant palms and props are swapped for billboards
+	mImpostors->update(mCamera);
+	mVegetation->update();
+	//Props the physics has woken or put back to sleep move in or out of the static geometry
+	mPropBatcher->update();
 
 	//Move the fish
 	moveFish(evt.timeSinceLastFrame);
+	mFishRenderer->update();
+	updateFishStats();
 
 	//Gun animations and particles
 	if (shotGun)
@@ -1464,19 +1453,8 @@ void PGFrameListener::worldUpdates(const Ogre::FrameEvent& evt)
 	else
 		gunAnimate->addTime(-evt.timeSinceLastFrame * 1.5);
 
-	Ogre::Vector3 camPosition = mCamera->getPosition();
-	Ogre::Quaternion camOr = mCamera->getOrientation();
-
-	mCamera->setFOVy(Degree(90));
-
-	//Move targets
-	for (unsigned int i = 0; i < 6; i++)
-		mTargets[i]->update();
-
-	//Update camera
-	mCamera->setFOVy(Degree(45));
-	mCamera->setPosition(camPosition);
-	mCamera->setOrientation(camOr);
+	//Gun reflection, only the cube faces that are out of date
+	mGunReflection->update(evt.timeSinceLastFrame);
 
 	Real pitch = mCamera->getOrientation().getPitch(false).valueRadians();
 	
@@ -1498,9 +1476,11 @@ void PGFrameListener::worldUpdates(const Ogre::FrameEvent& evt)
 	}
 
 	//Floating crates
-	for (int i = 0; i < levelBodies.size(); i++)
+	for (int i = 0; i < mEntities->getCount(); i++)
 	{
-		OgreBulletDynamics::RigidBody *body = levelBodies.at(i)->getBody();
+		if (mEntities->getType(i) != EntityStore::ENTITY_CRATE)
+			continue;
+		OgreBulletDynamics::RigidBody *body = mEntities->getBody(i);
 		if (body->getWorldPosition().y < 90)
 			body->getBulletRigidBody()->setDamping(0.25, 0.1);
 		else
@@ -1527,11 +1507,11 @@ void PGFrameListener::worldUpdates(const Ogre::FrameEvent& evt)
 				body->getLinearVelocity().z);
 		}
 	}
-	for (int i = 0; i < NUM_FISH; i++)
+	for (int i = 0; i < mFishNumber; i++)
 	{
-		if (mFishDead[i])
+		if (mFish[i].dead)
 		{
-			OgreBulletDynamics::RigidBody *body = mFish[i];
+			OgreBulletDynamics::RigidBody *body = mFish[i].deadBody;
 			if (body->getWorldPosition().y < 92)
 				body->getBulletRigidBody()->setDamping(0.25, 0.1);
 			else
@@ -1549,76 +1529,111 @@ void PGFrameListener::worldUpdates(const Ogre::FrameEvent& evt)
 //Move animated objects around world
 void PGFrameListener::moveTargets(double evtTime){
 	spinTime += evtTime;
+	mEntities->moveAnimated(spinTime, evtTime);
+}
 
-	auto objectIt = levelBodies.begin();
-	while(objectIt != levelBodies.end()) {
-		EnvironmentObject *object = *objectIt;
-		if(object->mAnimated) {
-			object->move(spinTime, evtTime);
-		}
-		objectIt++;
-	}
+//Whether a body is one of the palms within range of the player
+bool PGFrameListener::isPalmNearPlayer(OgreBulletDynamics::RigidBody* body, Real range)
+{
+	mNearbyEntities.clear();
+	mEntities->findInRadius(playerNode->getPosition(), range, mNearbyEntities);
 
-	objectIt = levelCoconuts.begin();
-	while(objectIt != levelCoconuts.end()) {
-		EnvironmentObject *object = *objectIt;
-		if(object->mAnimated) {
-			object->move(spinTime, evtTime);
-		}
-		objectIt++;
-	}
-	objectIt = levelTargets.begin();
-	while(objectIt != levelTargets.end()) {
-		EnvironmentObject *object = *objectIt;
-		if(object->mAnimated) {
-			object->move(spinTime, evtTime);
-		}
-		objectIt++;
+	for (unsigned int i = 0; i < mNearbyEntities.size(); i++)
+	{
+		int index = mEntities->getIndex(mNearbyEntities[i]);
+		if (index >= 0 && mEntities->getType(index) == EntityStore::ENTITY_PALM && mEntities->getBody(index) == body)
+			return true;
 	}
-	objectIt = levelBlocks.begin();
-	while(objectIt != levelBlocks.end()) {
-		EnvironmentObject *object = *objectIt;
-		if(object->mAnimated) {
-			object->move(spinTime, evtTime);
-		}
-		objectIt++;
+	return false;
+}
+
+//Routes events from the collision callback to the level object they happened to
+void PGFrameListener::gameEvent(const GameEvents::Event &event)
+{
+	int index = mEntities->getIndex(mEntities->findByBody(event.body));
+	if (index < 0)
+		return;
+
+	switch (event.type)
+	{
+	case GameEvents::EVENT_COCONUT_COLLECTED:
+		collectCoconut(index);
+		break;
+	case GameEvents::EVENT_TARGET_HIT:
+		scoreTarget(index);
+		break;
+	case GameEvents::EVENT_BLOCK_GROUNDED:
+	case GameEvents::EVENT_RED_HIT:
+		scoreBlock(index);
+		break;
+	default:
+		break;
 	}
 }
 
-//Update palm animations
-void PGFrameListener::animatePalms(const Ogre::FrameEvent& evt) {
-	for (int i = 0; i < levelPalmAnims.size(); i++) {
-		levelPalmAnims.at(i)->setLoop(true);
-		levelPalmAnims.at(i)->setEnabled(true);
-		levelPalmAnims.at(i)->addTime(evt.timeSinceLastFrame);
+//Removes a collectable coconut the player has touched and updates coconutCount
+void PGFrameListener::collectCoconut(int index)
+{
+	if (mEntities->getType(index) != EntityStore::ENTITY_COCONUT)
+		return;
+	OgreBulletDynamics::RigidBody* currentBody = mEntities->getBody(index);
+
+	currentBody->getBulletRigidBody()->setFriction(0.941f);
+	// animation could be started here.
+	currentBody->getSceneNode()->detachAllObjects(); //removes the visible coconut
+	currentBody->getBulletCollisionWorld()->removeCollisionObject(currentBody->getBulletRigidBody()); // Removes the physics box
+
+	++coconutCount;
+	mHUD->setNumber(mHUDCoconuts, "Coconuts: ", coconutCount);
+	levelScore += 500;
+	mHUD->setNumber(mHUDScore, "Score: ", levelScore);
+	std::cout << "Coconut get!:\tTotal: " << coconutCount << std::endl;
+
+	if (mObjectives->isTracked(EntityStore::ENTITY_COCONUT))
+	{
+		mObjectives->recordHit(EntityStore::ENTITY_COCONUT);
+		mCheckLevelEnd = true;
 	}
 }
 
-//Here we check the status of collectable coconuts, and remove if necessary and update coconutCount
-void PGFrameListener::checkObjectsForRemoval() {
- 	std::deque<EnvironmentObject *>::iterator itLevelCoconuts = levelCoconuts.begin();
- 	while (levelCoconuts.end() != itLevelCoconuts)
- 	{   
-		EnvironmentObject *object = *itLevelCoconuts;
-		OgreBulletDynamics::RigidBody* currentBody = object->getBody();
-		
-		if(currentBody->getBulletRigidBody()->getFriction()==0.94f)
-		{
-			currentBody->getBulletRigidBody()->setFriction(0.941f);
-			// animation could be started here.
-			currentBody->getSceneNode()->detachAllObjects(); //removes the visible coconut
-			currentBody->getBulletCollisionWorld()->removeCollisionObject(currentBody->getBulletRigidBody()); // Removes the physics box
-
-			++coconutCount;
-			String text = String("Coconuts: "+ (StringConverter::toString(coconutCount)));
-			HUDCoconutText->setCaption(text);
-			levelScore += 500;
-			text = String("Score: "+ (StringConverter::toString(levelScore)));
-			HUDScoreText->setCaption(text);
-			std::cout << "Coconut get!:\tTotal: " << coconutCount << std::endl;
-		}
-		++itLevelCoconuts;
- 	}
+//Scores a target hit on levels with target objectives, the restitution set by the collision callback holds how close the shot was
+void PGFrameListener::scoreTarget(int index)
+{
+	if (levelComplete || mEntities->getType(index) != EntityStore::ENTITY_TARGET || mEntities->isCounted(index)
+		|| !mObjectives->isTracked(EntityStore::ENTITY_TARGET))
+		return;
+
+	//update score
+	levelScore += (mEntities->getBody(index)->getBulletRigidBody()->getRestitution() * 10000);
+	std::cout << "Score: " << levelScore << std::endl;
+	mEntities->setCounted(index);
+	targetCount++;
+	mHUD->setNumber(mHUDTargets, "Targets hit: ", targetCount);
+	mHUD->setNumber(mHUDScore, "Score: ", levelScore);
+	mObjectives->recordHit(EntityStore::ENTITY_TARGET);
+	mCheckLevelEnd = true;
+}
+
+//Counts a grounded or hit block towards the level's objectives, knocked down orange blocks score points
+void PGFrameListener::scoreBlock(int index)
+{
+	EntityStore::EntityType type = mEntities->getType(index);
+	if (levelComplete || mEntities->isCounted(index) || !mObjectives->isTracked(type))
+		return;
+
+	mEntities->setCounted(index);
+	if (type == EntityStore::ENTITY_ORANGE)
+	{
+		//update score
+		levelScore += 1000;
+	}
+	else if (type == EntityStore::ENTITY_BLUE)
+		std::cout << "Blue block hit ground" << std::endl;
+	else if (type == EntityStore::ENTITY_RED)
+		std::cout << "Red block hit by coconut" << std::endl;
+
+	mObjectives->recordHit(type);
+	mCheckLevelEnd = true;
 }
 
 //Deals with window resizing events
@@ -1732,10 +1747,9 @@ void PGFrameListener::spawnBox(Vector3 spawnPosition)
 	Vector3 scale = mSpawnObject->getScale();
 
   	// create an ordinary, Ogre mesh with texture
- 	Entity *entity = mSceneMgr->createEntity(
- 			"Coconut" + StringConverter::toString(mNumEntitiesInstanced),
- 			"Coco.mesh");			    
+ 	Entity *entity = mSceneMgr->createEntity("Coco.mesh");			    
  	entity->setCastShadows(true);
+	entity->removeVisibilityFlags(VISIBLE_IN_REFLECTION);
 	
  	// we need the bounding box of the box to be able to set the size of the Bullet-box
  	AxisAlignedBox boundingB = entity->getBoundingBox();
@@ -1759,9 +1773,7 @@ void PGFrameListener::spawnBox(Vector3 spawnPosition)
  	// after that create the Bullet shape with the calculated size
  	OgreBulletCollisions::CollisionShape *sceneSphereShape = new OgreBulletCollisions::SphereCollisionShape(biggestSize);
  	// and the Bullet rigid body
- 	OgreBulletDynamics::RigidBody *defaultBody = new OgreBulletDynamics::RigidBody(
- 			"defaultBoxRigid" + StringConverter::toString(mNumEntitiesInstanced), 
- 			mWorld);
+ 	OgreBulletDynamics::RigidBody *defaultBody = new OgreBulletDynamics::RigidBody(bodyNames.generate(), mWorld);
  	defaultBody->setShape(	node,
  				sceneSphereShape,
  				0.6f,			// dynamic body restitution
@@ -1781,207 +1793,334 @@ void PGFrameListener::spawnBox(Vector3 spawnPosition)
  	//mBodies.push_back(defaultBody);
 }
 
-//Spawns each level's fish
+//Spawns each level's fish, reusing the fish left over from the last level
 void PGFrameListener::spawnFish(void)
 {
-	if (currentLevel == 1)
-		mFishNumber = NUM_FISH;
-	else if (currentLevel == 2)
-		mFishNumber = NUM_FISH / 3;
-	else
-		mFishNumber = 0;
+	FishSchool::loadSchools("../../res/Levels/" + getLevelDescriptor(currentLevel).mFishFile, mFishSchools);
 
+	mFishNumber = 0;
+	for (unsigned int s = 0; s < mFishSchools.size(); s++)
+	{
+		mFishSchools[s].alive = mFishSchools[s].count;
+		mFishNumber += mFishSchools[s].count;
+	}
 	mFishAlive = mFishNumber;
 
-	Vector3 size = Vector3::ZERO;	// size of the fish
-	Vector3 position;
-	for(int i=0; i<mFishNumber; i++) { 
-		if (currentLevel == 1)
-			position = Vector3(1490+i*rand()%mFishNumber, 70, 1500+i*rand()%mFishNumber);
-		else if (currentLevel == 2)
-			position = Vector3(1050+i*rand()%mFishNumber, 70, 849+i*rand()%mFishNumber);
-
-		// create an ordinary, Ogre mesh with texture
- 		Entity *entity = mSceneMgr->createEntity("Fish" + StringConverter::toString(i), "angelFish.mesh");			    
- 		entity->setCastShadows(true);
-
-		// we need the bounding box of the box to be able to set the size of the Bullet-box
- 		AxisAlignedBox boundingB = entity->getBoundingBox();
- 		size = boundingB.getSize(); 
-		size /= 2.0f; // only the half needed
- 		size *= 0.95f;	// Bullet margin is a bit bigger so we need a smaller size
-		size *= 2.2;
-
-		float biggestSize = 0;
-		if (size.x > biggestSize)
-			biggestSize = size.x;
-		if (size.y > biggestSize)
-			biggestSize = size.y;
-		if (size.z > biggestSize)
-			biggestSize = size.z;
-
-		SceneNode *node = mSceneMgr->getRootSceneNode()->createChildSceneNode("FishParent" + StringConverter::toString(i));
-		SceneNode *node2 = mSceneMgr->getRootSceneNode()->createChildSceneNode("Fish" + StringConverter::toString(i));
-		node2->setScale(2.6, 2.6, 2.6);
-
-		if (i % 3 == 0)
-			entity->setMaterialName("FishMaterialBlue");
-
-		node2->attachObject(entity);
-
-		// after that create the Bullet shape with the calculated size
- 		OgreBulletCollisions::SphereCollisionShape *sceneBoxShape = new OgreBulletCollisions::SphereCollisionShape(biggestSize);
- 		// and the Bullet rigid body
- 		OgreBulletDynamics::RigidBody *defaultBody = new OgreBulletDynamics::RigidBody(
- 				"FishBody" + StringConverter::toString(i), mWorld);
- 		defaultBody->setShape(	node,
- 					sceneBoxShape,
- 					0.6f,			// dynamic body restitution
- 					0.0f,			// dynamic body friction
- 					5.0f, 			// dynamic bodymass
- 					position,		// starting position of the box
- 					Quaternion(0,0,0,1));// orientation of the box
- 		mNumEntitiesInstanced++;				
+	// the school's heading has its own random stream, each fish gets another
+	mLevelSeed = BASE_LEVEL_SEED + currentLevel;
+	mSchoolRandom.reseed(mLevelSeed, SCHOOL_RANDOM_STREAM);
+	mSchoolHeadingTime = 0;
+	mFishClock = 0;
+	mSchoolRandomMove = false;
+	mSchoolRandomPosition = Vector3(0, 50, 0);
+
+	// only grow the pool, fish left over from bigger levels are parked below
+	if ((int) mFish.size() < mFishNumber)
+		mFish.resize(mFishNumber);
+
+	std::vector<FishRenderer::Variant> variants;
+	variants.reserve(mFishNumber);
+
+	int i = 0;
+	for (unsigned int s = 0; s < mFishSchools.size(); s++)
+	{
+		const FishSchool &school = mFishSchools[s];
+		for (int k = 0; k < school.count; k++, i++)
+		{
+			Fish &fish = mFish[i];
+			fish.school = s;
+			fish.variant = school.getVariant(k);
+			fish.random.reseed(mLevelSeed, i);
+			variants.push_back(fish.variant);
+
+			int spread = (int) school.spawnSpread;
+			Vector3 position = school.spawnCentre + Vector3(fish.random.nextInt(spread), 0, fish.random.nextInt(spread));
 
-		// Counteract the gravity
-		defaultBody->getBulletRigidBody()->setGravity(btVector3(0, 0, 0));
- 		mShapes.push_back(sceneBoxShape);
- 		mBodies.push_back(defaultBody);
-		defaultBody->setLinearVelocity(0.5, -0.2, 0.5);
-		mFish[i] = defaultBody;
-		mFishNodes[i] = node2;
-		mFishEnts[i] = entity;
-		mFishAnim[i] = mFishEnts[i]->getAnimationState("Act: ArmatureAction.001");
-		mFishAnim[i]->setLoop(true);
-		mFishAnim[i]->setEnabled(true);
+			if (fish.body)
+				resetFish(fish, position);
+			else
+				createFish(i, position);
+
+			fish.active = true;
+			fish.dead = false;
+			fish.lastMove = 0;
+			fish.lastDirection = Vector3(1, -0.2, 1);
+		}
 	}
+	for (; i < (int) mFish.size(); i++)
+		parkFish(mFish[i]);
+
+	// the fish are drawn in a few instanced batches rather than one entity each
+	mFishRenderer->build(variants);
+	mFishScheduler->reset(mFishNumber);
+	mFishPositions.assign(mFishNumber, Vector3::ZERO);
+	mFishActive.assign(mFishNumber, true);
+
+	for (i = 0; i < mFishNumber; i++)
+		mFishRenderer->setTransform(i, mFish[i].node->getPosition(), mFish[i].node->getOrientation());
 }
 
-//Swaps out fish depending on level
-void PGFrameListener::changeLevelFish()
+//Creates the nodes and physics body for a new fish in the pool
+void PGFrameListener::createFish(int i, const Vector3 &position)
 {
-	for(int i=0; i<mFishNumber; i++)
+	Fish &fish = mFish[i];
+
+	// we need the bounding box of the fish to be able to set the size of the Bullet sphere
+	Vector3 size = mFishRenderer->getFishBounds().getSize();
+	size /= 2.0f; // only the half needed
+	size *= 0.95f;	// Bullet margin is a bit bigger so we need a smaller size
+	size *= 2.2;
+
+	float biggestSize = 0;
+	if (size.x > biggestSize)
+		biggestSize = size.x;
+	if (size.y > biggestSize)
+		biggestSize = size.y;
+	if (size.z > biggestSize)
+		biggestSize = size.z;
+
+	SceneNode *node = mSceneMgr->getRootSceneNode()->createChildSceneNode();
+	// orientation of the drawn fish, copied to its instance every frame
+	fish.node = mSceneMgr->getRootSceneNode()->createChildSceneNode();
+	fish.node->setPosition(position);
+
+	// after that create the Bullet shape with the calculated size
+	OgreBulletCollisions::SphereCollisionShape *sceneBoxShape = new OgreBulletCollisions::SphereCollisionShape(biggestSize);
+	// and the Bullet rigid body
+	fish.body = new OgreBulletDynamics::RigidBody(bodyNames.generate(), mWorld);
+	fish.body->setShape(	node,
+				sceneBoxShape,
+				0.6f,			// dynamic body restitution
+				0.0f,			// dynamic body friction
+				5.0f, 			// dynamic bodymass
+				position,		// starting position of the box
+				Quaternion(0,0,0,1));// orientation of the box
+	mNumEntitiesInstanced++;				
+	fish.bodyInWorld = true;
+
+	// Counteract the gravity
+	fish.body->getBulletRigidBody()->setGravity(btVector3(0, 0, 0));
+	mShapes.push_back(sceneBoxShape);
+	mBodies.push_back(fish.body);
+	fish.body->setLinearVelocity(0.5, -0.2, 0.5);
+}
+
+//Puts a pooled fish back in the water, alive, at a new position
+void PGFrameListener::resetFish(Fish &fish, const Vector3 &position)
+{
+	parkFish(fish);
+
+	btTransform transform = fish.body->getCenterOfMassTransform();
+	transform.setOrigin(btVector3(position.x, position.y, position.z));
+	fish.body->getBulletRigidBody()->setCenterOfMassTransform(transform);
+	fish.body->getSceneNode()->setPosition(position);
+	fish.node->setPosition(position);
+
+	mWorld->getBulletDynamicsWorld()->addRigidBody(fish.body->getBulletRigidBody());
+	fish.bodyInWorld = true;
+	fish.body->setLinearVelocity(0.5, -0.2, 0.5);
+}
+
+//Takes a pooled fish out of the physics world until a level needs it again
+void PGFrameListener::parkFish(Fish &fish)
+{
+	if (fish.deadBody && mPickedBody == fish.deadBody)
 	{
-		mWorld->getBulletDynamicsWorld()->removeRigidBody(mFish[i]->getBulletRigidBody());
-		mSceneMgr->destroyEntity("Fish" + StringConverter::toString(i));
-		mSceneMgr->destroySceneNode("Fish" + StringConverter::toString(i));
-		mSceneMgr->destroySceneNode("FishParent" + StringConverter::toString(i));
-		mSceneMgr->destroySceneNode("FishBody" + StringConverter::toString(i) + "Node");
+		mWorld->removeConstraint(mPickConstraint);
+		delete mPickConstraint;
+		mPickConstraint = NULL;
+		mPickedBody = NULL;
+	}
+	if (fish.bodyInWorld)
+	{
+		mWorld->getBulletDynamicsWorld()->removeRigidBody(fish.body->getBulletRigidBody());
+		fish.bodyInWorld = false;
+	}
+	if (fish.deadBodyInWorld)
+	{
+		mWorld->getBulletDynamicsWorld()->removeRigidBody(fish.deadBody->getBulletRigidBody());
+		fish.deadBodyInWorld = false;
+	}
+	if (fish.deadNode)
+		fish.deadNode->setVisible(false);
 
-		if (mFishDead[i])
-		{
-			mSceneMgr->destroyEntity("FishDead" + StringConverter::toString(i));
-			mSceneMgr->destroySceneNode(mFishNodes[i]);
-			mSceneMgr->destroySceneNode("DeadFishBody" + StringConverter::toString(i) + "Node");
-		}
+	fish.active = false;
+	fish.dead = false;
+}
+
+//Swaps a fish that has been pulled out of the water for a flat, dead one held by the gun
+void PGFrameListener::killFish(int i)
+{
+	Fish &fish = mFish[i];
+	fish.dead = true;
+	mFishAlive -= 1;
+	mFishSchools[fish.school].alive -= 1;
+
+	mFishRenderer->setVisible(i, false);
+	Quaternion temp = fish.node->getOrientation();
+	Vector3	   tempPos = fish.node->getPosition();
 
-		mFishDead[i] = false;
+	bool firstDeath = (fish.deadBody == NULL);
+	if (firstDeath)
+	{
+		// Create new box shape for flat fish
+		Vector3 size = mFishRenderer->getFishBounds().getSize();	// size of the fish
+		size /= 2.0f; // only the half needed
+		size *= 0.95f;	// Bullet margin is a bit bigger so we need a smaller size
+		size *= 2.6;// after that create the Bullet shape with the calculated size
+		fish.deadShape = new OgreBulletCollisions::BoxCollisionShape(size);
+		fish.deadEntity = mSceneMgr->createEntity("angelFish.mesh");	
+		fish.deadEntity->removeVisibilityFlags(VISIBLE_IN_REFLECTION);
+		fish.deadNode = mSceneMgr->getRootSceneNode()->createChildSceneNode();
+		fish.deadNode->attachObject(fish.deadEntity);
+		fish.deadNode->setScale(2.6, 2.6, 2.6);
+		fish.deadBody = new OgreBulletDynamics::RigidBody(bodyNames.generate(), mWorld);
+		mShapes.push_back(fish.deadShape);
+		mBodies.push_back(fish.deadBody);
+	}
+	fish.deadEntity->setMaterialName(FishRenderer::getDeadMaterial(fish.variant));
+	fish.deadNode->setVisible(true);
+
+	//If fish is being held by gun
+	if(mPickedBody != NULL) 
+	{
+		mWorld->removeConstraint(mPickConstraint);
+		delete mPickConstraint;
+
+		mPickConstraint = NULL;
+		mPickedBody->forceActivationState();
+		mPickedBody->setDeactivationTime( 0.f );
+		mPickedBody = NULL;
 	}
 
+	// Remove unwanted sphere shape
+	fish.body->getBulletRigidBody()->setActivationState(DISABLE_DEACTIVATION);
+	btTransform transform = fish.body->getCenterOfMassTransform();
+	transform.setOrigin(btVector3(-10, 10, -10));
+	fish.body->getBulletRigidBody()->setCenterOfMassTransform(transform);
+	fish.body->setLinearVelocity(0, 0, 0);
+	btVector3 angVelocity = fish.body->getBulletRigidBody()->getAngularVelocity();
+
+	if (firstDeath)
+	{
+		// Assign new shape
+		fish.deadBody->setShape(	fish.deadNode,
+				fish.deadShape,
+				0.6f,			// dynamic body restitution
+				0.61f,			// dynamic body friction
+				5.0f, 			// dynamic bodymass
+				tempPos,		// starting position of the box
+				temp);			// orientation of the box
+	}
+	else
+	{
+		// Reuse the dead body from last time this fish died
+		btTransform deadTransform(btQuaternion(temp.x, temp.y, temp.z, temp.w), btVector3(tempPos.x, tempPos.y, tempPos.z));
+		fish.deadBody->getBulletRigidBody()->setCenterOfMassTransform(deadTransform);
+		fish.deadBody->setLinearVelocity(0, 0, 0);
+		fish.deadNode->setPosition(tempPos);
+		fish.deadNode->setOrientation(temp);
+		mWorld->getBulletDynamicsWorld()->addRigidBody(fish.deadBody->getBulletRigidBody());
+	}
+	fish.deadBodyInWorld = true;
+
+	mWorld->getBulletDynamicsWorld()->removeRigidBody(fish.body->getBulletRigidBody());
+	fish.bodyInWorld = false;
+
+	mWorld->stepSimulation(0.0000000001);	// update Bullet Physics animation	
+
+	// Create new constraint on dead fish
+	mPickedBody = fish.deadBody;
+	fish.deadBody->disableDeactivation();		
+	const Ogre::Vector3 localPivot (fish.deadBody->getCenterOfMassPivot(fish.deadBody->getCenterOfMassPosition()));
+	OgreBulletDynamics::PointToPointConstraint *p2pConstraint  = new OgreBulletDynamics::PointToPointConstraint(fish.deadBody, localPivot);
+	mWorld->addConstraint(p2pConstraint);					    
+	mOldPickingPos = fish.deadBody->getCenterOfMassPosition();
+	const Ogre::Vector3 eyePos(mCamera->getDerivedPosition());
+	mOldPickingDist  = (fish.deadBody->getCenterOfMassPosition() - eyePos).length();
+
+	//very weak constraint for picking
+	p2pConstraint->setTau (0.1f);
+	mPickConstraint = p2pConstraint;
+
+	fish.deadBody->getBulletRigidBody()->setAngularVelocity(angVelocity);
+}
+
+//Swaps out fish depending on level
+void PGFrameListener::changeLevelFish()
+{
 	spawnFish();
 }
 
+//Shows how many fish are in each update tier on the debug overlay
+void PGFrameListener::updateFishStats(void)
+{
+	if (!mStatsOn || !mDebugTextElement)
+		return;
+
+	mDebugText = "Fish near: " + StringConverter::toString(mFishScheduler->getTierCount(FishScheduler::TIER_NEAR))
+		+ "  mid: " + StringConverter::toString(mFishScheduler->getTierCount(FishScheduler::TIER_MID))
+		+ "  frozen: " + StringConverter::toString(mFishScheduler->getTierCount(FishScheduler::TIER_FAR));
+	mDebugTextElement->setCaption(mDebugText);
+}
+
 //Updates each fish's location using Boids algorithm
 void PGFrameListener::moveFish(double timeSinceLastFrame) 
 {
-	float currentTime = GetTickCount();
-	srand ( time(0) );
-	int randomGenerator = rand() % 100 + 1;
-	bool randomMove = false;
-	Vector3 randomPosition(0, 50, 0);
-	//Add some randomness
-	if (randomGenerator < 80)
+	//Fish timing runs off simulation time rather than the wall clock so runs can be reproduced
+	mFishClock += timeSinceLastFrame * 1000;
+	float currentTime = mFishClock;
+
+	//Add some randomness, the school picks a new random heading about once a second
+	mSchoolHeadingTime -= timeSinceLastFrame;
+	if (mSchoolHeadingTime <= 0)
 	{
-		randomMove = true;
-		randomPosition.x = rand() % 3000 + 1;
-		randomPosition.z = rand() % 3000 + 1;
-		randomPosition.normalise();
-		randomPosition -= 0.5;
+		mSchoolHeadingTime = 1.0f;
+		mSchoolRandomMove = (mSchoolRandom.nextInt(100) + 1 < 80);
+		mSchoolRandomPosition = Vector3(0, 50, 0);
+		if (mSchoolRandomMove)
+		{
+			mSchoolRandomPosition.x = mSchoolRandom.nextInt(3000) + 1;
+			mSchoolRandomPosition.z = mSchoolRandom.nextInt(3000) + 1;
+			mSchoolRandomPosition.normalise();
+			mSchoolRandomPosition -= 0.5;
+		}
+	}
+	bool randomMove = mSchoolRandomMove;
+	Vector3 randomPosition = mSchoolRandomPosition;
+
+	//Decide which fish get updated this frame
+	for(int i=0; i<mFishNumber; i++)
+	{
+		mFishPositions[i] = mFish[i].body->getWorldPosition();
+		mFishActive[i] = !mFish[i].dead;
 	}
+	mFishScheduler->schedule(mCamera, mFishPositions, mFishActive);
 
 	for(int i=0; i<mFishNumber; i++) 
 	{
-		if (mFishNodes[i]->getPosition().y > 120 && !mFishDead[i]) //If fish not dead
+		Fish &fish = mFish[i];
+		if (fish.node->getPosition().y > 120 && !fish.dead) //If fish not dead
 		{
-			mFishDead[i] = true;
-			mFishAlive -= 1;
-			
-			// Create new box shape for flat fish
-			Vector3 size = Vector3::ZERO;	// size of the fish
-			AxisAlignedBox boundingB = mSceneMgr->getEntity("Fish" + StringConverter::toString(i))->getBoundingBox();
- 			size = boundingB.getSize(); 
-			size /= 2.0f; // only the half needed
- 			size *= 0.95f;	// Bullet margin is a bit bigger so we need a smaller size
-			size *= 2.6;// after that create the Bullet shape with the calculated size
- 			OgreBulletCollisions::BoxCollisionShape *sceneBoxShape = new OgreBulletCollisions::BoxCollisionShape(size);
- 			Entity *entity = mSceneMgr->createEntity("FishDead" + StringConverter::toString(i), "angelFish.mesh");	
-			SceneNode *node = mSceneMgr->getRootSceneNode()->createChildSceneNode();
-			node->attachObject(entity);
-			node->setScale(2.6, 2.6, 2.6);
-			mFishNodes[i]->setVisible(false);
-			Quaternion temp = mFishNodes[i]->getOrientation();
-			Vector3	   tempPos = mFishNodes[i]->getPosition();
-			mFishNodes[i] = node;
-			OgreBulletDynamics::RigidBody *defaultBody = new OgreBulletDynamics::RigidBody(
- 				"DeadFishBody" + StringConverter::toString(i), mWorld);
-
-			//If fish is being held by gun
-			if(mPickedBody != NULL) 
-			{
-				mWorld->removeConstraint(mPickConstraint);
-				delete mPickConstraint;
+			killFish(i);
+		}
+		else if (!fish.dead) //Update fish positions
+		{
+			if (mFishScheduler->wasFrozen(i))
+				fish.body->setLinearVelocity(0, 0, 0);
 
-				mPickConstraint = NULL;
-				mPickedBody->forceActivationState();
-				mPickedBody->setDeactivationTime( 0.f );
-				mPickedBody = NULL;
+			if (!mFishScheduler->isUpdateFrame(i))
+			{
+				//Between updates mid-range fish carry on along their last heading
+				if (mFishScheduler->getTier(i) == FishScheduler::TIER_MID)
+				{
+					fish.node->setPosition(mFishPositions[i]);
+					mFishRenderer->setTransform(i, mFishPositions[i], fish.node->getOrientation());
+				}
+				continue;
 			}
 
-			// Remove unwanted sphere shape
-			mFish[i]->getBulletRigidBody()->setActivationState(DISABLE_DEACTIVATION);
-			btTransform transform = mFish[i]->getCenterOfMassTransform();
-			transform.setOrigin(btVector3(-10, 10, -10));
-			mFish[i] ->getBulletRigidBody()->setCenterOfMassTransform(transform);
-			mFish[i]->setLinearVelocity(0, 0, 0);
-			btVector3 angVelocity = mFish[i]->getBulletRigidBody()->getAngularVelocity();
-
-			// Assign new shape
-			defaultBody->setShape(	mFishNodes[i],
- 					sceneBoxShape,
- 					0.6f,			// dynamic body restitution
- 					0.61f,			// dynamic body friction
- 					5.0f, 			// dynamic bodymass
-					tempPos,		// starting position of the box
-					temp);			// orientation of the box
-
-			mWorld->getBulletDynamicsWorld()->removeRigidBody(mFish[i]->getBulletRigidBody());
-			mFish[i] = defaultBody;
-
-			mWorld->stepSimulation(0.0000000001);	// update Bullet Physics animation	
-
-			// Create new constraint on dead fish
-			mPickedBody = mFish[i];
-			mFish[i]->disableDeactivation();		
-			const Ogre::Vector3 localPivot (mFish[i]->getCenterOfMassPivot(mFish[i]->getCenterOfMassPosition()));
-			OgreBulletDynamics::PointToPointConstraint *p2pConstraint  = new OgreBulletDynamics::PointToPointConstraint(mFish[i], localPivot);
-			mWorld->addConstraint(p2pConstraint);					    
-			mOldPickingPos = mFish[i]->getCenterOfMassPosition();
-			const Ogre::Vector3 eyePos(mCamera->getDerivedPosition());
-			mOldPickingDist  = (mFish[i]->getCenterOfMassPosition() - eyePos).length();
-
-			//very weak constraint for picking
-			p2pConstraint->setTau (0.1f);
-			mPickConstraint = p2pConstraint;
-
-			if (i % 3 == 0)
-				mSceneMgr->getEntity("FishDead" + StringConverter::toString(i))->setMaterialName("FishMaterialBlueDead");
-			else
-				mSceneMgr->getEntity("FishDead" + StringConverter::toString(i))->setMaterialName("FishMaterialDead");
-
-			mFish[i]->getBulletRigidBody()->setAngularVelocity(angVelocity);
-		}
-		else if (!mFishDead[i]) //Update fish positions
-		{
+			const FishSchool &school = mFishSchools[fish.school];
 			Vector3 centreOfMass = Vector3(0, 0, 0);
 			Vector3 averageVelocity = Vector3(0, 0, 0);
 			Vector3 avoidCollision = Vector3(0, 0, 0);
@@ -1989,32 +2128,36 @@ void PGFrameListener::moveFish(double timeSinceLastFrame)
 			Vector3 avoidSurface = Vector3(0, 0, 0);
 			Vector3 avoidBorders = Vector3(0, 0, 0);
 			Vector3 randomVelocity = Vector3(0, 0, 0);
-			Vector3 mFishPosition = mFish[i]->getSceneNode()->getPosition();
+			Vector3 mFishPosition = fish.body->getSceneNode()->getPosition();
 
+			//Fish only flock with their own school
 			for(int j=0; j<mFishNumber; j++) 
 			{
-				if(i != j && !mFishDead[j]) 
+				if(i != j && !mFish[j].dead && mFish[j].school == fish.school) 
 				{
-					Vector3 jPosition = mFish[j]->getSceneNode()->getPosition();
+					Vector3 jPosition = mFish[j].body->getSceneNode()->getPosition();
 					Vector3 diffInPosition = jPosition-mFishPosition;
 					centreOfMass += jPosition;
 				
-					averageVelocity += mFish[j]->getLinearVelocity();
+					averageVelocity += mFish[j].body->getLinearVelocity();
 
-					if (diffInPosition.length() <= 20 && currentTime - mFishLastMove[i]  >400) // 18 for 30
+					if (diffInPosition.length() <= 20 && currentTime - fish.lastMove  >400) // 18 for 30
 					{
 						avoidCollision -= (diffInPosition)/1.5;
-						mFishLastMove[i] = currentTime;
+						fish.lastMove = currentTime;
 					}
 				}
 			}
 
-			centreOfMass = ((centreOfMass / (mFishAlive - 1)) - mFishPosition) / 50;
-			if ((centreOfMass * 50).length() > 150)
-				mFishLastMove[i] = currentTime;
+			if (school.alive > 1)
+			{
+				centreOfMass = ((centreOfMass / (school.alive - 1)) - mFishPosition) / 50;
+				if ((centreOfMass * 50).length() > 150)
+					fish.lastMove = currentTime;
 
-			averageVelocity = ((averageVelocity / (mFishAlive - 1)) - mFish[i]->getLinearVelocity()) / 10;
-			Vector3 worldPosition = mFish[i]->getWorldPosition();
+				averageVelocity = ((averageVelocity / (school.alive - 1)) - fish.body->getLinearVelocity()) / 10;
+			}
+			Vector3 worldPosition = fish.body->getWorldPosition();
 
 			//Set swimming boundaries for fish
 			if (worldPosition.y > 86)
@@ -2027,24 +2170,24 @@ void PGFrameListener::moveFish(double timeSinceLastFrame)
 				avoidSurface = Vector3(0, -(worldPosition.y - 80)*10, 0);
 				avoidCollision /= 4;
 			}
-			if (worldPosition.x > 3000)
+			if (worldPosition.x > school.maxX)
 			{
-				avoidBorders += Vector3(-(worldPosition.x - 3000)*2, 0, 0);
+				avoidBorders += Vector3(-(worldPosition.x - school.maxX)*2, 0, 0);
 				avoidCollision /= 4;
 			}
-			if (worldPosition.x < 0)
+			if (worldPosition.x < school.minX)
 			{
-				avoidBorders += Vector3(-(worldPosition.x)*2, 0, 0);
+				avoidBorders += Vector3(-(worldPosition.x - school.minX)*2, 0, 0);
 				avoidCollision /= 4;
 			}
-			if (worldPosition.z > 3000)
+			if (worldPosition.z > school.maxZ)
 			{
-				avoidBorders += Vector3(0, 0, -(worldPosition.z - 3000)*2);
+				avoidBorders += Vector3(0, 0, -(worldPosition.z - school.maxZ)*2);
 				avoidCollision /= 4;
 			}
-			if (worldPosition.z < 0)
+			if (worldPosition.z < school.minZ)
 			{
-				avoidBorders += Vector3(0, 0, -(worldPosition.z)*2);
+				avoidBorders += Vector3(0, 0, -(worldPosition.z - school.minZ)*2);
 				avoidCollision /= 4;
 			}
 			if (randomMove == true)
@@ -2061,28 +2204,28 @@ void PGFrameListener::moveFish(double timeSinceLastFrame)
 				avoidPlayer += (disFromPlayer)/25;
 
 			//Set new velocity
-			Vector3 finalVelocity = mFish[i]->getLinearVelocity() + (randomVelocity+centreOfMass+averageVelocity+avoidCollision+avoidSurface+avoidPlayer+avoidBorders);
+			Vector3 finalVelocity = fish.body->getLinearVelocity() + (randomVelocity+centreOfMass+averageVelocity+avoidCollision+avoidSurface+avoidPlayer+avoidBorders);
 			finalVelocity.normalise();
 
-			if (disFromPlayer.length() <= 165 && !(mFish[i]->getWorldPosition().y > 80))
+			if (disFromPlayer.length() <= 165 && !(fish.body->getWorldPosition().y > 80))
 				finalVelocity *= 50;
-			else if (currentTime - mFishLastMove[i]  < 400)
+			else if (currentTime - fish.lastMove  < 400)
 				finalVelocity *= 40;
-			else if (currentTime - mFishLastMove[i]  < 600)
-				finalVelocity *= 40 - ((currentTime - mFishLastMove[i] - 400) / 20);
+			else if (currentTime - fish.lastMove  < 600)
+				finalVelocity *= 40 - ((currentTime - fish.lastMove - 400) / 20);
 			else
 				finalVelocity *= 30;
 
 			//Apply updates
-			mFish[i]->setLinearVelocity(finalVelocity);
-			mFishNodes[i]->setPosition(worldPosition);
-			Vector3 localY = mFishNodes[i]->getOrientation() * Vector3::UNIT_Y;
+			fish.body->setLinearVelocity(finalVelocity);
+			fish.node->setPosition(worldPosition);
+			Vector3 localY = fish.node->getOrientation() * Vector3::UNIT_Y;
 			Quaternion quat = localY.getRotationTo(Vector3::UNIT_Y);                        
-			mFishNodes[i]->rotate(quat, Node::TS_WORLD);
-			mFishNodes[i]->lookAt(mFishNodes[i]->getPosition() + (finalVelocity * 20), Ogre::Node::TS_WORLD);
-			mFishNodes[i]->pitch(Degree(270));
-			mFishLastDirection[i] = finalVelocity + ((finalVelocity - mFishLastDirection[i]) / 2);
-			mFishAnim[i]->addTime(timeSinceLastFrame*5);
+			fish.node->rotate(quat, Node::TS_WORLD);
+			fish.node->lookAt(fish.node->getPosition() + (finalVelocity * 20), Ogre::Node::TS_WORLD);
+			fish.node->pitch(Degree(270));
+			fish.lastDirection = finalVelocity + ((finalVelocity - fish.lastDirection) / 2);
+			mFishRenderer->setTransform(i, fish.node->getPosition(), fish.node->getOrientation());
 		}
 	}
 }
@@ -2115,7 +2258,7 @@ void PGFrameListener::createBulletTerrain(void)
 	mWorld->setDebugDrawer(debugDrawer);
 	mWorld->setShowDebugShapes(false);	// enable it if you want to see the Bullet containers
 	showDebugOverlay(false);
-	SceneNode *node = mSceneMgr->getRootSceneNode()->createChildSceneNode("debugDrawer" + StringConverter::toString(mNumEntitiesInstanced), Ogre::Vector3::ZERO);
+	SceneNode *node = mSceneMgr->getRootSceneNode()->createChildSceneNode(Ogre::Vector3::ZERO);
 	node->attachObject(static_cast <SimpleRenderable *> (debugDrawer));
 }
 
@@ -2130,12 +2273,7 @@ void PGFrameListener::changeBulletTerrain(int level)
 	{
 	}
 	Ogre::ConfigFile config;
-	if (level == 1)
-		config.loadFromResourceSystem("Island.cfg", ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME, "=", true);
-	else if (level == 2)
-		config.loadFromResourceSystem("Island2.cfg", ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME, "=", true);
-	else if (level == 3)
-		config.loadFromResourceSystem("Island3.cfg", ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME, "=", true);
+	config.loadFromResourceSystem(getLevelDescriptor(level).mIslandConfig, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME, "=", true);
 
 	unsigned page_size = Ogre::StringConverter::parseUnsignedInt(config.getSetting( "PageSize" ));
 
@@ -2148,7 +2286,8 @@ void PGFrameListener::changeBulletTerrain(int level)
 	float *heights = new float [page_size*page_size];
 
 	Ogre::Image terrainHeightMap;
-	terrainHeightMap.load(terrainfileName, Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+	if (!mLevelPrefetcher->getHeightmap(terrainfileName, terrainHeightMap))
+		terrainHeightMap.load(terrainfileName, Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
         
 	for(unsigned y = 0; y < page_size; ++y)
 	{
@@ -2184,12 +2323,12 @@ void PGFrameListener::changeBulletTerrain(int level)
 }
 
 //Create the sky system
-void PGFrameListener::createCaelumSystem(void)
+void PGFrameListener::createCaelumSystem(bool clouds)
 {
 	// Initialize the caelum day/night weather system
 	// Each on below corresponds to each element in the system
     Caelum::CaelumSystem::CaelumComponent componentMask;
-	if (currentLevel == 1)
+	if (clouds)
 	{
 		componentMask = static_cast<Caelum::CaelumSystem::CaelumComponent> (
 			Caelum::CaelumSystem::CAELUM_COMPONENT_SUN |				
@@ -2338,324 +2477,107 @@ void PGFrameListener::gunController()
 //Check if level has been completed or failed
 void PGFrameListener::checkLevelEndCondition() //Here we check if levels are complete and whatnot
 {
-	if ((currentLevel ==1) && (levelComplete ==false))
-	{
-		//level one ends when you kill all the targets
-		bool winning = true;
- 		std::deque<EnvironmentObject *>::iterator itLevelTargets = levelTargets.begin();
- 		while (levelTargets.end() != itLevelTargets)
- 		{
-			if (((*itLevelTargets)->targetCounted()==false) && ((*itLevelTargets)->targetHit()))
-			{
-				//update score
-				levelScore += ((*itLevelTargets)->getBody()->getBulletRigidBody()->getRestitution() * 10000);
-				std::cout << "Score: " << levelScore << std::endl;
-				(*itLevelTargets)->counted = true;
-				targetCount++;
-				String text = String("Targets hit: "+ (StringConverter::toString(targetCount)));
-				HUDTargetText->setCaption(text);
-
-				text = String("Score: "+ (StringConverter::toString(levelScore)));
-				HUDScoreText->setCaption(text);
-			}
+	//Only needed again once a level loads or an event changes a tally
+	mCheckLevelEnd = false;
+	if (levelComplete)
+		return;
 
-			if ((*itLevelTargets)->targetHit() == false)
-			{
-				winning = false;
-			}
-			++itLevelTargets;
- 		}
-		if (winning)
-		{
-			int timeBonus = ((levelTime*1000)-currentTime) *(10.0/(levelTime*1.0)); //normalise time taken to give max bonus of 10K
-			if (timeBonus<0) {
-				timeBonus=0;
-			}
-			levelScore += timeBonus;
-			std::cout << "You're Winner!" << std::endl;
-			std::cout << "Time bonus " << timeBonus << std::endl;
-			std::cout << "Score: " << levelScore << std::endl;
-			float oldHighScore = getOldHighScore(currentLevel);
-			if(levelScore >= oldHighScore) {
-				mMenus->loadLevelComplete(currentTime, coconutCount, levelScore, currentLevel, true);
-				saveNewHighScore(currentLevel, levelScore);
-			} 
-			else {
-				mMenus->loadLevelComplete(currentTime, coconutCount, levelScore, currentLevel, false);
-			}
-			levelComplete = true;
-			mMenus->mLevelCompleteOpen = true;
-			freeRoam = false;
-			coconutCount = 0;
-			targetCount = 0;
-			levelScore = 0;
-		}
-	}
-	if ((currentLevel ==2) && (levelComplete ==false))
+	ObjectiveTracker::State state = mObjectives->getState();
+	if (state == ObjectiveTracker::OBJECTIVES_LOST)
 	{
-		//Check for Jenga block above certain height
-		std::deque<EnvironmentObject *>::iterator itLevelBlocks = levelBlocks.begin();
-		while (levelTargets.end() != itLevelBlocks)
-		{
-			if ((*itLevelBlocks)->mPosition.y > 1000)
-			{
-				//(*itLevelBlocks)->getBody()->getBulletRigidBody()->check
-				levelScore += 10000;
-				levelComplete = true;
-				break;
-			}
-			++itLevelBlocks;
-		}
-		if (levelComplete)
-		{
-			int timeBonus = ((levelTime*1000)-currentTime) *(10.0/(levelTime*1.0)); //normalise time taken to give max bonus of 10K
-			if (timeBonus<0) {
-				timeBonus=0;
-			}
-			levelScore += timeBonus;
-			std::cout << "You're Winner!" << std::endl;
-			std::cout << "Time bonus " << timeBonus << std::endl;
-			std::cout << "Score: " << levelScore << std::endl;
-			float oldHighScore = getOldHighScore(currentLevel);
-			if(levelScore >= oldHighScore) {
-				mMenus->loadLevelComplete(currentTime, coconutCount, levelScore, currentLevel, true);
-				saveNewHighScore(currentLevel, levelScore);
-			} 
-			else {
-				mMenus->loadLevelComplete(currentTime, coconutCount, levelScore, currentLevel, false);
-			}
-			levelComplete = true;
-			freeRoam = false;
-			coconutCount = 0;
-			targetCount = 0;
-			levelScore = 0;
-		}
-	}
-	if ((currentLevel ==3) && (levelComplete ==false))
+		levelScore = 0;
+		std::cout << "LEVEL FAILED" << std::endl;
+		coconutCount = 0;
+		freeRoam = false;
+		mMenus->loadLevelFailed(currentLevel);
+		mMenus->mLevelFailedOpen = true;
+	}
+	else if (state == ObjectiveTracker::OBJECTIVES_WON)
 	{
-		bool winning = false;
-
-		//Check if blue blocks hit ground
-		std::deque<EnvironmentObject *>::iterator itLevelBlue = levelBlue.begin();
-		while (levelBlue.end() != itLevelBlue)
-		{
-			if ((*itLevelBlue)->targetHit()==true)
-			{
-				levelComplete = true;
-				levelScore = 0;
-				std::cout << "LEVEL FAILED - blue hit ground" << std::endl;
-				levelComplete = false;
-				coconutCount = 0;
-				freeRoam = false;
-				mMenus->loadLevelFailed(currentLevel);
-				mMenus->mLevelFailedOpen = true;
-				break;
-			}
-			++itLevelBlue;
-		}
-
-		//Check if coconut hit red block
-		std::deque<EnvironmentObject *>::iterator itLevelRed = levelRed.begin();
-		while (levelRed.end() != itLevelRed)
-		{
-			if ((*itLevelRed)->targetHit())
-			{
-				levelComplete = true;
-				levelScore = 0;
-				std::cout << "LEVEL FAILED - red hit by coconut" << std::endl;
-				levelComplete = false;
-				coconutCount = 0;
-				freeRoam = false;
-				mMenus->loadLevelFailed(currentLevel);
-				mMenus->mLevelFailedOpen = true;
-				break;
-			}
-			++itLevelRed;
-		}
-
-		//Check orange blocks
-		std::deque<EnvironmentObject *>::iterator itLevelOrange = levelOrange.begin();
-		while (levelOrange.end() != itLevelOrange)
-		{
-			winning = true;
-			if (((*itLevelOrange)->targetCounted()==false) && ((*itLevelOrange)->targetHit()))
-			{
-				//update score
-				levelScore += 1000;
-				(*itLevelOrange)->counted = true;
-			}
-			if ((*itLevelOrange)->targetHit() == false)
-			{
-				winning = false;
-			}
-			++itLevelOrange;
-		}
-		if (winning)
-		{
-			int timeBonus = ((levelTime*1000)-currentTime) *(10.0/(levelTime*1.0)); //normalise time taken to give max bonus of 10K
-			if (timeBonus<0) {
-				timeBonus=0;
-			}
-			levelScore += timeBonus;
-			std::cout << "You're Winner!" << std::endl;
-			std::cout << "Score: " << levelScore << std::endl;
-			levelComplete = true;
-			freeRoam = false;
-			float oldHighScore = getOldHighScore(currentLevel);
-			if(levelScore >= oldHighScore) {
-				mMenus->loadLevelComplete(currentTime, coconutCount, levelScore, currentLevel, true);
-				saveNewHighScore(currentLevel, levelScore);
-			} 
-			else {
-				mMenus->loadLevelComplete(currentTime, coconutCount, levelScore, currentLevel, false);
-			}
-			mMenus->mLevelCompleteOpen = true;
-			coconutCount = 0;
-			levelScore = 0;
-		}
-	}
-}
-
-//Find current high score for level
-float PGFrameListener::getOldHighScore(int level) {
-	float oldHighScore;
-
-	std::ifstream objects("../../res/Levels/Level"+to_string(level)+"HighScore.txt");
-	std::string line;
-	int i=0;
-
-	while(std::getline(objects, line)) {
-		if(line.substr(0, 1) != "#") { //Ignore comments in file
-			oldHighScore = atoi(line.c_str());
-		}
+		levelScore += winBonus;
+		int timeBonus = ((levelTime*1000)-currentTime) *(10.0/(levelTime*1.0)); //normalise time taken to give max bonus of 10K
+		if (timeBonus<0) {
+			timeBonus=0;
+		}
+		levelScore += timeBonus;
+		std::cout << "You're Winner!" << std::endl;
+		std::cout << "Time bonus " << timeBonus << std::endl;
+		std::cout << "Score: " << levelScore << std::endl;
+		bool newHighScore = saveNewHighScore(currentLevel, levelScore);
+		mMenus->loadLevelComplete(currentTime, coconutCount, levelScore, currentLevel, newHighScore);
+		levelComplete = true;
+		mMenus->mLevelCompleteOpen = true;
+		freeRoam = false;
+		coconutCount = 0;
+		targetCount = 0;
+		levelScore = 0;
 	}
-
-	return oldHighScore;
 }
 
-//Save new level high score
-void PGFrameListener::saveNewHighScore(int level, float levelScore) {
-	ofstream outputToHighScoreFile;
-	outputToHighScoreFile.open("../../res/Levels/Level"+to_string(level)+"HighScore.txt");
-	outputToHighScoreFile << StringConverter::toString(levelScore) << "\n";
-	outputToHighScoreFile.close();
+//Records a finished run, returns whether it beat the level's best
+bool PGFrameListener::saveNewHighScore(int level, float levelScore) {
+	return mHighScores->submit(level, levelScore, currentTime, coconutCount) == 0;
 }
 
 //Save a level that has been edited
-void PGFrameListener::saveLevel(void) //This will be moved to Level manager, and print to a file
+void PGFrameListener::saveLevel(void)
 {
 	// Ordering of levelObjects.txt files:
-	// Name, mesh, posX, posY, posZ, orX, orY, orZ, orW, scalex, scaley, scalez, rest, friction, mass, 
+	// Name, mesh, posX, posY, posZ, orW, orX, orY, orZ, scalex, scaley, scalez, rest, friction, mass, 
 	//	 animated, xMove, yMove, zMove, speed, rotX, rotY, rotZ, billboard
 	// Note: Must have a speed of at least 1 if it is going to be animated
 
-	std::stringstream objects;
-	std::stringstream bodies;
-	std::stringstream coconuts;
-	std::stringstream targets;
-	std::stringstream blocks;
-	std::stringstream palms;
-	std::stringstream oranges;
-	std::stringstream blues;
-	std::stringstream reds;
-	String mesh;
-	ofstream outputToFile;
-	ofstream outputToFileStoringTerrain;
+	//The journal holds every placed object as a level file line, a checkpoint brings them up to date with the bodies
+	mEditorJournal->checkpoint();
+	saveUserLevel(mEditorJournal->getIsland(), mEditorJournal->getObjectText());
+}
 
+//Queues a new custom level's files on the background writer
+void PGFrameListener::saveUserLevel(int island, const String &objectText)
+{
 	int number = findUniqueName();
-	outputToFile.open("../../res/Levels/Custom/UserLevel"+StringConverter::toString(number)+"Objects.txt"); // Overwrites old level file when you save
-	
-	//Stores which island was used
-	outputToFileStoringTerrain.open("../../res/Levels/Custom/UserLevel"+StringConverter::toString(number)+"Island.txt");
-	outputToFileStoringTerrain << to_string(editingLevel) << "\n";
-
-	ofstream outputToLevelTrackingFile;
-	outputToLevelTrackingFile.open("../../res/Levels/Custom/UserGeneratedLevels.txt");
-	outputToLevelTrackingFile << StringConverter::toString(number) << "\n";
-	outputToLevelTrackingFile.close();
-
-	bodies = generateObjectStringForSaving(levelBodies);
-	coconuts = generateObjectStringForSaving(levelCoconuts);
-	targets = generateObjectStringForSaving(levelTargets);
-	blocks = generateObjectStringForSaving(levelBlocks);
-	palms = generateObjectStringForSaving(levelPalms);
-	oranges = generateObjectStringForSaving(levelOrange);
-	blues = generateObjectStringForSaving(levelBlue);
-	reds = generateObjectStringForSaving(levelRed);
-
-	objects << bodies.str() << coconuts.str() << targets.str() << blocks.str() << palms.str() << oranges.str() << blues.str() << reds.str();
- 	
-	std::string objectsString = objects.str();
-	outputToFile << objectsString;
-	outputToFile.close();
-	mMenus->mNewLevelsMade++;
-}
+	String levelFile = "../../res/Levels/Custom/UserLevel"+StringConverter::toString(number);
 
-//Generate string for object so it can be saved
-std::stringstream PGFrameListener::generateObjectStringForSaving(std::deque<EnvironmentObject *> queue) {
-	std::deque<EnvironmentObject *>::iterator iterate = queue.begin();
-	std::stringstream objectDetails;
- 	while (queue.end() != iterate)
- 	{   
-		OgreBulletDynamics::RigidBody *currentBody = (*iterate)->getBody();
-		std::string mesh = (*iterate)->mMesh;
-		std::string name = (*iterate)->mName;
-
-		std::cout << (*iterate)->mName << ", " << currentBody->getWorldPosition() << "\n" << std::endl;
-
-		objectDetails << name << "," << mesh << "," <<
-				StringConverter::toString(currentBody->getWorldPosition().x) << "," <<
-				StringConverter::toString(currentBody->getWorldPosition().y) << "," <<
-				StringConverter::toString(currentBody->getWorldPosition().z) << "," <<
-				StringConverter::toString(currentBody->getWorldOrientation().w) << "," <<
-				StringConverter::toString(currentBody->getWorldOrientation().x) << "," <<
-				StringConverter::toString(currentBody->getWorldOrientation().y) << "," <<
-				StringConverter::toString(currentBody->getWorldOrientation().z) << "," <<
-				StringConverter::toString(currentBody->getSceneNode()->getScale().x) << "," <<
-				StringConverter::toString(currentBody->getSceneNode()->getScale().y) << "," <<
-				StringConverter::toString(currentBody->getSceneNode()->getScale().z) << "," <<
-				StringConverter::toString((*iterate)->mRestitution) << "," <<
-				StringConverter::toString((*iterate)->mFriction) << "," <<
-				StringConverter::toString((*iterate)->mMass) << "," <<
-				StringConverter::toString((*iterate)->mAnimated) << "," <<
-				StringConverter::toString((*iterate)->mXMovement) << "," <<
-				StringConverter::toString((*iterate)->mYMovement) << "," <<
-				StringConverter::toString((*iterate)->mZMovement) << "," <<
-				StringConverter::toString((*iterate)->mSpeed) << "," <<
-				StringConverter::toString((*iterate)->mRotationX) << "," <<
-				StringConverter::toString((*iterate)->mRotationY) << "," <<
-				StringConverter::toString((*iterate)->mRotationZ) << "," <<
-				StringConverter::toString((*iterate)->mBillBoard) << "," << "\n";
-		++iterate;
- 	}
-	return objectDetails;
+	mBackgroundWriter->write(levelFile+"Objects.txt", objectText);
+	mBackgroundWriter->write(levelFile+"Island.txt", StringConverter::toString(island)+"\n"); //Stores which island was used
+	//Queued last, so the level is only listed once its files exist
+	mLevelCatalog->add(number, island, objectText);
 }
 
-//Determine what levels have been made already to find a unique name
-int PGFrameListener::findUniqueName(void) {
-	std::string number;
+//Saves whatever was left of an edit when the game last stopped unexpectedly as a new custom level
+void PGFrameListener::recoverEditorAutosave(void)
+{
+	int island = 0;
+	String objectText;
+	if (EditorJournal::recover(island, objectText))
+		saveUserLevel(island, objectText);
+	mBackgroundWriter->flush();
+	EditorJournal::discardRecovered();
+}
 
-	std::ifstream objects("../../res/Levels/Custom/UserGeneratedLevels.txt");
-	std::string line;
-	int i=0;
+//Blocks until queued saves are on disk, used before reading a custom level back
+void PGFrameListener::waitForSaves(void)
+{
+	mBackgroundWriter->flush();
+}
 
-	while(std::getline(objects, line)) {
-		if(line.substr(0, 1) != "#") { //Ignore comments in file
-			number = line;
-		}
-	}
-	int uniqueNumber = atoi(number.c_str()) + 1;
-	return uniqueNumber;
+//Number for the next custom level
+int PGFrameListener::findUniqueName(void) {
+	return mLevelCatalog->getNextId();
 }
 
 //Load a new level
 void PGFrameListener::loadLevel(int levelNo, int islandNo, bool userLevel)
 {
 	clearLevel();
+	mLevelPrefetcher->cancel();
+	mEditorJournal->end();
 
 	//Reset variables
 	loadLevelIslandAndWater(islandNo);
-	setPlayerPosition(levelNo);
+	setPlayerPosition(userLevel ? islandNo : levelNo);
+	mGunReflection->setProbes(getLevelDescriptor(islandNo).mProbes);
+	mGunReflection->invalidate(); //New island and sky
 	levelComplete = false;
 	levelScore = 0;
 	coconutCount = 0;
@@ -2663,13 +2585,23 @@ void PGFrameListener::loadLevel(int levelNo, int islandNo, bool userLevel)
 
 	//Load basics
 	loadObjectFile(levelNo, userLevel);
+	if (!editMode)
+	{
+		mPropBatcher->build(*mEntities);
+		//Palms the editor can't move are drawn instanced, with extra scenery palms from the island's density map
+		const LevelDescriptor &descriptor = getLevelDescriptor(islandNo);
+		mVegetation->addPalms(*mEntities);
+		mVegetation->scatter(descriptor.mPalmDensityMap, descriptor.mPalmCount, mTerrainGroup, islandNo);
+		mVegetation->build();
+	}
+	mCheckLevelEnd = true;
 	changeLevelFish();
-	HUDNode2->detachAllObjects();
+	mHUD->setFieldVisible(mHUDTargets, false);
 
 	//Reset GUI messages
-	HUDTargetText->setCaption("Targets hit: 0");
-	HUDCoconutText->setCaption("Coconuts: 0");
-	HUDScoreText->setCaption("Score: 0");
+	mHUD->setNumber(mHUDTargets, "Targets hit: ", 0);
+	mHUD->setNumber(mHUDCoconuts, "Coconuts: ", 0);
+	mHUD->setNumber(mHUDScore, "Score: ", 0);
 
 	//Swap sky system
 	if (mCaelumSystem)
@@ -2682,52 +2614,42 @@ void PGFrameListener::loadLevel(int levelNo, int islandNo, bool userLevel)
 	if (mSkyX->isCreated())
 	{
 		mSkyX->remove();
-		mSceneMgr->getLight("Light1")->setVisible(false);
-		mSceneMgr->destroyLight(mSceneMgr->getLight("Light1"));
+		if (mShadowLight)
+		{
+			mSceneMgr->destroyLight(mShadowLight);
+			mShadowLight = NULL;
+		}
 	}
 
 	mSceneMgr->setAmbientLight(ColourValue(0.05, 0.05, 0.05, 2));
 	weatherSystem = 0;
 	//Set torch value
-	if (spotOn)
+	if (mSpotLight)
 	{
-		mSceneMgr->destroyLight(mSceneMgr->getLight("Spot"));
-		spotOn = false;
+		mSceneMgr->destroyLight(mSpotLight);
+		mSpotLight = NULL;
 	}
 
 	//If level being loaded is not a user level level challenges
 	if(!userLevel) {
 		currentLevel = islandNo;
+		const LevelDescriptor &level = getLevelDescriptor(islandNo);
+		createSky(level.mSky);
 		if(islandNo == 1)
 		{
-			createCaelumSystem();
-			HUDNode2->attachObject(HUDTargetText);
+			mHUD->setFieldVisible(mHUDTargets, true);
 			spinTime = 0;
-			levelTime = 300;
 		}
-		else if (islandNo == 2)
-		{
-			createCaelumSystem();
+		if (level.mJengaPlatform)
 			createJengaPlatform();
-			levelTime = 600;
-		}
-		else 
-		{
-			// Shadow caster
-			Ogre::Light *mLight1 = mSceneMgr->createLight("Light1");
-			mLight1->setType(Ogre::Light::LT_DIRECTIONAL);
-			mLight1->setDiffuseColour(0, 0, 0);
-			mLight1->setSpecularColour(0, 0, 0);
-			mLight1->setVisible(false);
-			mSkyX->create();
-			weatherSystem = 1;
-
-			levelTime = 300;
-		}
+		levelTime = level.mLevelTime;
+		winBonus = level.mWinBonus;
+		mObjectives->begin(level.mObjectives, *mEntities);
 	}
 	else {
 		currentLevel = 0;
-		createCaelumSystem();
+		mObjectives->reset();
+		createSky(LevelDescriptor::SKY_CAELUM);
 	}
 
 	if (mCaelumSystem)
@@ -2742,12 +2664,11 @@ void PGFrameListener::loadLevel(int levelNo, int islandNo, bool userLevel)
 	//Alter weather system
 	if (weatherSystem == 1)
 	{
-		Light *spotlight = mSceneMgr->createLight("Spot");
-		spotlight->setType(Light::LT_SPOTLIGHT);
-		spotlight->setDiffuseColour(1, 1, 1);
-		spotlight->setSpecularColour(100, 100, 100);
-		spotlight->setSpotlightRange(Ogre::Degree(10), Ogre::Degree(20));
-		spotOn = true;
+		mSpotLight = mSceneMgr->createLight("Spot");
+		mSpotLight->setType(Light::LT_SPOTLIGHT);
+		mSpotLight->setDiffuseColour(1, 1, 1);
+		mSpotLight->setSpecularColour(100, 100, 100);
+		mSpotLight->setSpotlightRange(Ogre::Degree(10), Ogre::Degree(20));
 	}
 
 	//Reset timer
@@ -2775,12 +2696,7 @@ void PGFrameListener::loadLevelIslandAndWater(int levelNo) {
 	mHydrax->setModule(static_cast<Hydrax::Module::Module*>(mModule));
 
 	// Load all parameters from config file
-	if (levelNo == 1)
-		mHydrax->loadCfg("PGOcean.hdx");
-	else if (levelNo == 2)
-		mHydrax->loadCfg("PGOcean2.hdx");
-	else //if (levelNo == 3)
-		mHydrax->loadCfg("PGOcean3.hdx");
+	mHydrax->loadCfg(getLevelDescriptor(levelNo).mOcean);
 
 	// Create water
 	mHydrax->create();
@@ -2794,43 +2710,68 @@ void PGFrameListener::loadLevelIslandAndWater(int levelNo) {
 
 //Sets player at the starting position for each level
 void PGFrameListener::setPlayerPosition(int level) {
-	if(level == 1) {
-		btTransform transform = playerBody->getCenterOfMassTransform();
-		transform.setOrigin(btVector3(413, 166, 2534));
-		playerBody->getBulletRigidBody()->setCenterOfMassTransform(transform);
-		playerBody->setLinearVelocity(0, 0, 0);
-		mCamera->setOrientation(Quaternion(0.9262, 0, -0.377, 0));
-	} else if(level == 2) {
-		btTransform transform = playerBody->getCenterOfMassTransform();
-		transform.setOrigin(btVector3(354, 149, 2734));
-		playerBody->getBulletRigidBody()->setCenterOfMassTransform(transform);
-		playerBody->setLinearVelocity(0, 0, 0);
-		mCamera->setOrientation(Quaternion(0.793087, 0, -0.609109, 0));
-	} else if(level == 3) {
-		btTransform transform = playerBody->getCenterOfMassTransform();
-		transform.setOrigin(btVector3(641, 169, 2521));
-		playerBody->getBulletRigidBody()->setCenterOfMassTransform(transform);
-		playerBody->setLinearVelocity(0, 0, 0);
-		mCamera->setDirection(0.72, 0, -0.69);
+	const LevelDescriptor &descriptor = getLevelDescriptor(level);
+	if (descriptor.mLevel == 0) //No descriptor, leave the player where they are
+		return;
+
+	btTransform transform = playerBody->getCenterOfMassTransform();
+	transform.setOrigin(btVector3(descriptor.mSpawnPosition.x, descriptor.mSpawnPosition.y, descriptor.mSpawnPosition.z));
+	playerBody->getBulletRigidBody()->setCenterOfMassTransform(transform);
+	playerBody->setLinearVelocity(0, 0, 0);
+	if (descriptor.mUseSpawnDirection)
+		mCamera->setDirection(descriptor.mSpawnDirection);
+	else
+		mCamera->setOrientation(descriptor.mSpawnOrientation);
+}
+
+//Returns a level's descriptor, reading it the first time it is needed
+const LevelDescriptor& PGFrameListener::getLevelDescriptor(int level) {
+	std::map<int, LevelDescriptor>::iterator found = mLevelDescriptors.find(level);
+	if (found != mLevelDescriptors.end())
+		return found->second;
+
+	LevelDescriptor &descriptor = mLevelDescriptors[level];
+	if (level > 0)
+		descriptor.load(level);
+	return descriptor;
+}
+
+//Starts loading a level's assets ahead of time
+void PGFrameListener::prefetchLevel(int level) {
+	if (level <= 0)
+		return;
+	mLevelPrefetcher->start(getLevelDescriptor(level));
+}
+
+//Creates the sky system a level uses
+void PGFrameListener::createSky(LevelDescriptor::SkySystem sky) {
+	if (sky == LevelDescriptor::SKY_SKYX)
+	{
+		// Shadow caster, the one made at startup is reused if it is still around
+		if (!mShadowLight)
+		{
+			mShadowLight = mSceneMgr->createLight("Light1");
+			mShadowLight->setType(Ogre::Light::LT_DIRECTIONAL);
+		}
+		mShadowLight->setDiffuseColour(0, 0, 0);
+		mShadowLight->setSpecularColour(0, 0, 0);
+		mShadowLight->setVisible(false);
+		mSkyX->create();
+		weatherSystem = 1;
 	}
+	else
+		createCaelumSystem(sky == LevelDescriptor::SKY_CAELUM_CLOUDS);
 }
 
 //Clears current level of all objects 
 void PGFrameListener::clearLevel(void) 
 {
-	//Remove current level objects (bodies, coconuts, targets) by going through the lists and removing each
-	clearTargets(levelBodies);
-	clearTargets(levelCoconuts);
-	clearTargets(levelBlocks);
-	clearTargets(levelTargets);
-	clearTargets(levelPalms);
-	levelPalmAnims.clear();
-	clearTargets(levelOrange);
-	std::cout << "remove orange blocks" << std::endl;
-	clearTargets(levelBlue);
-	std::cout << "remove blue blocks" << std::endl;
-	clearTargets(levelRed);
-	std::cout << "remove red blocks" << std::endl;
+	//Remove current level objects (bodies, coconuts, targets, blocks)
+	mVegetation->clear();
+	mPropBatcher->clear();
+	mImpostors->clear();
+	mEntities->clear();
+	mGameEvents->clear();
 	//Remove projectiles
  	std::deque<OgreBulletDynamics::RigidBody *>::iterator itProjectiles = levelProjectiles.begin();
  	while (levelProjectiles.end() != itProjectiles)
@@ -2863,89 +2804,45 @@ void PGFrameListener::clearObjects(std::deque<OgreBulletDynamics::RigidBody *> &
 	queue.clear();
 }
 
-//Deletes targets
-void PGFrameListener::clearTargets(std::deque<EnvironmentObject *> &queue) {
-	std::deque<EnvironmentObject *>::iterator iterator = queue.begin();
- 	while (queue.end() != iterator)
- 	{   
-		OgreBulletDynamics::RigidBody *currentBody = (*iterator)->getBody();
-		currentBody->getSceneNode()->detachAllObjects();
-		currentBody->getBulletCollisionWorld()->removeCollisionObject(currentBody->getBulletRigidBody());
-		delete *iterator;
-		++iterator;
- 	}
-	queue.clear();
-}
-
-//Load new level's objects file 
+//Load new level's objects, compiling the text file into a level pack first if it has changed
 void PGFrameListener::loadObjectFile(int levelNo, bool userLevel) {
-	std::string object[24];
-	std::ifstream objects;
-	std::ifstream island;
-	std::string line;
-
+	String textFile;
 	if(!userLevel) {
-		objects.open("../../res/Levels/Level"+StringConverter::toString(levelNo)+"Objects.txt");
+		textFile = "../../res/Levels/"+getLevelDescriptor(levelNo).mObjectFile;
 	} else {
-		objects.open("../../res/Levels/Custom/UserLevel"+StringConverter::toString(levelNo)+"Objects.txt");
+		textFile = "../../res/Levels/Custom/UserLevel"+StringConverter::toString(levelNo)+"Objects.txt";
 	}
-	
-	int i=0;
 
-	while(std::getline(objects, line)) {
-		if(line.substr(0, 1) != "#") { //Ignore comments in file
-			std::stringstream lineStream(line);
-			std::string cell;
-		
-			while(std::getline(lineStream, cell, ',')) {
-				object[i] = cell;
-				i++;
-			}
-			i = 0;
-			for(int i=0; i<24; i++) {
-				std::cout << object[i] << std::endl;
-			}
-			loadLevelObjects(object);
-		}
-	}
-}
+	String packFile = LevelPack::getPackFileName(textFile);
+	if (LevelPack::isStale(textFile, packFile))
+		LevelPack::compile(textFile, packFile);
 
-//Create new object and store it in the correct place
-void PGFrameListener::loadLevelObjects(std::string object[24]) 
-{
-	std::string name = object[0];
-	EnvironmentObject* newObject = new EnvironmentObject(this, mWorld, mNumEntitiesInstanced, mSceneMgr, object);
+	LevelPack pack;
+	if (!pack.open(packFile))
+		return;
 
-	if (name == "Crate") {
-		levelBodies.push_back(newObject);
-	}
-	else if (name == "GoldCoconut") {
-		levelCoconuts.push_back(newObject);
-	}
-	else if (name == "Target") {
-		levelTargets.push_back(newObject);
-	}
-	else if (name == "Block") {
-		levelBlocks.push_back(newObject);
-	}
-	else if (name == "Palm") {
-		levelPalms.push_back(newObject);
-		levelPalmAnims.push_back(newObject->getPalmAnimation());
-	}
-	else if (name == "Orange") {
-		levelOrange.push_back(newObject);
-	}
-	else if (name == "Blue") {
-		levelBlue.push_back(newObject);
-	}
-	else if (name == "Red") {
-		levelRed.push_back(newObject);
-	}
-	else {
-		levelBodies.push_back(newObject);
+	//Each name in the pack is looked up once, however many objects use it
+	std::vector<const Archetype *> archetypes(pack.getStringCount(), (const Archetype *) NULL);
+	for (unsigned int i = 0; i < pack.getRecordCount(); i++)
+	{
+		const LevelObjectRecord &record = pack.getRecord(i);
+		if (record.name >= archetypes.size())
+			continue;
+		if (!archetypes[record.name])
+			archetypes[record.name] = &mArchetypes->findByName(pack.getString(record.name));
+
+		const Archetype &archetype = *archetypes[record.name];
+		loadLevelObjects(new EnvironmentObject(this, mWorld, mSceneMgr, archetype, record, pack), archetype);
 	}
+}
 
-	mNumEntitiesInstanced++;				
+//Store a new level object in the correct place
+EntityHandle PGFrameListener::loadLevelObjects(EnvironmentObject* newObject, const Archetype &archetype) 
+{
+	EntityHandle handle = mEntities->create(archetype.category, *newObject);
+	delete newObject;
+	mNumEntitiesInstanced++;
+	return handle;
 }
 
 //Creates terrain from image
@@ -3045,18 +2942,9 @@ void PGFrameListener::defineTerrain(long x, long y, int levelNo)
 void PGFrameListener::getTerrainImage(bool flipX, bool flipY, Ogre::Image& img, int levelNo)
 {
 	std::cout << "get terrainimage " <<std::endl;
-	if (levelNo == 1) {
-		std::cout << "get terrainimage 1" <<std::endl;
-		img.load("terrain.png", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
-	}
-	else if (levelNo == 2) {
-		std::cout << "get terrainimage 2" <<std::endl;
-		img.load("terrain2.png", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
-	}
-	else if (levelNo == 3) {
-		std::cout << "get terrainimage 3" <<std::endl;
-		img.load("terrain3.png", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
-	}
+	const String &heightmap = getLevelDescriptor(levelNo).mHeightmap;
+	if (!mLevelPrefetcher->getHeightmap(heightmap, img))
+		img.load(heightmap, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
     if (flipX)
         img.flipAroundY();
     if (flipY)
@@ -3127,9 +3015,10 @@ void PGFrameListener::notifyMaterialRender(Ogre::uint32 pass_id, Ogre::MaterialP
 //Creates level 2's jenga platform
 void PGFrameListener::createJengaPlatform()
 {
-	platformEntity = mSceneMgr->createEntity("Platform" + StringConverter::toString(mNumEntitiesInstanced), "Platform.mesh");
-	platformEntity->getAnimationState("Act: ArmatureAction")->setEnabled(true);
-	platformEntity->getAnimationState("Act: ArmatureAction")->setTimePosition(2.0417);
+	platformEntity = mSceneMgr->createEntity("Platform.mesh");
+	platformAnim = platformEntity->getAnimationState("Act: ArmatureAction");
+	platformAnim->setEnabled(true);
+	platformAnim->setTimePosition(2.0417);
 	
 	platformNode = mSceneMgr->getRootSceneNode()->createChildSceneNode();
 	platformNode->attachObject(platformEntity);
@@ -3140,7 +3029,7 @@ void PGFrameListener::createJengaPlatform()
 
 	platformOr = platformNode->getOrientation();
 	
-	platformBody = new OgreBulletDynamics::RigidBody("Platform" + StringConverter::toString(mNumEntitiesInstanced), mWorld);
+	platformBody = new OgreBulletDynamics::RigidBody(bodyNames.generate(), mWorld);
 	OgreBulletCollisions::AnimatedMeshToShapeConverter* acs = new OgreBulletCollisions::AnimatedMeshToShapeConverter(platformEntity);
 	OgreBulletCollisions::TriangleMeshCollisionShape* ccs = acs->createTrimesh();
 	OgreBulletCollisions::CollisionShape* f = (OgreBulletCollisions::CollisionShape*) ccs;
@@ -3164,6 +3053,7 @@ void PGFrameListener::destroyJengaPlatform()
 	mWorld->getBulletDynamicsWorld()->removeRigidBody(platformBody->getBulletRigidBody());
 	mSceneMgr->destroySceneNode(platformNode);
 	mSceneMgr->destroyEntity(platformEntity);
+	platformAnim = NULL;
 	beginJenga = false;
 	newPlatformShape = false;
 	platformGoingUp = false;
@@ -3176,26 +3066,26 @@ void PGFrameListener::moveJengaPlatform(double timeSinceLastFrame)
 {
 	if (!beginJenga && (playerBody->getWorldPosition() - platformBody->getWorldPosition()).length() < 1000)
 	{
-		platformEntity->getAnimationState("Act: ArmatureAction")->setLoop(false);
+		platformAnim->setLoop(false);
 		beginJenga = true;
 	}
 
 	if (beginJenga && !newPlatformShape)
 	{
-		platformEntity->getAnimationState("Act: ArmatureAction")->addTime(-timeSinceLastFrame);
+		platformAnim->addTime(-timeSinceLastFrame);
 		mWindow->getViewport(0)->setMaterialScheme("upLightOn");
 		if (platformBody->getLinearVelocity().y + 0.5 >= 30.0f)
 			platformBody->setLinearVelocity(0, 30.0f, 0);
 		else if (platformBody->getLinearVelocity().y < 30.0f)
 			platformBody->setLinearVelocity(0, platformBody->getLinearVelocity().y + 0.5, 0);
 	
-		if (platformEntity->getAnimationState("Act: ArmatureAction")->getTimePosition() == 0.0f)
+		if (platformAnim->getTimePosition() == 0.0f)
 		{
 			Vector3 platformBodyPosition = platformBody->getWorldPosition();
 			Vector3 platformBodyVel = platformBody->getLinearVelocity();
 			mWorld->getBulletDynamicsWorld()->removeRigidBody(platformBody->getBulletRigidBody());
 
-			platformBody = new OgreBulletDynamics::RigidBody("Platform" + StringConverter::toString(mNumEntitiesInstanced), mWorld);
+			platformBody = new OgreBulletDynamics::RigidBody(bodyNames.generate(), mWorld);
 			OgreBulletCollisions::AnimatedMeshToShapeConverter* acs = new OgreBulletCollisions::AnimatedMeshToShapeConverter(platformEntity);
 			OgreBulletCollisions::TriangleMeshCollisionShape* ccs = acs->createTrimesh();
 			OgreBulletCollisions::CollisionShape* f = (OgreBulletCollisions::CollisionShape*) ccs;
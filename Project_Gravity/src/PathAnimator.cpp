@@ -0,0 +1,194 @@
+#include "stdafx.h"
+#include "PathAnimator.h"
+#include <xmmintrin.h>
+
+/* Moves animated level objects along their paths around their home positions.
+ * Each path swings sin(t / speed) along x and z and cos(t / speed) along y. Paths are grouped by speed
+ * so the trig is worked out once per group rather than once per object, positions are then evaluated
+ * four paths at a time with SSE, and finally every transform is written to Bullet in one pass.
+ */
+
+//Constructor
+PathAnimator::PathAnimator()
+{
+}
+
+//Destructor
+PathAnimator::~PathAnimator()
+{
+}
+
+//Adds a path for a body, returns its index until another path is removed
+int PathAnimator::add(Ogre::uint32 owner, OgreBulletDynamics::RigidBody* body, const Vector3 &home, const Vector3 &movement, Real speed, const Vector3 &rotation)
+{
+	mHomeX.push_back(home.x);
+	mHomeY.push_back(home.y);
+	mHomeZ.push_back(home.z);
+	mMoveX.push_back(movement.x);
+	mMoveY.push_back(movement.y);
+	mMoveZ.push_back(movement.z);
+	mSines.push_back(0);
+	mCosines.push_back(1);
+	mX.push_back(home.x);
+	mY.push_back(home.y);
+	mZ.push_back(home.z);
+	mRotations.push_back(btVector3(rotation.x, rotation.y, rotation.z));
+	mBodies.push_back(body->getBulletRigidBody());
+	mGroups.push_back((Ogre::uint16) findGroup(speed));
+	mOwners.push_back(owner);
+	return mOwners.size() - 1;
+}
+
+//Speed group for a path, made if no other path moves at that speed
+int PathAnimator::findGroup(Real speed)
+{
+	for (unsigned int g = 0; g < mGroupSpeeds.size(); g++)
+	{
+		if (mGroupSpeeds[g] == speed)
+			return g;
+	}
+	mGroupSpeeds.push_back(speed);
+	mGroupSines.push_back(0);
+	mGroupCosines.push_back(1);
+	return mGroupSpeeds.size() - 1;
+}
+
+//Removes a path, the last path moves into its place
+void PathAnimator::remove(int path)
+{
+	int last = mOwners.size() - 1;
+	if (path < 0 || path > last)
+		return;
+
+	if (path != last)
+	{
+		mHomeX[path] = mHomeX[last];
+		mHomeY[path] = mHomeY[last];
+		mHomeZ[path] = mHomeZ[last];
+		mMoveX[path] = mMoveX[last];
+		mMoveY[path] = mMoveY[last];
+		mMoveZ[path] = mMoveZ[last];
+		mSines[path] = mSines[last];
+		mCosines[path] = mCosines[last];
+		mX[path] = mX[last];
+		mY[path] = mY[last];
+		mZ[path] = mZ[last];
+		mRotations[path] = mRotations[last];
+		mBodies[path] = mBodies[last];
+		mGroups[path] = mGroups[last];
+		mOwners[path] = mOwners[last];
+	}
+	mHomeX.pop_back();
+	mHomeY.pop_back();
+	mHomeZ.pop_back();
+	mMoveX.pop_back();
+	mMoveY.pop_back();
+	mMoveZ.pop_back();
+	mSines.pop_back();
+	mCosines.pop_back();
+	mX.pop_back();
+	mY.pop_back();
+	mZ.pop_back();
+	mRotations.pop_back();
+	mBodies.pop_back();
+	mGroups.pop_back();
+	mOwners.pop_back();
+}
+
+//Removes every path and speed group
+void PathAnimator::clear(void)
+{
+	mHomeX.clear();
+	mHomeY.clear();
+	mHomeZ.clear();
+	mMoveX.clear();
+	mMoveY.clear();
+	mMoveZ.clear();
+	mSines.clear();
+	mCosines.clear();
+	mX.clear();
+	mY.clear();
+	mZ.clear();
+	mRotations.clear();
+	mBodies.clear();
+	mGroups.clear();
+	mOwners.clear();
+	mGroupSpeeds.clear();
+	mGroupSines.clear();
+	mGroupCosines.clear();
+}
+
+//Number of paths
+int PathAnimator::getCount(void) const
+{
+	return mOwners.size();
+}
+
+//Owner handle given when the path was added
+Ogre::uint32 PathAnimator::getOwner(int path) const
+{
+	return mOwners[path];
+}
+
+/* Moves every path's body to where it should be at the given time.
+ * Bodies whose friction has been set to stoppedFriction keep moving but no longer spin, and their
+ * owners are added to stopped */
+void PathAnimator::update(double time, float stoppedFriction, std::vector<Ogre::uint32> &stopped)
+{
+	//Phases are worked out in double precision as the time keeps growing through the level
+	for (unsigned int g = 0; g < mGroupSpeeds.size(); g++)
+	{
+		double phase = time / mGroupSpeeds[g];
+		mGroupSines[g] = (float) sin(phase);
+		mGroupCosines[g] = (float) cos(phase);
+	}
+
+	evaluate();
+
+	int count = mOwners.size();
+	for (int i = 0; i < count; i++)
+	{
+		btRigidBody* body = mBodies[i];
+		body->setActivationState(DISABLE_DEACTIVATION);
+		btTransform transform = body->getCenterOfMassTransform();
+		transform.setOrigin(btVector3(mX[i], mY[i], mZ[i]));
+
+		if (body->getFriction() == stoppedFriction)
+			stopped.push_back(mOwners[i]);
+		else
+			body->setAngularVelocity(mRotations[i]);
+
+		//Move object and set velocity to 0
+		body->setCenterOfMassTransform(transform);
+		body->setLinearVelocity(btVector3(0, 0, 0));
+	}
+}
+
+//Works out every path's position from its group's trig
+void PathAnimator::evaluate(void)
+{
+	int count = mOwners.size();
+	for (int i = 0; i < count; i++)
+	{
+		mSines[i] = mGroupSines[mGroups[i]];
+		mCosines[i] = mGroupCosines[mGroups[i]];
+	}
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 sine = _mm_loadu_ps(&mSines[i]);
+		__m128 cosine = _mm_loadu_ps(&mCosines[i]);
+		_mm_storeu_ps(&mX[i], _mm_add_ps(_mm_loadu_ps(&mHomeX[i]), _mm_mul_ps(_mm_loadu_ps(&mMoveX[i]), sine)));
+		_mm_storeu_ps(&mY[i], _mm_add_ps(_mm_loadu_ps(&mHomeY[i]), _mm_mul_ps(_mm_loadu_ps(&mMoveY[i]), cosine)));
+		_mm_storeu_ps(&mZ[i], _mm_add_ps(_mm_loadu_ps(&mHomeZ[i]), _mm_mul_ps(_mm_loadu_ps(&mMoveZ[i]), sine)));
+	}
+
+	//Whatever doesn't fill a group of four
+	for (; i < count; i++)
+	{
+		mX[i] = mHomeX[i] + mMoveX[i] * mSines[i];
+		mY[i] = mHomeY[i] + mMoveY[i] * mCosines[i];
+		mZ[i] = mHomeZ[i] + mMoveZ[i] * mSines[i];
+	}
+}
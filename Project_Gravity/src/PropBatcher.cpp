@@ -0,0 +1,194 @@
+#include "stdafx.h"
+#include "PropBatcher.h"
+#include "BatchingHelper.h"
+
+/* Draws level props that aren't moving as static geometry instead of one entity and scene node each.
+ * The level is split into square cells, and each cell's resting props are merged into one StaticGeometry,
+ * which batches them by material. When a prop's body wakes up, for example when the gravity gun grabs it,
+ * its own entity is shown again and its cell is rebuilt straight away without it. Once the body falls
+ * asleep again it is merged back in, a few cells per frame. Cells far from the camera are swapped for
+ * billboards by the ImpostorRenderer.
+ */
+
+//Width of a cell in world units, the islands are 3000 across
+const Real PROP_CELL_SIZE = 500;
+//Cells a frame that are rebuilt to take in props that have come to rest
+const int MERGES_PER_FRAME = 1;
+
+//Constructor
+PropBatcher::PropBatcher(SceneManager* sceneMgr, ImpostorRenderer* impostors) :
+	mSceneMgr(sceneMgr), mImpostors(impostors), mBatchedCount(0)
+{
+}
+
+//Destructor
+PropBatcher::~PropBatcher()
+{
+	clear();
+}
+
+//Returns a cell, making its static geometry the first time it is used
+PropBatcher::Cell& PropBatcher::getCell(int key)
+{
+	std::map<int, Cell>::iterator found = mCells.find(key);
+	if (found != mCells.end())
+		return found->second;
+
+	Cell cell;
+	cell.geometry = mSceneMgr->createStaticGeometry("Props" + StringConverter::toString(key));
+	cell.geometry->setRegionDimensions(Vector3(PROP_CELL_SIZE, 100000, PROP_CELL_SIZE));
+	cell.geometry->setCastShadows(true);
+	cell.impostorGroup = mImpostors->addGroup();
+	cell.dirty = false;
+	cell.urgent = false;
+	return mCells.insert(std::make_pair(key, cell)).first->second;
+}
+
+//Collects every prop the entity store says may be batched, and builds the cells of those already at rest
+void PropBatcher::build(const EntityStore &entities)
+{
+	clear();
+
+	for (int i = 0; i < entities.getCount(); i++)
+	{
+		if (!entities.isStaticProp(i))
+			continue;
+
+		//The body's node holds the prop's entity, and sometimes Bullet's debug shape as well
+		OgreBulletDynamics::RigidBody* body = entities.getBody(i);
+		Entity* entity = NULL;
+		SceneNode::ObjectIterator objects = body->getSceneNode()->getAttachedObjectIterator();
+		while (objects.hasMoreElements() && !entity)
+		{
+			MovableObject* object = objects.getNext();
+			if (object->getMovableType() == EntityFactory::FACTORY_TYPE_NAME)
+				entity = static_cast<Entity*>(object);
+		}
+		if (!entity || entity->hasSkeleton())
+			continue;
+
+		Prop prop;
+		prop.body = body;
+		prop.entity = entity;
+		prop.cell = BatchingHelper::getCellKey(body->getCenterOfMassPosition(), PROP_CELL_SIZE);
+		prop.resting = body->getBulletRigidBody()->isStaticObject() || !body->getBulletRigidBody()->isActive();
+		prop.inGeometry = false;
+		mProps.push_back(prop);
+
+		if (prop.resting)
+			getCell(prop.cell).dirty = true;
+	}
+
+	for (std::map<int, Cell>::iterator it = mCells.begin(); it != mCells.end(); ++it)
+		rebuild(it->first, it->second);
+}
+
+//Shows every prop's own entity again and destroys the static geometry
+void PropBatcher::clear(void)
+{
+	for (unsigned int i = 0; i < mProps.size(); i++)
+	{
+		if (mProps[i].inGeometry)
+			mProps[i].entity->setVisible(true);
+	}
+	mProps.clear();
+
+	for (std::map<int, Cell>::iterator it = mCells.begin(); it != mCells.end(); ++it)
+		mSceneMgr->destroyStaticGeometry(it->second.geometry);
+	mCells.clear();
+	mBatchedCount = 0;
+}
+
+/* Splits out props whose bodies have woken and merges back ones that have come to rest.
+ * Cells a prop has left are rebuilt this frame, cells only gaining props are rebuilt a few at a time */
+void PropBatcher::update(void)
+{
+	for (unsigned int i = 0; i < mProps.size(); i++)
+	{
+		Prop &prop = mProps[i];
+		btRigidBody* body = prop.body->getBulletRigidBody();
+		bool resting = body->isStaticObject() || !body->isActive();
+		if (resting == prop.resting)
+			continue;
+
+		prop.resting = resting;
+		if (!resting)
+		{
+			//Show the prop's own entity where the body is, its old copy is taken out of the cell below
+			if (prop.inGeometry)
+			{
+				prop.entity->setVisible(true);
+				Cell &cell = getCell(prop.cell);
+				cell.dirty = true;
+				cell.urgent = true;
+			}
+		}
+		else
+		{
+			//It may have been knocked into another cell while it was awake
+			prop.cell = BatchingHelper::getCellKey(prop.body->getCenterOfMassPosition(), PROP_CELL_SIZE);
+			getCell(prop.cell).dirty = true;
+		}
+	}
+
+	int merges = 0;
+	for (std::map<int, Cell>::iterator it = mCells.begin(); it != mCells.end(); ++it)
+	{
+		Cell &cell = it->second;
+		if (cell.urgent || (cell.dirty && merges < MERGES_PER_FRAME))
+		{
+			if (!cell.urgent)
+				merges++;
+			rebuild(it->first, cell);
+		}
+		cell.geometry->setVisible(mImpostors->isNear(cell.impostorGroup));
+	}
+}
+
+/* Bakes a cell's resting props into its static geometry and hides their own entities.
+ * The cell only gets billboards if every one of its props has them, otherwise it is always drawn as meshes */
+void PropBatcher::rebuild(int key, Cell &cell)
+{
+	cell.geometry->reset();
+	mImpostors->clearGroup(cell.impostorGroup);
+	bool impostors = true;
+	for (unsigned int i = 0; i < mProps.size() && impostors; i++)
+	{
+		if (mProps[i].cell == key && mProps[i].resting && !mImpostors->hasImpostor(mProps[i].entity->getMesh()->getName()))
+			impostors = false;
+	}
+
+	bool any = false;
+	for (unsigned int i = 0; i < mProps.size(); i++)
+	{
+		Prop &prop = mProps[i];
+		if (prop.cell != key)
+			continue;
+
+		bool wasInGeometry = prop.inGeometry;
+		prop.inGeometry = prop.resting;
+		if (prop.inGeometry)
+		{
+			SceneNode* node = prop.body->getSceneNode();
+			cell.geometry->addEntity(prop.entity, node->_getDerivedPosition(), node->_getDerivedOrientation(), node->_getDerivedScale());
+			if (impostors)
+				mImpostors->add(cell.impostorGroup, prop.entity->getMesh()->getName(), node->_getDerivedPosition(), node->_getDerivedOrientation(), node->_getDerivedScale());
+			prop.entity->setVisible(false);
+			any = true;
+		}
+		else
+			prop.entity->setVisible(true);
+		mBatchedCount += (prop.inGeometry ? 1 : 0) - (wasInGeometry ? 1 : 0);
+	}
+
+	if (any)
+		cell.geometry->build();
+	cell.dirty = false;
+	cell.urgent = false;
+}
+
+//Props currently drawn as static geometry, for the debug overlay
+int PropBatcher::getBatchedCount(void) const
+{
+	return mBatchedCount;
+}
@@ -0,0 +1,314 @@
+#include "stdafx.h"
+#include "ReflectionUpdater.h"
+
+/* Keeps the gravity gun's cube map reflection up to date without rendering the scene six extra times a frame.
+ * Faces are rendered round robin, a few per frame, and only when they are out of date: every face goes
+ * stale once the camera has moved far enough from where the cube map was rendered, and a face is also
+ * refreshed after a while so moving objects and the sky still show up when the player stands still.
+ * The cube faces are aligned to the world axes, so turning the camera doesn't change them.
+ * Faces are drawn by a camera of their own that only sees objects flagged VISIBLE_IN_REFLECTION,
+ * culls anything past a short distance, drops mesh and material detail and skips shadows.
+ *
+ * On slower machines the probe mode replaces all of that. A cube map is baked at each of the level's probe
+ * points on the first frame after it loads, and the gun's material blends the two probes nearest the camera,
+ * so nothing is rendered for the reflection while the level is played.
+ */
+
+//Camera orientation for each face of the cube map, in face order
+const Degree FACE_YAWS[ReflectionUpdater::FACES] = { Degree(-90), Degree(90), Degree(0), Degree(0), Degree(0), Degree(180) };
+const Degree FACE_PITCHES[ReflectionUpdater::FACES] = { Degree(0), Degree(0), Degree(90), Degree(-90), Degree(0), Degree(0) };
+//Probes only need to look right at a glance, so they're stored at 16 bits a texel
+const PixelFormat PROBE_FORMAT = PF_R5G6B5;
+
+//Constructor
+ReflectionUpdater::ReflectionUpdater() :
+	mMode(MODE_LIVE), mResolution(256), mFacesPerFrame(2), mMoveThreshold(5), mRefreshInterval(0.5f),
+	mCullDistance(3000), mLodBias(0.5f), mProbeResolution(128),
+	mViewCamera(NULL), mCubeCamera(NULL), mCullFrustum(NULL), mCubeNode(NULL), mListener(NULL),
+	mNextFace(0), mRenderedFrom(Vector3::ZERO), mValid(false), mFacesRendered(0), mProbesBaked(false)
+{
+	for (int i = 0; i < FACES; i++)
+	{
+		mTargets[i] = NULL;
+		mFaceAge[i] = 0;
+		mFaceStale[i] = true;
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		mNearProbes[i] = -1;
+		mProbeUnits[i] = NULL;
+	}
+}
+
+//Destructor
+ReflectionUpdater::~ReflectionUpdater()
+{
+	if (mCubeNode)
+		mCubeNode->detachAllObjects();
+	delete mCullFrustum;
+}
+
+//Reads the update budgets, keeping the defaults for anything missing
+void ReflectionUpdater::loadSettings(const String &fileName)
+{
+	ConfigFile config;
+	try
+	{
+		config.loadFromResourceSystem(fileName, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME, "=", true);
+	}
+	catch (Ogre::Exception& e)
+	{
+		LogManager::getSingleton().logMessage("ReflectionUpdater: could not load " + fileName + ", using default budgets");
+		return;
+	}
+
+	mMode = (config.getSetting("Mode") == "Probes") ? MODE_PROBES : MODE_LIVE;
+	mResolution = StringConverter::parseInt(config.getSetting("Resolution"), mResolution);
+	mFacesPerFrame = StringConverter::parseInt(config.getSetting("FacesPerFrame"), mFacesPerFrame);
+	mMoveThreshold = StringConverter::parseReal(config.getSetting("MoveThreshold"), mMoveThreshold);
+	mRefreshInterval = StringConverter::parseReal(config.getSetting("RefreshInterval"), mRefreshInterval);
+	mCullDistance = StringConverter::parseReal(config.getSetting("CullDistance"), mCullDistance);
+	mLodBias = StringConverter::parseReal(config.getSetting("LodBias"), mLodBias);
+	mProbeResolution = StringConverter::parseInt(config.getSetting("ProbeResolution"), mProbeResolution);
+
+	if (!Bitwise::isPO2(mResolution) || mResolution < 16)
+		mResolution = 256;
+	if (!Bitwise::isPO2(mProbeResolution) || mProbeResolution < 16)
+		mProbeResolution = 128;
+	if (mFacesPerFrame < 1)
+		mFacesPerFrame = 1;
+	if (mFacesPerFrame > FACES)
+		mFacesPerFrame = FACES;
+	if (mLodBias <= 0)
+		mLodBias = 1;
+}
+
+/* Makes the cube map texture and the camera that renders it, every face is reported to the listener.
+ * The cube camera keeps the view camera's far clip so sky domes sized to it still show up, the culling
+ * frustum is what keeps the rest of the scene short */
+void ReflectionUpdater::create(const String &textureName, const String &materialName, SceneManager* sceneMgr, Camera* viewCamera, RenderTargetListener* listener)
+{
+	mViewCamera = viewCamera;
+	mListener = listener;
+	mCubeCamera = sceneMgr->createCamera("ReflectionCamera");
+	mCubeCamera->setFOVy(Degree(90));
+	mCubeCamera->setAspectRatio(1);
+	mCubeCamera->setNearClipDistance(viewCamera->getNearClipDistance());
+	mCubeCamera->setFarClipDistance(viewCamera->getFarClipDistance());
+	mCubeCamera->setLodBias(mLodBias);
+
+	mCullFrustum = new Frustum();
+	mCullFrustum->setFOVy(Degree(90));
+	mCullFrustum->setAspectRatio(1);
+	mCullFrustum->setNearClipDistance(viewCamera->getNearClipDistance());
+	mCullFrustum->setFarClipDistance(mCullDistance);
+	mCullFrustum->setVisible(false);
+	mCubeCamera->setCullingFrustum(mCullFrustum);
+
+	mCubeNode = sceneMgr->getRootSceneNode()->createChildSceneNode();
+	mCubeNode->attachObject(mCubeCamera);
+	mCubeNode->attachObject(mCullFrustum);
+
+	//The material names the live texture, so it is made in probe mode too, just never rendered
+	TexturePtr tex = TextureManager::getSingleton().createManual(textureName,
+		ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, TEX_TYPE_CUBE_MAP, mResolution, mResolution, 0, PF_R8G8B8, TU_RENDERTARGET);
+
+	// assign our camera to all 6 render targets of the texture (1 for each direction)
+	for (int i = 0; i < FACES; i++)
+	{
+		mTargets[i] = tex->getBuffer(i)->getRenderTarget();
+		setupTarget(mTargets[i]);
+	}
+	invalidate();
+
+	if (mMode != MODE_PROBES)
+		return;
+
+	//The gun's reflection unit shows the nearest probe, and a copy of it blends in the next nearest
+	MaterialPtr material = MaterialManager::getSingleton().getByName(materialName);
+	if (material.isNull())
+	{
+		LogManager::getSingleton().logMessage("ReflectionUpdater: no material " + materialName + ", reflection probes are off");
+		mMode = MODE_LIVE;
+		return;
+	}
+	material->load();
+	Pass* pass = material->getBestTechnique()->getPass(0);
+	mProbeUnits[0] = pass->getTextureUnitState(0);
+	mProbeUnits[1] = pass->createTextureUnitState();
+	mProbeUnits[1]->setCubicTextureName(textureName, true);
+	mProbeUnits[1]->setTextureAddressingMode(TextureUnitState::TAM_CLAMP);
+	mProbeUnits[1]->setEnvironmentMap(true, TextureUnitState::ENV_REFLECTION);
+	mProbeUnits[1]->setColourOperationEx(LBX_BLEND_MANUAL, LBS_TEXTURE, LBS_CURRENT, ColourValue::White, ColourValue::White, 0);
+}
+
+//Points a cube face at the cube camera with the reflection's viewport settings
+void ReflectionUpdater::setupTarget(RenderTarget* target)
+{
+	Viewport* viewport = target->addViewport(mCubeCamera);
+	viewport->setOverlaysEnabled(false);
+	viewport->setShadowsEnabled(false);
+	viewport->setVisibilityMask(VISIBLE_IN_REFLECTION);
+	viewport->setClearEveryFrame(true);
+	viewport->setBackgroundColour(Ogre::ColourValue::Blue);
+	target->setAutoUpdated(false);
+	target->addListener(mListener);
+}
+
+//Sets where the next level's probes go, they're baked on the next update, none means one where the camera is
+void ReflectionUpdater::setProbes(const std::vector<Vector3> &positions)
+{
+	mProbePositions = positions;
+	mProbesBaked = false;
+}
+
+//Marks every face out of date, e.g. after the player is moved to a new level
+void ReflectionUpdater::invalidate(void)
+{
+	for (int i = 0; i < FACES; i++)
+		mFaceStale[i] = true;
+	mValid = false;
+	mProbesBaked = false;
+}
+
+//Renders one side of the cube from wherever the cube node is
+void ReflectionUpdater::renderFace(RenderTarget* target, int face)
+{
+	//The culling frustum follows the node, so the node is what gets turned
+	mCubeNode->setOrientation(Quaternion::IDENTITY);
+	mCubeNode->yaw(FACE_YAWS[face], Node::TS_WORLD);
+	mCubeNode->pitch(FACE_PITCHES[face]);
+	target->update();
+}
+
+/* Renders the faces that are due this frame from the camera's position, returns how many were rendered.
+ * Until every face has been rendered once they are all rendered straight away.
+ * In probe mode the probes are baked on the first update after a load, and only blended after that */
+int ReflectionUpdater::update(Real timeSinceLastFrame)
+{
+	mFacesRendered = 0;
+	if (!mCubeCamera)
+		return 0;
+
+	Vector3 position = mViewCamera->getDerivedPosition();
+	if (mMode == MODE_PROBES)
+	{
+		if (!mProbesBaked)
+			bakeProbes();
+		blendProbes(position);
+		return mFacesRendered;
+	}
+
+	if (position.squaredDistance(mRenderedFrom) > mMoveThreshold * mMoveThreshold)
+	{
+		for (int i = 0; i < FACES; i++)
+			mFaceStale[i] = true;
+		mRenderedFrom = position;
+	}
+	for (int i = 0; i < FACES; i++)
+	{
+		mFaceAge[i] += timeSinceLastFrame;
+		if (mFaceAge[i] > mRefreshInterval)
+			mFaceStale[i] = true;
+	}
+
+	int budget = mValid ? mFacesPerFrame : FACES;
+	mCubeNode->setPosition(position);
+	for (int checked = 0; checked < FACES && mFacesRendered < budget; checked++)
+	{
+		int face = mNextFace;
+		mNextFace = (mNextFace + 1) % FACES;
+		if (!mFaceStale[face])
+			continue;
+
+		renderFace(mTargets[face], face);
+		mFaceStale[face] = false;
+		mFaceAge[face] = 0;
+		mFacesRendered++;
+	}
+
+	mValid = true;
+	return mFacesRendered;
+}
+
+//Renders every probe's cube map, making probe textures the first time a level needs that many
+void ReflectionUpdater::bakeProbes(void)
+{
+	if (mProbePositions.empty())
+		mProbePositions.push_back(mViewCamera->getDerivedPosition());
+
+	while (mProbeTextures.size() < mProbePositions.size())
+	{
+		TexturePtr probe = TextureManager::getSingleton().createManual("ReflectionProbe" + StringConverter::toString(mProbeTextures.size()),
+			ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, TEX_TYPE_CUBE_MAP, mProbeResolution, mProbeResolution, 0, PROBE_FORMAT, TU_RENDERTARGET);
+		for (int face = 0; face < FACES; face++)
+			setupTarget(probe->getBuffer(face)->getRenderTarget());
+		mProbeTextures.push_back(probe);
+	}
+
+	for (unsigned int i = 0; i < mProbePositions.size(); i++)
+	{
+		mCubeNode->setPosition(mProbePositions[i]);
+		for (int face = 0; face < FACES; face++)
+		{
+			renderFace(mProbeTextures[i]->getBuffer(face)->getRenderTarget(), face);
+			mFacesRendered++;
+		}
+	}
+
+	LogManager::getSingleton().logMessage("ReflectionUpdater: baked " + StringConverter::toString(mProbePositions.size()) + " reflection probes");
+	mProbesBaked = true;
+	mNearProbes[0] = mNearProbes[1] = -1;
+}
+
+//Shows the two probes nearest the camera on the gun, weighted so the closer one dominates
+void ReflectionUpdater::blendProbes(const Vector3 &position)
+{
+	int nearest[2] = { -1, -1 };
+	Real distances[2] = { 0, 0 };
+	for (int i = 0; i < (int) mProbePositions.size(); i++)
+	{
+		Real distance = position.distance(mProbePositions[i]);
+		if (nearest[0] < 0 || distance < distances[0])
+		{
+			nearest[1] = nearest[0];
+			distances[1] = distances[0];
+			nearest[0] = i;
+			distances[0] = distance;
+		}
+		else if (nearest[1] < 0 || distance < distances[1])
+		{
+			nearest[1] = i;
+			distances[1] = distance;
+		}
+	}
+	if (nearest[0] < 0)
+		return;
+
+	//With one probe the second unit shows it too, so the blend makes no difference
+	if (nearest[1] < 0)
+	{
+		nearest[1] = nearest[0];
+		distances[1] = distances[0];
+	}
+
+	//Texture names only change when the player crosses into another pair of probes
+	for (int n = 0; n < 2; n++)
+	{
+		if (nearest[n] != mNearProbes[n])
+		{
+			mProbeUnits[n]->setCubicTextureName(mProbeTextures[nearest[n]]->getName(), true);
+			mNearProbes[n] = nearest[n];
+		}
+	}
+
+	Real total = distances[0] + distances[1];
+	Real secondWeight = (total > 0) ? distances[0] / total : 0;
+	mProbeUnits[1]->setColourOperationEx(LBX_BLEND_MANUAL, LBS_TEXTURE, LBS_CURRENT, ColourValue::White, ColourValue::White, secondWeight);
+}
+
+//Faces rendered by the last update
+int ReflectionUpdater::getFacesRendered(void) const
+{
+	return mFacesRendered;
+}
@@ -0,0 +1,238 @@
+#include "stdafx.h"
+#include "VegetationRenderer.h"
+#include "RandomStream.h"
+#include "BatchingHelper.h"
+
+/* Draws the island's palms with hardware instancing, one InstancedGeometry per palm mesh.
+ * Palms placed in the level keep their physics bodies but their entities are hidden, and more palms can
+ * be scattered from a greyscale density map. The wind sway is done in the vertex program from each
+ * palm's world position, so there are no skeletons to animate or skin on the CPU and a whole forest
+ * costs a few draw calls. Batches far from the camera are swapped for billboards by the ImpostorRenderer.
+ */
+
+//Must match the size of worldMatrix3x4Array in Vegetation.cg
+const int MAX_INSTANCED_MATRICES = 80;
+//Width of the areas palms are grouped into before they are handed out to batches
+const Real VEGETATION_CELL_SIZE = 500;
+//Scattered palms only grow on land, above the water line
+const Real SCATTER_MIN_HEIGHT = 20;
+const Real SCATTER_MIN_SCALE = 9;
+const Real SCATTER_MAX_SCALE = 15;
+//Islands are 3000 units across, starting at the origin
+const Real ISLAND_SIZE = 3000;
+const char* SCATTER_MESHES[] = { "Palm1.mesh", "Palm2.mesh" };
+
+//Constructor
+VegetationRenderer::VegetationRenderer(SceneManager* sceneMgr, ImpostorRenderer* impostors) :
+	mSceneMgr(sceneMgr), mImpostors(impostors)
+{
+}
+
+//Destructor
+VegetationRenderer::~VegetationRenderer()
+{
+	clear();
+}
+
+//Queues a palm to be drawn by the next build
+void VegetationRenderer::add(const String &mesh, const Vector3 &position, const Quaternion &orientation, const Vector3 &scale)
+{
+	Instance instance;
+	instance.position = position;
+	instance.orientation = orientation;
+	instance.scale = scale;
+	instance.cell = BatchingHelper::getCellKey(position, VEGETATION_CELL_SIZE);
+	mInstances[mesh].push_back(instance);
+}
+
+//Queues every palm placed in the level, their own entities are hidden once the batches are built
+void VegetationRenderer::addPalms(const EntityStore &entities)
+{
+	for (int i = 0; i < entities.getCount(); i++)
+	{
+		if (entities.getType(i) != EntityStore::ENTITY_PALM)
+			continue;
+
+		SceneNode* node = entities.getBody(i)->getSceneNode();
+		SceneNode::ObjectIterator objects = node->getAttachedObjectIterator();
+		while (objects.hasMoreElements())
+		{
+			MovableObject* object = objects.getNext();
+			if (object->getMovableType() != EntityFactory::FACTORY_TYPE_NAME)
+				continue;
+
+			Entity* entity = static_cast<Entity*>(object);
+			add(entity->getMesh()->getName(), node->_getDerivedPosition(), node->_getDerivedOrientation(), node->_getDerivedScale());
+			mHiddenEntities.push_back(entity);
+			break;
+		}
+	}
+}
+
+/* Queues up to count palms at random spots on the island, more likely where the density map is bright.
+ * The map covers the whole island with its top row at z = 0. Scattered palms are only scenery and have no bodies */
+void VegetationRenderer::scatter(const String &densityMap, int count, TerrainGroup* terrain, Ogre::uint32 seed)
+{
+	if (densityMap.empty() || count <= 0)
+		return;
+
+	Image density;
+	try
+	{
+		density.load(densityMap, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+	}
+	catch (Ogre::Exception& e)
+	{
+		LogManager::getSingleton().logMessage("VegetationRenderer: can't load density map " + densityMap + ", " + e.getDescription());
+		return;
+	}
+
+	//Rejection sampling, giving up after a fixed number of tries so a dark map can't stall the load
+	//The palm meshes aren't modelled upright, so scattered palms copy the lean of the level's own palms
+	std::vector<Quaternion> poses[2];
+	for (int m = 0; m < 2; m++)
+	{
+		std::vector<Instance> &placedPalms = mInstances[SCATTER_MESHES[m]];
+		for (unsigned int i = 0; i < placedPalms.size(); i++)
+			poses[m].push_back(placedPalms[i].orientation);
+		if (poses[m].empty())
+			poses[m].push_back(Quaternion::IDENTITY);
+	}
+
+	RandomStream random(seed, 0);
+	int placed = 0;
+	for (int attempt = 0; attempt < count * 8 && placed < count; attempt++)
+	{
+		Real u = random.nextReal();
+		Real v = random.nextReal();
+		ColourValue colour = density.getColourAt((int) (u * density.getWidth()), (int) (v * density.getHeight()), 0);
+		if (random.nextReal() >= colour.r)
+			continue;
+
+		Vector3 position(u * ISLAND_SIZE, 0, v * ISLAND_SIZE);
+		position.y = terrain->getHeightAtWorldPosition(position);
+		if (position.y < SCATTER_MIN_HEIGHT)
+			continue;
+
+		int mesh = random.nextInt(2);
+		Quaternion pose = poses[mesh][random.nextInt(poses[mesh].size())];
+		Quaternion orientation = Quaternion(Radian(random.nextReal() * Math::TWO_PI), Vector3::UNIT_Y) * pose;
+		Real scale = SCATTER_MIN_SCALE + random.nextReal() * (SCATTER_MAX_SCALE - SCATTER_MIN_SCALE);
+		add(SCATTER_MESHES[mesh], position, orientation, Vector3(scale));
+		placed++;
+	}
+
+	LogManager::getSingleton().logMessage("VegetationRenderer: scattered " + StringConverter::toString(placed)
+		+ " palms from " + densityMap);
+}
+
+//Orders palms by the area they stand in
+bool VegetationRenderer::compareCells(const Instance &a, const Instance &b)
+{
+	return a.cell < b.cell;
+}
+
+//Builds the batches for every queued palm and hides the level palms' entities
+void VegetationRenderer::build(void)
+{
+	for (std::map<String, std::vector<Instance> >::iterator it = mInstances.begin(); it != mInstances.end(); ++it)
+		buildMesh(it->first, it->second);
+	mInstances.clear();
+
+	for (unsigned int i = 0; i < mHiddenEntities.size(); i++)
+		mHiddenEntities[i]->setVisible(false);
+}
+
+/* The palm meshes carry the skeleton their old sway animation used. Instancing a skinned mesh would
+ * need every bone per palm, so the batches use a copy with the skeleton and blend weights taken out */
+MeshPtr VegetationRenderer::getStaticMesh(const String &mesh)
+{
+	String name = mesh + "/Static";
+	MeshPtr copy = MeshManager::getSingleton().getByName(name);
+	if (!copy.isNull())
+		return copy;
+
+	return BatchingHelper::cloneWithoutSkeleton(mesh, name);
+}
+
+//Builds one InstancedGeometry for every palm using a mesh, split into batches of nearby palms
+void VegetationRenderer::buildMesh(const String &mesh, std::vector<Instance> &instances)
+{
+	if (instances.empty())
+		return;
+	std::stable_sort(instances.begin(), instances.end(), compareCells);
+
+	Entity* templateEnt = mSceneMgr->createEntity("VegetationTemplate" + StringConverter::toString(mBatches.size()), getStaticMesh(mesh)->getName());
+	templateEnt->setMaterialName("PalmInstanced");
+
+	int palmsPerBatch = (MAX_INSTANCED_MATRICES < (int) instances.size()) ? MAX_INSTANCED_MATRICES : instances.size();
+	int batchCount = ((int) instances.size() + palmsPerBatch - 1) / palmsPerBatch;
+
+	InstancedGeometry* batch = mSceneMgr->createInstancedGeometry("Vegetation" + StringConverter::toString(mBatches.size()));
+	batch->setCastShadows(true);
+	batch->setBatchInstanceDimensions(Vector3(1000000, 1000000, 1000000));
+	for (int i = 0; i < palmsPerBatch; i++)
+		batch->addEntity(templateEnt, Vector3::ZERO);
+	batch->setOrigin(Vector3::ZERO);
+	batch->build();
+	for (int i = 1; i < batchCount; i++)
+		batch->addBatchInstance();
+	mSceneMgr->destroyEntity(templateEnt);
+	mBatches.push_back(batch);
+
+	/* Hand the instances out in cell order, spare slots in the last batch are collapsed to nothing.
+	 * Each batch's palms get billboards together, so the batch can be hidden once they're all far away */
+	bool impostors = mImpostors->hasImpostor(mesh);
+	unsigned int next = 0;
+	InstancedGeometry::BatchInstanceIterator batchIt = batch->getBatchInstanceIterator();
+	while (batchIt.hasMoreElements())
+	{
+		InstancedGeometry::BatchInstance* batchInstance = batchIt.getNext();
+		int group = impostors ? mImpostors->addGroup() : -1;
+		mBatchInstances.push_back(batchInstance);
+		mImpostorGroups.push_back(group);
+		InstancedGeometry::BatchInstance::InstancedObjectIterator objectIt = batchInstance->getObjectIterator();
+		while (objectIt.hasMoreElements())
+		{
+			InstancedGeometry::InstancedObject* object = objectIt.getNext();
+			if (next >= instances.size())
+			{
+				object->setScale(Vector3::ZERO);
+				continue;
+			}
+
+			const Instance &instance = instances[next++];
+			object->setPosition(instance.position);
+			object->setOrientation(instance.orientation);
+			object->setScale(instance.scale);
+			if (group >= 0)
+				mImpostors->add(group, mesh, instance.position, instance.orientation, instance.scale);
+		}
+
+		//Palms never move, so the bounds only need working out once
+		batchInstance->updateBoundingBox();
+	}
+	batch->setVisible(true);
+}
+
+//Removes the batches and shows the level palms' own entities again
+void VegetationRenderer::clear(void)
+{
+	for (unsigned int i = 0; i < mBatches.size(); i++)
+		mSceneMgr->destroyInstancedGeometry(mBatches[i]);
+	mBatches.clear();
+	mBatchInstances.clear();
+	mImpostorGroups.clear();
+
+	for (unsigned int i = 0; i < mHiddenEntities.size(); i++)
+		mHiddenEntities[i]->setVisible(true);
+	mHiddenEntities.clear();
+	mInstances.clear();
+}
+
+//Hides batches whose palms are all drawn as billboards
+void VegetationRenderer::update(void)
+{
+	for (unsigned int i = 0; i < mBatchInstances.size(); i++)
+		mBatchInstances[i]->setVisible(mImpostors->isNear(mImpostorGroups[i]));
+}